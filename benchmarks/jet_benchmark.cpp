@@ -0,0 +1,545 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdbool>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include <scramjet/error_code.hpp>
+#include <scramjet/jet_connection.hpp>
+#include <scramjet/jet_message.hpp>
+#include <scramjet/jet_peer.hpp>
+#include <scramjet/jet_protocol.hpp>
+#include <scramjet/memory_jet_connection.hpp>
+#include <scramjet/message_frames.hpp>
+#include <scramjet/receive_buffer.hpp>
+#include <scramjet/socket_jet_connection.hpp>
+#include <scramjet/unix_jet_connection.hpp>
+#include <scramjet/uring_engine.hpp>
+
+#if defined(__linux__)
+#include <scramjet/shm_jet_connection.hpp>
+#include <scramjet/shm_ring.hpp>
+#endif
+
+#include "loopback_server.hpp"
+
+typedef std::chrono::steady_clock benchmark_clock;
+// Objects the far end of an in-process connection needs, released once the
+// benchmark's io_context has run out of work.
+typedef std::vector<std::shared_ptr<void>> keep_alive_t;
+typedef std::function<std::unique_ptr<scramjet::jet_connection>(boost::asio::io_context&, keep_alive_t&)> connection_factory_t;
+
+struct transport {
+	std::string name;
+	connection_factory_t make_connection;
+};
+
+struct benchmark_config {
+	unsigned int handshakes = 200;
+	unsigned int latency_requests = 20000;
+	unsigned int throughput_bytes = 64 * 1024 * 1024;
+	unsigned int throughput_window = 64;
+};
+
+static const std::chrono::milliseconds BENCHMARK_TIMEOUT(5000);
+
+static double elapsed_ns(benchmark_clock::time_point start, benchmark_clock::time_point end)
+{
+	return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+static double percentile(const std::vector<double>& sorted, double p)
+{
+	if (sorted.empty()) {
+		return 0.0;
+	}
+
+	std::size_t index = static_cast<std::size_t>(p * static_cast<double>(sorted.size()));
+	return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static void print_distribution(const std::string& name, std::vector<double>& samples_ns)
+{
+	std::sort(samples_ns.begin(), samples_ns.end());
+	std::printf("%-34s n=%-7zu p50=%9.1fus p99=%9.1fus p999=%9.1fus max=%9.1fus\n",
+	            name.c_str(),
+	            samples_ns.size(),
+	            percentile(samples_ns, 0.5) / 1000.0,
+	            percentile(samples_ns, 0.99) / 1000.0,
+	            percentile(samples_ns, 0.999) / 1000.0,
+	            samples_ns.empty() ? 0.0 : samples_ns.back() / 1000.0);
+}
+
+static void benchmark_frame_parsing(void)
+{
+	static const std::size_t PAYLOAD_SIZE = 64;
+	static const unsigned int ROUNDS = 200;
+
+	std::vector<uint8_t> chunk;
+	std::vector<uint8_t> frame(scramjet::request_frame_t::size() + PAYLOAD_SIZE, 'x');
+	for (uint32_t id = 0; chunk.size() < 1024 * 1024; id++) {
+		scramjet::request_frame_t::encode(frame.data(), frame.size(), scramjet::message_type::MESSAGE_REQUEST, id);
+		uint32_t length = static_cast<uint32_t>(frame.size());
+		std::size_t offset = chunk.size();
+		chunk.resize(offset + sizeof(length) + frame.size());
+		scramjet::store_little(&chunk[offset], length);
+		std::memcpy(&chunk[offset + sizeof(length)], frame.data(), frame.size());
+	}
+
+	scramjet::receive_buffer buffer;
+	uint64_t frames = 0;
+	uint64_t checksum = 0;
+	benchmark_clock::time_point start = benchmark_clock::now();
+	for (unsigned int round = 0; round < ROUNDS; round++) {
+		std::size_t offset = 0;
+		while (offset < chunk.size()) {
+			std::size_t length = std::min(chunk.size() - offset, static_cast<std::size_t>(scramjet::receive_buffer::DEFAULT_BLOCK_SIZE));
+			uint8_t* space = buffer.prepare(length);
+			length = std::min(length, buffer.space());
+			std::memcpy(space, &chunk[offset], length);
+			buffer.commit(length);
+			offset += length;
+
+			const uint8_t* message;
+			std::size_t message_length;
+			while (buffer.next_message(message, message_length)) {
+				scramjet::request_frame_t::view view;
+				if (scramjet::request_frame_t::decode(message, message_length, view)) {
+					checksum += view.get<1>();
+				}
+
+				buffer.consume_message();
+				frames++;
+			}
+		}
+	}
+
+	double ns = elapsed_ns(start, benchmark_clock::now());
+	std::printf("%-34s %9.1f ns/frame %9.1f MB/s (checksum %llu)\n",
+	            "frame parsing (64 byte payload)",
+	            ns / static_cast<double>(frames),
+	            static_cast<double>(chunk.size()) * ROUNDS / (ns / 1e9) / 1e6,
+	            static_cast<unsigned long long>(checksum));
+
+	static const unsigned int MESSAGES = 1000000;
+	const std::string notification = "{\"method\":\"fetch_1\",\"params\":{\"path\":\"sensors/temperature/room_42\","
+	                                 "\"event\":\"change\",\"value\":{\"celsius\":21.5,\"history\":[21.1,21.2,21.4,21.5],"
+	                                 "\"unit\":\"C\"}}}";
+	std::size_t path_bytes = 0;
+	start = benchmark_clock::now();
+	for (unsigned int i = 0; i < MESSAGES; i++) {
+		scramjet::jet_message message;
+		scramjet::jet_message::parse(reinterpret_cast<const uint8_t*>(notification.data()), notification.size(), message);
+		path_bytes += message.path.size();
+	}
+
+	ns = elapsed_ns(start, benchmark_clock::now());
+	std::printf("%-34s %9.1f ns/msg   %9.1f MB/s (%zu)\n",
+	            "jet notification parsing",
+	            ns / MESSAGES,
+	            static_cast<double>(notification.size()) * MESSAGES / (ns / 1e9) / 1e6,
+	            path_bytes);
+}
+
+static void benchmark_protocol_core(void)
+{
+	static const std::size_t PAYLOAD_SIZE = 64;
+	static const std::size_t READ_SIZE = 64 * 1024;
+	static const unsigned int ROUNDS = 200;
+
+	std::vector<uint8_t> version(scramjet::jet_protocol::VERSION_FRAME_SIZE);
+	scramjet::jet_protocol::encode_version(version.data(), version.size(), 0);
+
+	std::vector<uint8_t> chunk;
+	std::vector<uint8_t> frame(scramjet::response_frame_t::size() + PAYLOAD_SIZE, 'x');
+	for (uint32_t id = 0; chunk.size() < 1024 * 1024; id++) {
+		scramjet::response_frame_t::encode(frame.data(), frame.size(), scramjet::message_type::MESSAGE_RESPONSE, id);
+		uint32_t length = static_cast<uint32_t>(frame.size());
+		std::size_t offset = chunk.size();
+		chunk.resize(offset + sizeof(length) + frame.size());
+		scramjet::store_little(&chunk[offset], length);
+		std::memcpy(&chunk[offset + sizeof(length)], frame.data(), frame.size());
+	}
+
+	std::vector<uint8_t> reassembly(64 * 1024);
+	scramjet::jet_protocol protocol(reassembly.data(), reassembly.size());
+	uint8_t prefix[sizeof(uint32_t)];
+	scramjet::store_little(prefix, static_cast<uint32_t>(version.size()));
+	protocol.feed(prefix, sizeof(prefix));
+	scramjet::protocol_event event;
+	while (protocol.poll(event)) {
+	}
+	protocol.feed(version.data(), version.size());
+	while (protocol.poll(event)) {
+	}
+
+	uint64_t responses = 0;
+	uint64_t checksum = 0;
+	benchmark_clock::time_point start = benchmark_clock::now();
+	for (unsigned int round = 0; round < ROUNDS; round++) {
+		for (std::size_t offset = 0; offset < chunk.size(); offset += READ_SIZE) {
+			protocol.feed(&chunk[offset], std::min(chunk.size() - offset, READ_SIZE));
+			while (protocol.poll(event)) {
+				if (event.type == scramjet::PROTOCOL_EVENT_RESPONSE) {
+					checksum += event.request_id;
+					responses++;
+				}
+			}
+		}
+	}
+
+	double ns = elapsed_ns(start, benchmark_clock::now());
+	std::printf("%-34s %9.1f ns/frame %9.1f MB/s (checksum %llu)\n",
+	            "protocol core (64 byte payload)",
+	            ns / static_cast<double>(responses),
+	            static_cast<double>(chunk.size()) * ROUNDS / (ns / 1e9) / 1e6,
+	            static_cast<unsigned long long>(checksum));
+}
+
+static void benchmark_handshake(const transport& t, const benchmark_config& config)
+{
+	std::vector<double> samples;
+	unsigned int failures = 0;
+	for (unsigned int i = 0; i < config.handshakes; i++) {
+		boost::asio::io_context ioc;
+		keep_alive_t keep_alive;
+		std::unique_ptr<scramjet::jet_connection> connection = t.make_connection(ioc, keep_alive);
+		scramjet::jet_connection* c = connection.get();
+		bool done = false;
+		benchmark_clock::time_point start = benchmark_clock::now();
+		c->connect([&, c](enum scramjet::error_code ec) {
+			if (ec != scramjet::SCRAMJET_OK) {
+				failures++;
+				done = true;
+				return;
+			}
+
+			c->receive_message([&, c](enum scramjet::error_code receive_ec, const uint8_t*, size_t) {
+				if (done) {
+					return;
+				}
+
+				done = true;
+				if (receive_ec == scramjet::SCRAMJET_OK) {
+					samples.push_back(elapsed_ns(start, benchmark_clock::now()));
+				} else {
+					failures++;
+				}
+
+				c->disconnect();
+			});
+		},
+		           BENCHMARK_TIMEOUT);
+		ioc.run();
+	}
+
+	print_distribution(t.name + " handshake", samples);
+	if (failures > 0) {
+		std::printf("%-34s %u failed handshakes\n", "", failures);
+	}
+}
+
+template <typename Body>
+static bool with_connected_peer(const transport& t, Body body, scramjet::jet_peer_statistics* statistics = nullptr)
+{
+	boost::asio::io_context ioc;
+	keep_alive_t keep_alive;
+	scramjet::jet_peer peer(t.make_connection(ioc, keep_alive));
+	bool connected = false;
+	peer.connect([&](enum scramjet::error_code ec) {
+		if (ec != scramjet::SCRAMJET_OK) {
+			return;
+		}
+
+		connected = true;
+		body(peer);
+	},
+	             BENCHMARK_TIMEOUT);
+	ioc.run();
+	if (statistics != nullptr) {
+		*statistics = peer.get_statistics();
+	}
+
+	return connected;
+}
+
+static void benchmark_latency(const transport& t, const benchmark_config& config)
+{
+	static const unsigned int WARMUP = 1000;
+
+	std::vector<uint8_t> payload(32, 'x');
+	std::vector<double> samples;
+	samples.reserve(config.latency_requests);
+	unsigned int failures = 0;
+	scramjet::jet_peer_statistics statistics;
+
+	bool connected = with_connected_peer(t, [&](scramjet::jet_peer& peer) {
+		auto next = std::make_shared<std::function<void(unsigned int)>>();
+		*next = [&, next](unsigned int count) {
+			if (count == WARMUP + config.latency_requests) {
+				peer.disconnect();
+				return;
+			}
+
+			benchmark_clock::time_point start = benchmark_clock::now();
+			peer.request(payload.data(), payload.size(), [&, next, count, start](enum scramjet::error_code ec, const uint8_t*, size_t) {
+				if (ec != scramjet::SCRAMJET_OK) {
+					failures++;
+					if (ec != scramjet::SCRAMJET_REQUEST_TIMEOUT) {
+						return;
+					}
+				} else if (count >= WARMUP) {
+					samples.push_back(elapsed_ns(start, benchmark_clock::now()));
+				}
+
+				(*next)(count + 1);
+			},
+			             BENCHMARK_TIMEOUT);
+		};
+		(*next)(0);
+	},
+	                                     &statistics);
+
+	if (!connected) {
+		std::printf("%-34s could not connect\n", (t.name + " request round trip").c_str());
+		return;
+	}
+
+	print_distribution(t.name + " request round trip", samples);
+	std::printf("%-34s p50=%9.1fus p99=%9.1fus callback p99=%6.1fus (%llu frames, %llu reads, %llu writes)\n",
+	            "  as seen by jet_peer",
+	            static_cast<double>(statistics.round_trip_time.value_at_percentile(50.0)) / 1000.0,
+	            static_cast<double>(statistics.round_trip_time.value_at_percentile(99.0)) / 1000.0,
+	            static_cast<double>(statistics.callback_time.value_at_percentile(99.0)) / 1000.0,
+	            static_cast<unsigned long long>(statistics.connection.frames_received),
+	            static_cast<unsigned long long>(statistics.connection.reads),
+	            static_cast<unsigned long long>(statistics.connection.writes));
+	if (failures > 0) {
+		std::printf("%-34s %u failed requests\n", "", failures);
+	}
+}
+
+static void benchmark_throughput(const transport& t, const benchmark_config& config, std::size_t payload_size)
+{
+	std::vector<uint8_t> payload(payload_size, 'x');
+	uint64_t total = std::max<uint64_t>(config.throughput_bytes / (payload_size + scramjet::request_frame_t::size()), 1000);
+	uint64_t sent = 0;
+	uint64_t completed = 0;
+	uint64_t failures = 0;
+	benchmark_clock::time_point start;
+	benchmark_clock::time_point end;
+
+	bool connected = with_connected_peer(t, [&](scramjet::jet_peer& peer) {
+		auto send_one = std::make_shared<std::function<void(void)>>();
+		*send_one = [&, send_one]() {
+			sent++;
+			peer.request(payload.data(), payload.size(), [&, send_one](enum scramjet::error_code ec, const uint8_t*, size_t) {
+				if (ec != scramjet::SCRAMJET_OK) {
+					failures++;
+				}
+
+				completed++;
+				if (completed == total) {
+					end = benchmark_clock::now();
+					peer.disconnect();
+					return;
+				}
+
+				if ((ec == scramjet::SCRAMJET_OK) && (sent < total)) {
+					(*send_one)();
+				}
+			},
+			             BENCHMARK_TIMEOUT);
+		};
+
+		start = benchmark_clock::now();
+		for (unsigned int i = 0; (i < config.throughput_window) && (sent < total); i++) {
+			(*send_one)();
+		}
+	});
+
+	std::string name = t.name + " throughput " + std::to_string(payload_size) + "B";
+	if (!connected || (completed != total)) {
+		std::printf("%-34s incomplete (%llu/%llu)\n", name.c_str(), static_cast<unsigned long long>(completed), static_cast<unsigned long long>(total));
+		return;
+	}
+
+	double seconds = elapsed_ns(start, end) / 1e9;
+	std::printf("%-34s %10.0f msg/s %9.1f MB/s\n",
+	            name.c_str(),
+	            static_cast<double>(total) / seconds,
+	            static_cast<double>(total * payload_size) / seconds / 1e6);
+	if (failures > 0) {
+		std::printf("%-34s %llu failed requests\n", "", static_cast<unsigned long long>(failures));
+	}
+}
+
+static std::unique_ptr<scramjet::jet_connection> make_memory_connection(boost::asio::io_context& ioc,
+                                                                       const scramjet::memory_link_options& options,
+                                                                       keep_alive_t& keep_alive)
+{
+	scramjet::memory_jet_connection::pair_t pair = scramjet::memory_jet_connection::create_pair(ioc, options);
+	std::shared_ptr<scramjet::memory_jet_connection> far_end(std::move(pair.second));
+	std::shared_ptr<scramjet::loopback_responder> responder = std::make_shared<scramjet::loopback_responder>(*far_end);
+	responder->start();
+	keep_alive.push_back(responder);
+	keep_alive.push_back(far_end);
+	return std::move(pair.first);
+}
+
+#if defined(SCRAMJET_HAS_IO_URING)
+static std::unique_ptr<scramjet::jet_connection> make_uring_connection(scramjet::stream_jet_connection* connection)
+{
+	std::unique_ptr<scramjet::jet_connection> owner(connection);
+	if (!connection->enable_io_uring()) {
+		return nullptr;
+	}
+
+	return owner;
+}
+
+static bool io_uring_usable(void)
+{
+	boost::asio::io_context ioc;
+	return make_uring_connection(new scramjet::socket_jet_connection(ioc, "127.0.0.1", 0)) != nullptr;
+}
+#endif
+
+static void usage(const char* name)
+{
+	std::cerr << "Usage: " << name << " [--quick] [--transport tcp|unix|tcp-uring|unix-uring|shm|memory|memory-fragmented]..." << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	benchmark_config config;
+	std::vector<std::string> selected;
+	for (int i = 1; i < argc; i++) {
+		std::string arg(argv[i]);
+		if (arg == "--quick") {
+			config.handshakes = 20;
+			config.latency_requests = 2000;
+			config.throughput_bytes = 4 * 1024 * 1024;
+		} else if ((arg == "--transport") && (i + 1 < argc)) {
+			selected.push_back(argv[++i]);
+		} else {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	boost::asio::io_context server_context;
+	scramjet::loopback_server server(server_context);
+	std::vector<transport> transports;
+
+	uint16_t port = server.listen_tcp("127.0.0.1", 0);
+	transports.push_back({"tcp", [port](boost::asio::io_context& ioc, keep_alive_t&) {
+		                      return std::unique_ptr<scramjet::jet_connection>(new scramjet::socket_jet_connection(ioc, "127.0.0.1", port));
+	                      }});
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+	const std::string unix_path = "@scramjet_benchmark_unix_" + std::to_string(::getpid());
+	server.listen_unix(unix_path);
+	transports.push_back({"unix", [unix_path](boost::asio::io_context& ioc, keep_alive_t&) {
+		                      return std::unique_ptr<scramjet::jet_connection>(new scramjet::unix_jet_connection(ioc, unix_path));
+	                      }});
+#endif
+
+#if defined(SCRAMJET_HAS_IO_URING)
+	if (scramjet::uring_engine::is_available() && io_uring_usable()) {
+		transports.push_back({"tcp-uring", [port](boost::asio::io_context& ioc, keep_alive_t&) {
+			                      return make_uring_connection(new scramjet::socket_jet_connection(ioc, "127.0.0.1", port));
+		                      }});
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+		transports.push_back({"unix-uring", [unix_path](boost::asio::io_context& ioc, keep_alive_t&) {
+			                      return make_uring_connection(new scramjet::unix_jet_connection(ioc, unix_path));
+		                      }});
+#endif
+	} else {
+		std::cerr << "io_uring not usable, skipping the uring transports" << std::endl;
+	}
+#endif
+
+#if defined(__linux__)
+	const std::string shm_path = "@scramjet_benchmark_shm_" + std::to_string(::getpid());
+	server.listen_shm(shm_path, scramjet::shm_ring::DEFAULT_CAPACITY);
+	transports.push_back({"shm", [shm_path](boost::asio::io_context& ioc, keep_alive_t&) {
+		                      return std::unique_ptr<scramjet::jet_connection>(new scramjet::shm_jet_connection(ioc, shm_path));
+	                      }});
+#endif
+
+	transports.push_back({"memory", [](boost::asio::io_context& ioc, keep_alive_t& keep_alive) {
+		                      return make_memory_connection(ioc, scramjet::memory_link_options(), keep_alive);
+	                      }});
+	transports.push_back({"memory-fragmented", [](boost::asio::io_context& ioc, keep_alive_t& keep_alive) {
+		                      scramjet::memory_link_options options;
+		                      options.min_fragment_size = 1;
+		                      options.max_fragment_size = 7;
+		                      return make_memory_connection(ioc, options, keep_alive);
+	                      }});
+
+	auto work = boost::asio::make_work_guard(server_context);
+	std::thread server_thread([&server_context]() {
+		server_context.run();
+	});
+
+	benchmark_frame_parsing();
+	benchmark_protocol_core();
+	for (const transport& t : transports) {
+		if (!selected.empty() && (std::find(selected.begin(), selected.end(), t.name) == selected.end())) {
+			continue;
+		}
+
+		benchmark_handshake(t, config);
+		benchmark_latency(t, config);
+		for (std::size_t size : {16, 256, 4096, 65536}) {
+			benchmark_throughput(t, config, size);
+		}
+	}
+
+	boost::asio::post(server_context, [&server]() {
+		server.close();
+	});
+	work.reset();
+	server_context.stop();
+	server_thread.join();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,393 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <boost/asio/post.hpp>
+
+#include "scramjet/coroutine_peer.hpp"
+#include "scramjet/coroutine_task.hpp"
+#include "scramjet/jet_connection.hpp"
+#include "scramjet/jet_protocol.hpp"
+#include "scramjet/message_frames.hpp"
+#include "scramjet/message_type.hpp"
+#include "scramjet/request_table.hpp"
+#include "scramjet/timer_wheel.hpp"
+
+namespace scramjet {
+
+namespace {
+
+// Owns the outermost frame of a spawned coroutine and frees it on completion.
+struct detached_coroutine {
+	struct promise_type : detail::pooled_promise {
+		detached_coroutine get_return_object(void) noexcept
+		{
+			return detached_coroutine{std::coroutine_handle<promise_type>::from_promise(*this)};
+		}
+
+		std::suspend_always initial_suspend(void) const noexcept
+		{
+			return {};
+		}
+
+		std::suspend_never final_suspend(void) const noexcept
+		{
+			return {};
+		}
+
+		void return_void(void) const noexcept
+		{
+		}
+
+		void unhandled_exception(void) const noexcept
+		{
+			std::terminate();
+		}
+	};
+
+	std::coroutine_handle<promise_type> handle;
+};
+
+detached_coroutine run_detached(coroutine_peer& peer, coroutine_task<> task)
+{
+	(void)peer;
+	co_await task;
+}
+
+} // namespace
+
+coroutine_frame_pool& get_frame_pool(coroutine_peer& peer) noexcept
+{
+	return peer.get_frame_pool();
+}
+
+coroutine_peer::coroutine_peer(std::unique_ptr<jet_connection> c) noexcept
+        : m_connection(std::move(c))
+        , m_next_request_id(0)
+        , m_timer_wheel(boost::asio::use_service<timer_wheel>(m_connection->get_io_context()))
+        , m_strand(m_connection->get_strand())
+        , m_closed(scramjet::error_code::SCRAMJET_OK)
+        , m_handshake_waiter(nullptr)
+        , m_protocol(nullptr, 0)
+        , m_message_waiter(nullptr)
+{
+}
+
+coroutine_peer::~coroutine_peer() noexcept
+{
+}
+
+coroutine_frame_pool& coroutine_peer::get_frame_pool(void) noexcept
+{
+	return m_frame_pool;
+}
+
+strand_t& coroutine_peer::get_strand(void) noexcept
+{
+	return m_strand;
+}
+
+void coroutine_peer::spawn(coroutine_task<> task) noexcept
+{
+	std::coroutine_handle<> handle = run_detached(*this, std::move(task)).handle;
+	if (m_strand.running_in_this_thread()) {
+		handle.resume();
+		return;
+	}
+
+	boost::asio::post(m_strand, [handle]() {
+		handle.resume();
+	});
+}
+
+coroutine_peer::connect_awaiter coroutine_peer::connect(std::chrono::milliseconds timeout) noexcept
+{
+	connect_awaiter awaiter;
+	awaiter.m_peer = this;
+	awaiter.m_timeout = timeout;
+	awaiter.m_ec = scramjet::error_code::SCRAMJET_OK;
+	return awaiter;
+}
+
+void coroutine_peer::connect_awaiter::await_suspend(std::coroutine_handle<> handle) noexcept
+{
+	m_handle = handle;
+	m_peer->m_closed = scramjet::error_code::SCRAMJET_OK;
+	m_peer->m_connection->connect([this](enum error_code ec) {
+		m_ec = ec;
+		m_handle.resume();
+	},
+	        m_timeout);
+}
+
+coroutine_peer::handshake_awaiter coroutine_peer::handshake(void) noexcept
+{
+	handshake_awaiter awaiter;
+	awaiter.m_peer = this;
+	awaiter.m_ec = scramjet::error_code::SCRAMJET_OK;
+	return awaiter;
+}
+
+void coroutine_peer::handshake_awaiter::await_suspend(std::coroutine_handle<> handle) noexcept
+{
+	m_handle = handle;
+	m_peer->m_handshake_waiter = this;
+	m_peer->m_protocol.reset();
+
+	using namespace std::placeholders;
+	m_peer->m_connection->receive_message(std::bind(&coroutine_peer::message_received, m_peer, _1, _2, _3));
+}
+
+coroutine_peer::request_awaiter coroutine_peer::request(const uint8_t* payload, size_t payload_length, std::chrono::milliseconds timeout) noexcept
+{
+	request_awaiter awaiter;
+	awaiter.m_peer = this;
+	awaiter.m_payload = payload;
+	awaiter.m_payload_length = payload_length;
+	awaiter.m_timeout = timeout;
+	awaiter.m_response = coroutine_message{scramjet::error_code::SCRAMJET_OK, nullptr, 0};
+	return awaiter;
+}
+
+void coroutine_peer::request_awaiter::await_suspend(std::coroutine_handle<> handle) noexcept
+{
+	m_handle = handle;
+	m_peer->start_request(*this);
+}
+
+void coroutine_peer::start_request(request_awaiter& awaiter)
+{
+	uint32_t id = m_next_request_id++;
+	while (m_requests.find(id) != nullptr) {
+		id = m_next_request_id++;
+	}
+
+	request_slot& slot = m_requests.insert(id);
+	request_awaiter* waiter = &awaiter;
+	slot.callback = [waiter](enum error_code ec, const uint8_t* response, size_t response_length) {
+		waiter->m_response = coroutine_message{ec, response, response_length};
+		waiter->m_handle.resume();
+	};
+	slot.sending = true;
+	slot.started = std::chrono::steady_clock::now();
+
+	slot.frame.resize(request_frame_t::size() + awaiter.m_payload_length);
+	request_frame_t::encode(slot.frame.data(), slot.frame.size(), scramjet::message_type::MESSAGE_REQUEST, id);
+	if (awaiter.m_payload_length > 0) {
+		std::memcpy(&slot.frame[request_frame_t::size()], awaiter.m_payload, awaiter.m_payload_length);
+	}
+
+	uint32_t slot_index = slot.index;
+	uint32_t request_id = slot.id;
+	m_timer_wheel.schedule(slot.timeout, awaiter.m_timeout, [this, slot_index, request_id]() {
+		boost::asio::post(m_strand, std::bind(&coroutine_peer::request_timed_out, this, slot_index, request_id));
+	});
+
+	if (m_closed != scramjet::error_code::SCRAMJET_OK) {
+		request_sent(slot_index, m_closed);
+		return;
+	}
+
+	m_connection->send_message(slot.frame.data(), slot.frame.size(), [this, slot_index](enum error_code send_ec) {
+		request_sent(slot_index, send_ec);
+	});
+}
+
+void coroutine_peer::request_sent(uint32_t slot_index, enum error_code ec)
+{
+	request_slot& slot = m_requests.at(slot_index);
+	response_callback_t callback = nullptr;
+	if ((ec != scramjet::error_code::SCRAMJET_OK) && slot.pending) {
+		callback = std::move(slot.callback);
+		m_requests.erase(slot);
+	}
+
+	m_requests.sent(slot_index);
+	if (callback != nullptr) {
+		callback(ec, nullptr, 0);
+	}
+}
+
+void coroutine_peer::request_timed_out(uint32_t slot_index, uint32_t request_id)
+{
+	request_slot& slot = m_requests.at(slot_index);
+	if (!slot.pending || (slot.id != request_id)) {
+		return;
+	}
+
+	response_callback_t callback = std::move(slot.callback);
+	m_requests.erase(slot);
+	if (callback != nullptr) {
+		callback(scramjet::error_code::SCRAMJET_REQUEST_TIMEOUT, nullptr, 0);
+	}
+}
+
+coroutine_peer::message_awaiter coroutine_peer::next_message(void) noexcept
+{
+	message_awaiter awaiter;
+	awaiter.m_peer = this;
+	awaiter.m_resumed = false;
+	awaiter.m_message = coroutine_message{scramjet::error_code::SCRAMJET_OK, nullptr, 0};
+	return awaiter;
+}
+
+bool coroutine_peer::message_awaiter::await_ready(void) const noexcept
+{
+	return !m_peer->m_queued_messages.empty() || (m_peer->m_closed != scramjet::error_code::SCRAMJET_OK);
+}
+
+void coroutine_peer::message_awaiter::await_suspend(std::coroutine_handle<> handle) noexcept
+{
+	m_handle = handle;
+	m_peer->m_message_waiter = this;
+}
+
+coroutine_message coroutine_peer::message_awaiter::await_resume(void) noexcept
+{
+	if (m_resumed) {
+		return m_message;
+	}
+
+	if (m_peer->m_queued_messages.empty()) {
+		return coroutine_message{m_peer->m_closed, nullptr, 0};
+	}
+
+	m_peer->m_current_message.swap(m_peer->m_queued_messages.front());
+	m_peer->m_queued_messages.pop_front();
+	return coroutine_message{scramjet::error_code::SCRAMJET_OK, m_peer->m_current_message.data(), m_peer->m_current_message.size()};
+}
+
+void coroutine_peer::message_received(enum error_code ec, const uint8_t* message, size_t message_length)
+{
+	if (ec != scramjet::error_code::SCRAMJET_OK) {
+		m_connection->disconnect();
+		connection_lost(ec);
+		return;
+	}
+
+	if (m_handshake_waiter != nullptr) {
+		handshake_awaiter* waiter = std::exchange(m_handshake_waiter, nullptr);
+		m_protocol.feed_frame(message, message_length);
+		protocol_event event;
+		if (!m_protocol.poll(event) || (event.type != PROTOCOL_EVENT_ESTABLISHED)) {
+			waiter->m_ec = scramjet::error_code::SCRAMJET_VERSION_MISMATCH;
+		}
+
+		waiter->m_handle.resume();
+		return;
+	}
+
+	m_protocol.feed_frame(message, message_length);
+	protocol_event event;
+	while (m_protocol.poll(event)) {
+		if (event.type == PROTOCOL_EVENT_RESPONSE) {
+			response_received(event.request_id, event.data, event.length);
+		} else if (event.type == PROTOCOL_EVENT_MESSAGE) {
+			message_delivered(event.data, event.length);
+		}
+	}
+}
+
+void coroutine_peer::message_delivered(const uint8_t* message, size_t message_length)
+{
+	if (m_message_waiter != nullptr) {
+		message_awaiter* waiter = std::exchange(m_message_waiter, nullptr);
+		waiter->m_resumed = true;
+		waiter->m_message = coroutine_message{scramjet::error_code::SCRAMJET_OK, message, message_length};
+		waiter->m_handle.resume();
+		return;
+	}
+
+	m_queued_messages.emplace_back(message, message + message_length);
+}
+
+void coroutine_peer::response_received(uint32_t request_id, const uint8_t* payload, size_t payload_length)
+{
+	request_slot* slot = m_requests.find(request_id);
+	if (slot == nullptr) {
+		return;
+	}
+
+	response_callback_t callback = std::move(slot->callback);
+	m_requests.erase(*slot);
+	if (callback != nullptr) {
+		callback(scramjet::error_code::SCRAMJET_OK, payload, payload_length);
+	}
+}
+
+void coroutine_peer::disconnect(void) noexcept
+{
+	if (!m_strand.running_in_this_thread()) {
+		boost::asio::post(m_strand, std::bind(&coroutine_peer::disconnect, this));
+		return;
+	}
+
+	m_connection->disconnect();
+	connection_lost(scramjet::error_code::SCRAMJET_OPERATION_ABORTED);
+}
+
+void coroutine_peer::connection_lost(enum error_code ec)
+{
+	m_closed = ec;
+	for (uint32_t i = 0; (m_requests.size() > 0) && (i < m_requests.slot_count()); i++) {
+		request_slot& slot = m_requests.at(i);
+		if (!slot.pending) {
+			continue;
+		}
+
+		response_callback_t callback = std::move(slot.callback);
+		m_requests.erase(slot);
+		if (callback != nullptr) {
+			callback(ec, nullptr, 0);
+		}
+	}
+
+	if (m_handshake_waiter != nullptr) {
+		handshake_awaiter* waiter = std::exchange(m_handshake_waiter, nullptr);
+		waiter->m_ec = ec;
+		waiter->m_handle.resume();
+	}
+
+	if (m_message_waiter != nullptr) {
+		message_awaiter* waiter = std::exchange(m_message_waiter, nullptr);
+		waiter->m_resumed = true;
+		waiter->m_message = coroutine_message{ec, nullptr, 0};
+		waiter->m_handle.resume();
+	}
+}
+
+} // namespace scramjet
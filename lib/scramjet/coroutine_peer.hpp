@@ -0,0 +1,191 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCRAMJET__COROUTINE_PEER_HPP
+#define SCRAMJET__COROUTINE_PEER_HPP
+
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "scramjet/coroutine_task.hpp"
+#include "scramjet/error_code.hpp"
+#include "scramjet/jet_connection.hpp"
+#include "scramjet/jet_protocol.hpp"
+#include "scramjet/request_table.hpp"
+#include "scramjet/timer_wheel.hpp"
+
+namespace scramjet {
+
+// Payloads point into the receive buffer (or a copy owned by the peer)
+// and stay valid until the awaiting coroutine suspends again.
+struct coroutine_message {
+	enum error_code ec;
+	const uint8_t* payload;
+	size_t payload_length;
+};
+
+// Coroutine counterpart of jet_peer. Coroutines are started on the
+// connection's strand by spawn() and resumed there by the connection, so
+// awaiting never hops threads.
+class coroutine_peer final {
+public:
+	explicit coroutine_peer(std::unique_ptr<jet_connection> c) noexcept;
+	~coroutine_peer() noexcept;
+
+	coroutine_peer(const coroutine_peer&) = delete;
+	coroutine_peer& operator=(const coroutine_peer&) = delete;
+
+	class connect_awaiter final {
+	public:
+		bool await_ready(void) const noexcept
+		{
+			return false;
+		}
+
+		void await_suspend(std::coroutine_handle<> handle) noexcept;
+
+		enum error_code await_resume(void) const noexcept
+		{
+			return m_ec;
+		}
+
+	private:
+		friend class coroutine_peer;
+
+		coroutine_peer* m_peer;
+		std::chrono::milliseconds m_timeout;
+		std::coroutine_handle<> m_handle;
+		enum error_code m_ec;
+	};
+
+	class handshake_awaiter final {
+	public:
+		bool await_ready(void) const noexcept
+		{
+			return false;
+		}
+
+		void await_suspend(std::coroutine_handle<> handle) noexcept;
+
+		enum error_code await_resume(void) const noexcept
+		{
+			return m_ec;
+		}
+
+	private:
+		friend class coroutine_peer;
+
+		coroutine_peer* m_peer;
+		std::coroutine_handle<> m_handle;
+		enum error_code m_ec;
+	};
+
+	class request_awaiter final {
+	public:
+		bool await_ready(void) const noexcept
+		{
+			return false;
+		}
+
+		void await_suspend(std::coroutine_handle<> handle) noexcept;
+
+		coroutine_message await_resume(void) const noexcept
+		{
+			return m_response;
+		}
+
+	private:
+		friend class coroutine_peer;
+
+		coroutine_peer* m_peer;
+		const uint8_t* m_payload;
+		size_t m_payload_length;
+		std::chrono::milliseconds m_timeout;
+		std::coroutine_handle<> m_handle;
+		coroutine_message m_response;
+	};
+
+	class message_awaiter final {
+	public:
+		bool await_ready(void) const noexcept;
+		void await_suspend(std::coroutine_handle<> handle) noexcept;
+		coroutine_message await_resume(void) noexcept;
+
+	private:
+		friend class coroutine_peer;
+
+		coroutine_peer* m_peer;
+		std::coroutine_handle<> m_handle;
+		bool m_resumed;
+		coroutine_message m_message;
+	};
+
+	void spawn(coroutine_task<> task) noexcept;
+
+	connect_awaiter connect(std::chrono::milliseconds timeout) noexcept;
+	handshake_awaiter handshake(void) noexcept;
+	request_awaiter request(const uint8_t* payload, size_t payload_length, std::chrono::milliseconds timeout) noexcept;
+	// Messages other than responses, in order of arrival. Messages arriving
+	// while nobody awaits are copied and queued.
+	message_awaiter next_message(void) noexcept;
+	void disconnect(void) noexcept;
+
+	coroutine_frame_pool& get_frame_pool(void) noexcept;
+	strand_t& get_strand(void) noexcept;
+
+private:
+	std::unique_ptr<jet_connection> m_connection;
+	coroutine_frame_pool m_frame_pool;
+	request_table m_requests;
+	uint32_t m_next_request_id;
+	timer_wheel& m_timer_wheel;
+	strand_t& m_strand;
+	enum error_code m_closed;
+	handshake_awaiter* m_handshake_waiter;
+	jet_protocol m_protocol;
+	message_awaiter* m_message_waiter;
+	std::deque<std::vector<uint8_t>> m_queued_messages;
+	std::vector<uint8_t> m_current_message;
+
+	void start_request(request_awaiter& awaiter);
+	void request_sent(uint32_t slot_index, enum error_code ec);
+	void request_timed_out(uint32_t slot_index, uint32_t request_id);
+	void message_received(enum error_code ec, const uint8_t* message, size_t message_length);
+	void response_received(uint32_t request_id, const uint8_t* payload, size_t payload_length);
+	void message_delivered(const uint8_t* message, size_t message_length);
+	void connection_lost(enum error_code ec);
+};
+
+} // namespace scramjet
+
+#endif
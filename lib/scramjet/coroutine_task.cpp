@@ -0,0 +1,108 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+#include "scramjet/coroutine_task.hpp"
+
+namespace scramjet {
+
+coroutine_frame_pool::coroutine_frame_pool() noexcept
+{
+	m_free.fill(nullptr);
+}
+
+coroutine_frame_pool::~coroutine_frame_pool() noexcept
+{
+	for (free_frame* frame : m_free) {
+		while (frame != nullptr) {
+			free_frame* next = frame->next;
+			::operator delete(frame);
+			frame = next;
+		}
+	}
+}
+
+void* coroutine_frame_pool::allocate(std::size_t size)
+{
+	std::size_t size_class = (sizeof(frame_header) + size - 1) / GRANULARITY;
+	if (size_class >= SIZE_CLASSES) {
+		return allocate_unpooled(size);
+	}
+
+	void* memory = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		free_frame* frame = m_free[size_class];
+		if (frame != nullptr) {
+			m_free[size_class] = frame->next;
+			memory = frame;
+		}
+	}
+
+	if (memory == nullptr) {
+		memory = ::operator new((size_class + 1) * GRANULARITY);
+	}
+
+	frame_header* header = static_cast<frame_header*>(memory);
+	header->pool = this;
+	header->size_class = size_class;
+	return header + 1;
+}
+
+void* coroutine_frame_pool::allocate_unpooled(std::size_t size)
+{
+	frame_header* header = static_cast<frame_header*>(::operator new(sizeof(frame_header) + size));
+	header->pool = nullptr;
+	header->size_class = 0;
+	return header + 1;
+}
+
+void coroutine_frame_pool::deallocate(void* frame) noexcept
+{
+	frame_header* header = static_cast<frame_header*>(frame) - 1;
+	if (header->pool == nullptr) {
+		::operator delete(header);
+		return;
+	}
+
+	header->pool->release(header);
+}
+
+void coroutine_frame_pool::release(frame_header* header) noexcept
+{
+	std::size_t size_class = header->size_class;
+	free_frame* frame = reinterpret_cast<free_frame*>(header);
+	std::lock_guard<std::mutex> lock(m_mutex);
+	frame->next = m_free[size_class];
+	m_free[size_class] = frame;
+}
+
+} // namespace scramjet
@@ -0,0 +1,247 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCRAMJET__COROUTINE_TASK_HPP
+#define SCRAMJET__COROUTINE_TASK_HPP
+
+#include <array>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <utility>
+
+namespace scramjet {
+
+// Recycles coroutine frames by size class. Frames remember their pool, so
+// a pool must outlive every coroutine allocated from it.
+class coroutine_frame_pool final {
+public:
+	coroutine_frame_pool() noexcept;
+	~coroutine_frame_pool() noexcept;
+
+	coroutine_frame_pool(const coroutine_frame_pool&) = delete;
+	coroutine_frame_pool& operator=(const coroutine_frame_pool&) = delete;
+
+	void* allocate(std::size_t size);
+	static void* allocate_unpooled(std::size_t size);
+	static void deallocate(void* frame) noexcept;
+
+private:
+	static const std::size_t GRANULARITY = 64;
+	static const std::size_t SIZE_CLASSES = 32;
+
+	struct alignas(std::max_align_t) frame_header {
+		coroutine_frame_pool* pool;
+		std::size_t size_class;
+	};
+
+	struct free_frame {
+		free_frame* next;
+	};
+
+	std::mutex m_mutex;
+	std::array<free_frame*, SIZE_CLASSES> m_free;
+
+	void release(frame_header* header) noexcept;
+};
+
+class coroutine_peer;
+
+coroutine_frame_pool& get_frame_pool(coroutine_peer& peer) noexcept;
+
+namespace detail {
+
+// Coroutines taking a coroutine_peer& as first parameter, or as second
+// parameter of a member function, get their frame from the peer's pool.
+struct pooled_promise {
+	template <typename... Args>
+	static void* operator new(std::size_t size, coroutine_peer& peer, Args&...)
+	{
+		return get_frame_pool(peer).allocate(size);
+	}
+
+	template <typename Object, typename... Args>
+	static void* operator new(std::size_t size, Object&, coroutine_peer& peer, Args&...)
+	{
+		return get_frame_pool(peer).allocate(size);
+	}
+
+	static void* operator new(std::size_t size)
+	{
+		return coroutine_frame_pool::allocate_unpooled(size);
+	}
+
+	static void operator delete(void* frame, std::size_t) noexcept
+	{
+		coroutine_frame_pool::deallocate(frame);
+	}
+};
+
+struct task_promise_base : pooled_promise {
+	std::coroutine_handle<> continuation;
+	std::exception_ptr exception;
+
+	struct final_awaiter {
+		bool await_ready(void) const noexcept
+		{
+			return false;
+		}
+
+		template <typename Promise>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+		{
+			std::coroutine_handle<> continuation = handle.promise().continuation;
+			if (continuation) {
+				return continuation;
+			}
+
+			return std::noop_coroutine();
+		}
+
+		void await_resume(void) const noexcept
+		{
+		}
+	};
+
+	std::suspend_always initial_suspend(void) const noexcept
+	{
+		return {};
+	}
+
+	final_awaiter final_suspend(void) const noexcept
+	{
+		return {};
+	}
+
+	void unhandled_exception(void) noexcept
+	{
+		exception = std::current_exception();
+	}
+};
+
+template <typename T>
+struct task_promise : task_promise_base {
+	T value;
+
+	void return_value(T v)
+	{
+		value = std::move(v);
+	}
+
+	T result(void)
+	{
+		if (exception) {
+			std::rethrow_exception(exception);
+		}
+
+		return std::move(value);
+	}
+};
+
+template <>
+struct task_promise<void> : task_promise_base {
+	void return_void(void) const noexcept
+	{
+	}
+
+	void result(void)
+	{
+		if (exception) {
+			std::rethrow_exception(exception);
+		}
+	}
+};
+
+} // namespace detail
+
+// A lazily started coroutine, resumed by whoever co_awaits it.
+template <typename T = void>
+class [[nodiscard]] coroutine_task final {
+public:
+	struct promise_type : detail::task_promise<T> {
+		coroutine_task get_return_object(void) noexcept
+		{
+			return coroutine_task(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+	};
+
+	coroutine_task(coroutine_task&& other) noexcept
+	        : m_handle(std::exchange(other.m_handle, nullptr))
+	{
+	}
+
+	coroutine_task& operator=(coroutine_task&& other) noexcept
+	{
+		if (this != &other) {
+			if (m_handle) {
+				m_handle.destroy();
+			}
+
+			m_handle = std::exchange(other.m_handle, nullptr);
+		}
+
+		return *this;
+	}
+
+	~coroutine_task() noexcept
+	{
+		if (m_handle) {
+			m_handle.destroy();
+		}
+	}
+
+	bool await_ready(void) const noexcept
+	{
+		return !m_handle || m_handle.done();
+	}
+
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept
+	{
+		m_handle.promise().continuation = continuation;
+		return m_handle;
+	}
+
+	T await_resume(void)
+	{
+		return m_handle.promise().result();
+	}
+
+private:
+	explicit coroutine_task(std::coroutine_handle<promise_type> handle) noexcept
+	        : m_handle(handle)
+	{
+	}
+
+	std::coroutine_handle<promise_type> m_handle;
+};
+
+} // namespace scramjet
+
+#endif
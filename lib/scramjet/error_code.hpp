@@ -40,6 +40,12 @@ enum error_code {
 	SCRAMJET_HOST_NOT_FOUND,
 	SCRAMJET_CONNECTION_REFUSED,
 	SCRAMJET_WRONG_MESSAGE_FORMAT,
+	SCRAMJET_CONNECTION_CLOSED,
+	SCRAMJET_REQUEST_TIMEOUT,
+	SCRAMJET_SEND_QUEUE_FULL,
+	SCRAMJET_SUPERSEDED,
+	SCRAMJET_FRAME_TOO_LARGE,
+	SCRAMJET_VERSION_MISMATCH,
 };
 
 } // namespace scramjet
@@ -0,0 +1,194 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCRAMJET__FRAME_CODEC_HPP
+#define SCRAMJET__FRAME_CODEC_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+
+#include <boost/endian/conversion.hpp>
+
+namespace scramjet {
+
+template <typename T, bool IsEnum = std::is_enum<T>::value>
+struct frame_field {
+	typedef typename std::underlying_type<T>::type storage_type;
+};
+
+template <typename T>
+struct frame_field<T, false> {
+	static_assert(std::is_integral<T>::value, "frame fields must be integral or enumeration types");
+	typedef T storage_type;
+};
+
+template <typename T>
+inline T load_little(const uint8_t* buffer) noexcept
+{
+	typename frame_field<T>::storage_type value;
+	std::memcpy(&value, buffer, sizeof(value));
+	return static_cast<T>(boost::endian::little_to_native(value));
+}
+
+template <typename T>
+inline void store_little(uint8_t* buffer, T value) noexcept
+{
+	typename frame_field<T>::storage_type little = boost::endian::native_to_little(static_cast<typename frame_field<T>::storage_type>(value));
+	std::memcpy(buffer, &little, sizeof(little));
+}
+
+template <typename... Fields>
+struct frame_size;
+
+template <>
+struct frame_size<> : std::integral_constant<std::size_t, 0> {
+};
+
+template <typename Field, typename... Fields>
+struct frame_size<Field, Fields...> : std::integral_constant<std::size_t, sizeof(Field) + frame_size<Fields...>::value> {
+};
+
+template <std::size_t Index, typename... Fields>
+struct frame_offset;
+
+template <typename Field, typename... Fields>
+struct frame_offset<0, Field, Fields...> : std::integral_constant<std::size_t, 0> {
+};
+
+template <std::size_t Index, typename Field, typename... Fields>
+struct frame_offset<Index, Field, Fields...> : std::integral_constant<std::size_t, sizeof(Field) + frame_offset<Index - 1, Fields...>::value> {
+};
+
+template <typename... Fields>
+struct frame_writer;
+
+template <>
+struct frame_writer<> {
+	static void write(uint8_t*) noexcept
+	{
+	}
+};
+
+template <typename Field, typename... Fields>
+struct frame_writer<Field, Fields...> {
+	static void write(uint8_t* buffer, Field value, Fields... values) noexcept
+	{
+		store_little<Field>(buffer, value);
+		frame_writer<Fields...>::write(buffer + sizeof(Field), values...);
+	}
+};
+
+template <typename... Fields>
+class frame final {
+public:
+	template <std::size_t Index>
+	using field_type = typename std::tuple_element<Index, std::tuple<Fields...>>::type;
+
+	static constexpr std::size_t size(void) noexcept
+	{
+		return frame_size<Fields...>::value;
+	}
+
+	template <std::size_t Index>
+	static constexpr std::size_t offset(void) noexcept
+	{
+		return frame_offset<Index, Fields...>::value;
+	}
+
+	class view final {
+	public:
+		view() noexcept
+		        : m_data(nullptr)
+		        , m_length(0)
+		{
+		}
+
+		template <std::size_t Index>
+		field_type<Index> get(void) const noexcept
+		{
+			return load_little<field_type<Index>>(m_data + offset<Index>());
+		}
+
+		const uint8_t* payload(void) const noexcept
+		{
+			return m_data + size();
+		}
+
+		std::size_t payload_length(void) const noexcept
+		{
+			return m_length - size();
+		}
+
+	private:
+		friend class frame;
+
+		view(const uint8_t* data, std::size_t length) noexcept
+		        : m_data(data)
+		        , m_length(length)
+		{
+		}
+
+		const uint8_t* m_data;
+		std::size_t m_length;
+	};
+
+	static bool decode(const uint8_t* buffer, std::size_t length, view& v) noexcept
+	{
+		if ((buffer == nullptr) || (length < size())) {
+			return false;
+		}
+
+		v = view(buffer, length);
+		return true;
+	}
+
+	static std::size_t encode(uint8_t* buffer, std::size_t length, Fields... values) noexcept
+	{
+		if ((buffer == nullptr) || (length < size())) {
+			return 0;
+		}
+
+		frame_writer<Fields...>::write(buffer, values...);
+		return size();
+	}
+
+	static std::array<uint8_t, frame_size<Fields...>::value> to_bytes(Fields... values) noexcept
+	{
+		std::array<uint8_t, frame_size<Fields...>::value> bytes;
+		frame_writer<Fields...>::write(bytes.data(), values...);
+		return bytes;
+	}
+};
+
+} // namespace scramjet
+
+#endif
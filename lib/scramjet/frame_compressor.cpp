@@ -0,0 +1,202 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#if defined(SCRAMJET_HAS_COMPRESSION)
+#include <zlib.h>
+#endif
+
+#include "scramjet/frame_codec.hpp"
+#include "scramjet/frame_compressor.hpp"
+#include "scramjet/message_frames.hpp"
+#include "scramjet/message_type.hpp"
+
+namespace scramjet {
+
+#if defined(SCRAMJET_HAS_COMPRESSION)
+
+// Deflate finds matches in the dictionary cheapest near its end, so the
+// most common tokens come last.
+static const char dictionary[] =
+        "\"authenticate\"\"config\"\"info\"\"unfetch\"\"fetch\"\"remove\"\"add\"\"call\""
+        "\"caseInsensitive\"\"contains\"\"startsWith\"\"equals\"\"equalsNot\"\"lessThan\"\"greaterThan\""
+        "\"error\":{\"code\":-32602,\"message\":\"Invalid params\",\"data\":"
+        "\"event\":\"add\"\"event\":\"remove\"\"event\":\"change\","
+        "true,false,null,0.0,1.0,-1,[0,1,2,3,4,5,6,7,8,9],"
+        "{\"jsonrpc\":\"2.0\",\"result\":true,\"id\":"
+        "{\"jsonrpc\":\"2.0\",\"method\":\"change\",\"params\":{\"path\":\""
+        "{\"jsonrpc\":\"2.0\",\"method\":\"set\",\"params\":{\"path\":\""
+        "\",\"value\":";
+
+struct frame_compressor::streams {
+	z_stream deflater;
+	z_stream inflater;
+	bool deflater_ready = false;
+	bool inflater_ready = false;
+
+	~streams() noexcept
+	{
+		if (deflater_ready) {
+			deflateEnd(&deflater);
+		}
+
+		if (inflater_ready) {
+			inflateEnd(&inflater);
+		}
+	}
+};
+
+frame_compressor::frame_compressor(int level) noexcept
+        : m_level(level)
+{
+}
+
+frame_compressor::~frame_compressor() noexcept
+{
+}
+
+bool frame_compressor::is_available(void) noexcept
+{
+	return true;
+}
+
+bool frame_compressor::compress(const uint8_t* message, size_t message_length, std::vector<uint8_t>& out) noexcept
+{
+	// Anything not smaller than the original is of no use.
+	if ((message_length <= compressed_frame_t::size()) || (message_length > UINT32_MAX)) {
+		return false;
+	}
+
+	try {
+		if (m_streams == nullptr) {
+			m_streams.reset(new streams());
+		}
+
+		z_stream& z = m_streams->deflater;
+		if (!m_streams->deflater_ready) {
+			std::memset(&z, 0, sizeof(z));
+			if (deflateInit2(&z, m_level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+				return false;
+			}
+			m_streams->deflater_ready = true;
+		} else if (deflateReset(&z) != Z_OK) {
+			return false;
+		}
+
+		if (deflateSetDictionary(&z, reinterpret_cast<const Bytef*>(dictionary), sizeof(dictionary) - 1) != Z_OK) {
+			return false;
+		}
+
+		size_t limit = message_length - compressed_frame_t::size();
+		out.resize(compressed_frame_t::size() + limit);
+		compressed_frame_t::encode(out.data(), out.size(), message_type::MESSAGE_COMPRESSED, static_cast<uint32_t>(message_length));
+
+		z.next_in = const_cast<Bytef*>(message);
+		z.avail_in = static_cast<uInt>(message_length);
+		z.next_out = &out[compressed_frame_t::size()];
+		z.avail_out = static_cast<uInt>(limit);
+		if (deflate(&z, Z_FINISH) != Z_STREAM_END) {
+			return false;
+		}
+
+		out.resize(compressed_frame_t::size() + (limit - z.avail_out));
+		return true;
+	} catch (...) {
+		return false;
+	}
+}
+
+bool frame_compressor::decompress(const uint8_t* data, size_t data_length, uint8_t* message, size_t message_length) noexcept
+{
+	try {
+		if (m_streams == nullptr) {
+			m_streams.reset(new streams());
+		}
+
+		z_stream& z = m_streams->inflater;
+		if (!m_streams->inflater_ready) {
+			std::memset(&z, 0, sizeof(z));
+			if (inflateInit2(&z, -15) != Z_OK) {
+				return false;
+			}
+			m_streams->inflater_ready = true;
+		} else if (inflateReset(&z) != Z_OK) {
+			return false;
+		}
+
+		if (inflateSetDictionary(&z, reinterpret_cast<const Bytef*>(dictionary), sizeof(dictionary) - 1) != Z_OK) {
+			return false;
+		}
+
+		z.next_in = const_cast<Bytef*>(data);
+		z.avail_in = static_cast<uInt>(data_length);
+		z.next_out = message;
+		z.avail_out = static_cast<uInt>(message_length);
+		return (inflate(&z, Z_FINISH) == Z_STREAM_END) && (z.avail_out == 0) && (z.avail_in == 0);
+	} catch (...) {
+		return false;
+	}
+}
+
+#else
+
+struct frame_compressor::streams {
+};
+
+frame_compressor::frame_compressor(int level) noexcept
+        : m_level(level)
+{
+}
+
+frame_compressor::~frame_compressor() noexcept
+{
+}
+
+bool frame_compressor::is_available(void) noexcept
+{
+	return false;
+}
+
+bool frame_compressor::compress(const uint8_t*, size_t, std::vector<uint8_t>&) noexcept
+{
+	return false;
+}
+
+bool frame_compressor::decompress(const uint8_t*, size_t, uint8_t*, size_t) noexcept
+{
+	return false;
+}
+
+#endif
+
+} // namespace scramjet
@@ -0,0 +1,71 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCRAMJET__FRAME_COMPRESSOR_HPP
+#define SCRAMJET__FRAME_COMPRESSOR_HPP
+
+#include <cstdbool>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+namespace scramjet {
+
+// Raw deflate with a preset dictionary of common Jet JSON tokens. The
+// zlib streams are set up on first use and reset for every frame.
+class frame_compressor final {
+public:
+	explicit frame_compressor(int level = DEFAULT_LEVEL) noexcept;
+	~frame_compressor() noexcept;
+
+	frame_compressor(const frame_compressor&) = delete;
+	frame_compressor& operator=(const frame_compressor&) = delete;
+
+	// Encodes message as a MESSAGE_COMPRESSED frame into out. Returns
+	// false if that is not smaller than message or zlib is unavailable.
+	bool compress(const uint8_t* message, size_t message_length, std::vector<uint8_t>& out) noexcept;
+
+	// Inflates the payload of a MESSAGE_COMPRESSED frame into message,
+	// which must hold exactly the original length.
+	bool decompress(const uint8_t* data, size_t data_length, uint8_t* message, size_t message_length) noexcept;
+
+	static bool is_available(void) noexcept;
+
+	static const int DEFAULT_LEVEL = 6;
+
+private:
+	struct streams;
+
+	int m_level;
+	std::unique_ptr<streams> m_streams;
+};
+
+} // namespace scramjet
+
+#endif
@@ -0,0 +1,159 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCRAMJET__HANDLER_ALLOCATOR_HPP
+#define SCRAMJET__HANDLER_ALLOCATOR_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace scramjet {
+
+class handler_memory final {
+public:
+	explicit handler_memory(std::size_t size = DEFAULT_SIZE)
+	        : m_storage(new max_align_t[(size + sizeof(max_align_t) - 1) / sizeof(max_align_t)])
+	        , m_size(size)
+	        , m_in_use(false)
+	{
+	}
+
+	handler_memory(const handler_memory&) = delete;
+	handler_memory& operator=(const handler_memory&) = delete;
+
+	void* allocate(std::size_t size)
+	{
+		if ((size <= m_size) && !m_in_use.exchange(true, std::memory_order_acquire)) {
+			return m_storage.get();
+		}
+
+		return ::operator new(size);
+	}
+
+	void deallocate(void* pointer) noexcept
+	{
+		if (pointer == m_storage.get()) {
+			m_in_use.store(false, std::memory_order_release);
+		} else {
+			::operator delete(pointer);
+		}
+	}
+
+	static const std::size_t DEFAULT_SIZE = 256;
+
+private:
+	typedef std::max_align_t max_align_t;
+
+	std::unique_ptr<max_align_t[]> m_storage;
+	std::size_t m_size;
+	std::atomic<bool> m_in_use;
+};
+
+template <typename T>
+class handler_allocator {
+public:
+	typedef T value_type;
+
+	explicit handler_allocator(handler_memory& memory) noexcept
+	        : m_memory(&memory)
+	{
+	}
+
+	template <typename U>
+	handler_allocator(const handler_allocator<U>& other) noexcept
+	        : m_memory(other.m_memory)
+	{
+	}
+
+	T* allocate(std::size_t n) const
+	{
+		return static_cast<T*>(m_memory->allocate(sizeof(T) * n));
+	}
+
+	void deallocate(T* pointer, std::size_t) const noexcept
+	{
+		m_memory->deallocate(pointer);
+	}
+
+	bool operator==(const handler_allocator& other) const noexcept
+	{
+		return m_memory == other.m_memory;
+	}
+
+	bool operator!=(const handler_allocator& other) const noexcept
+	{
+		return m_memory != other.m_memory;
+	}
+
+private:
+	template <typename>
+	friend class handler_allocator;
+
+	handler_memory* m_memory;
+};
+
+template <typename Handler>
+class alloc_handler {
+public:
+	typedef handler_allocator<Handler> allocator_type;
+
+	alloc_handler(handler_memory& memory, Handler handler)
+	        : m_memory(memory)
+	        , m_handler(std::move(handler))
+	{
+	}
+
+	allocator_type get_allocator(void) const noexcept
+	{
+		return allocator_type(m_memory);
+	}
+
+	template <typename... Args>
+	void operator()(Args&&... args)
+	{
+		m_handler(std::forward<Args>(args)...);
+	}
+
+private:
+	handler_memory& m_memory;
+	Handler m_handler;
+};
+
+template <typename Handler>
+inline alloc_handler<typename std::decay<Handler>::type> make_alloc_handler(handler_memory& memory, Handler&& handler)
+{
+	return alloc_handler<typename std::decay<Handler>::type>(memory, std::forward<Handler>(handler));
+}
+
+} // namespace scramjet
+
+#endif
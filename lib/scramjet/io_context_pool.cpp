@@ -0,0 +1,134 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+
+#include "scramjet/io_context_pool.hpp"
+
+namespace scramjet {
+
+io_context_pool::io_context_pool(std::size_t thread_count, bool pin_threads)
+        : m_next(0)
+        , m_pin_threads(pin_threads)
+{
+	if (thread_count == 0) {
+		thread_count = std::max(1U, std::thread::hardware_concurrency());
+	}
+
+	for (std::size_t i = 0; i < thread_count; i++) {
+		m_io_contexts.emplace_back(new boost::asio::io_context(1));
+		m_work_guards.emplace_back(boost::asio::make_work_guard(*m_io_contexts.back()));
+	}
+}
+
+io_context_pool::~io_context_pool() noexcept
+{
+	stop();
+	join();
+}
+
+boost::asio::io_context& io_context_pool::get_io_context(void) noexcept
+{
+	std::size_t index = m_next.fetch_add(1, std::memory_order_relaxed);
+	return *m_io_contexts[index % m_io_contexts.size()];
+}
+
+boost::asio::io_context& io_context_pool::get_io_context(std::size_t index) noexcept
+{
+	return *m_io_contexts[index % m_io_contexts.size()];
+}
+
+std::size_t io_context_pool::size(void) const noexcept
+{
+	return m_io_contexts.size();
+}
+
+void io_context_pool::run(void)
+{
+	unsigned int cpu_count = std::max(1U, std::thread::hardware_concurrency());
+	for (std::size_t i = 0; i < m_io_contexts.size(); i++) {
+		boost::asio::io_context* ioc = m_io_contexts[i].get();
+		m_threads.emplace_back([ioc]() {
+			ioc->run();
+		});
+
+		if (m_pin_threads) {
+			pin_thread(m_threads.back(), i % cpu_count);
+		}
+	}
+}
+
+void io_context_pool::stop(void) noexcept
+{
+	for (work_guard_t& guard : m_work_guards) {
+		guard.reset();
+	}
+
+	for (std::unique_ptr<boost::asio::io_context>& ioc : m_io_contexts) {
+		ioc->stop();
+	}
+}
+
+void io_context_pool::join(void) noexcept
+{
+	for (std::thread& thread : m_threads) {
+		if (thread.joinable()) {
+			thread.join();
+		}
+	}
+
+	m_threads.clear();
+}
+
+void io_context_pool::pin_thread(std::thread& thread, std::size_t cpu) noexcept
+{
+#if defined(__linux__)
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	CPU_SET(cpu, &cpu_set);
+	pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set), &cpu_set);
+#else
+	(void)thread;
+	(void)cpu;
+#endif
+}
+
+} // namespace scramjet
@@ -0,0 +1,74 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCRAMJET__IO_CONTEXT_POOL_HPP
+#define SCRAMJET__IO_CONTEXT_POOL_HPP
+
+#include <atomic>
+#include <cstdbool>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+
+namespace scramjet {
+
+class io_context_pool final {
+public:
+	explicit io_context_pool(std::size_t thread_count = 0, bool pin_threads = true);
+	~io_context_pool() noexcept;
+
+	io_context_pool(const io_context_pool&) = delete;
+	io_context_pool& operator=(const io_context_pool&) = delete;
+
+	boost::asio::io_context& get_io_context(void) noexcept;
+	boost::asio::io_context& get_io_context(std::size_t index) noexcept;
+	std::size_t size(void) const noexcept;
+
+	void run(void);
+	void stop(void) noexcept;
+	void join(void) noexcept;
+
+private:
+	typedef boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work_guard_t;
+
+	std::vector<std::unique_ptr<boost::asio::io_context>> m_io_contexts;
+	std::vector<work_guard_t> m_work_guards;
+	std::vector<std::thread> m_threads;
+	std::atomic<std::size_t> m_next;
+	bool m_pin_threads;
+
+	static void pin_thread(std::thread& thread, std::size_t cpu) noexcept;
+};
+
+} // namespace scramjet
+
+#endif
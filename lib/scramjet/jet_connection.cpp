@@ -26,10 +26,148 @@
  * SOFTWARE.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+
 #include "scramjet/jet_connection.hpp"
+#include "scramjet/receive_buffer.hpp"
+#include "scramjet/statistics.hpp"
 
 namespace scramjet {
 
 jet_connection::~jet_connection() noexcept {}
 
+const connection_counters& jet_connection::get_counters(void) const noexcept
+{
+	return m_counters;
+}
+
+void jet_connection::set_watermarks(std::size_t high_watermark, std::size_t low_watermark) noexcept
+{
+	m_high_watermark = high_watermark;
+	m_low_watermark = std::min(low_watermark, high_watermark);
+}
+
+void jet_connection::set_flow_control_callbacks(const flow_control_callback_t& on_congested, const flow_control_callback_t& on_writable) noexcept
+{
+	m_on_congested = on_congested;
+	m_on_writable = on_writable;
+}
+
+std::size_t jet_connection::get_queued_bytes(void) const noexcept
+{
+	return m_queued_bytes.load(std::memory_order_relaxed);
+}
+
+bool jet_connection::is_congested(void) const noexcept
+{
+	return m_congested.load(std::memory_order_acquire);
+}
+
+void jet_connection::bytes_queued(std::size_t length) noexcept
+{
+	std::size_t queued = m_queued_bytes.fetch_add(length, std::memory_order_relaxed) + length;
+	if ((m_high_watermark > 0) && (queued >= m_high_watermark) && !m_congested.exchange(true, std::memory_order_acq_rel)) {
+		if (m_on_congested != nullptr) {
+			m_on_congested();
+		}
+	}
+}
+
+void jet_connection::bytes_drained(std::size_t length) noexcept
+{
+	std::size_t queued = m_queued_bytes.load(std::memory_order_relaxed);
+	std::size_t remaining;
+	do {
+		remaining = queued - std::min(queued, length);
+	} while (!m_queued_bytes.compare_exchange_weak(queued, remaining, std::memory_order_relaxed));
+
+	if ((remaining <= m_low_watermark) && m_congested.exchange(false, std::memory_order_acq_rel)) {
+		if (m_on_writable != nullptr) {
+			m_on_writable();
+		}
+	}
+}
+
+void jet_connection::set_max_frame_size(std::size_t max_frame_size) noexcept
+{
+	m_max_frame_size = max_frame_size;
+}
+
+std::size_t jet_connection::get_max_frame_size(void) const noexcept
+{
+	return m_max_frame_size;
+}
+
+void jet_connection::set_fragmented_delivery(std::size_t threshold, const fragment_received_callback_t& callback) noexcept
+{
+	m_fragment_threshold = threshold;
+	m_fragment_received_callback = callback;
+}
+
+bool jet_connection::supports_compression(void) const noexcept
+{
+	return false;
+}
+
+void jet_connection::set_compression_threshold(std::size_t threshold) noexcept
+{
+	m_compression_threshold = threshold;
+}
+
+enum jet_connection::frame_action jet_connection::next_frame_action(receive_buffer& buffer) noexcept
+{
+	if (!m_receiving_fragments) {
+		std::size_t frame_length;
+		if (!buffer.frame_length(frame_length)) {
+			return FRAME_INCOMPLETE;
+		}
+
+		if (frame_length > m_max_frame_size) {
+			return FRAME_TOO_LARGE;
+		}
+
+		if ((m_fragment_threshold == 0) || (frame_length <= m_fragment_threshold) || (m_fragment_received_callback == nullptr)) {
+			return (buffer.bytes_missing() == 0) ? FRAME_WHOLE : FRAME_INCOMPLETE;
+		}
+
+		buffer.consume(sizeof(uint32_t));
+		m_receiving_fragments = true;
+		m_fragment_offset = 0;
+		m_fragment_length = frame_length;
+	}
+
+	const uint8_t* data;
+	std::size_t length = std::min(buffer.peek(data), m_fragment_length - m_fragment_offset);
+	if (length == 0) {
+		return FRAME_INCOMPLETE;
+	}
+
+	std::size_t offset = m_fragment_offset;
+	m_fragment_offset += length;
+	if (m_fragment_offset == m_fragment_length) {
+		m_receiving_fragments = false;
+		counter_add(m_counters.frames_received, 1);
+	}
+
+	m_fragment_received_callback(SCRAMJET_OK, data, length, offset, m_fragment_length);
+	buffer.consume(length);
+	return FRAME_FRAGMENTED;
+}
+
+bool jet_connection::is_receiving_fragments(void) const noexcept
+{
+	return m_receiving_fragments;
+}
+
+void jet_connection::abort_fragments(enum error_code ec) noexcept
+{
+	if (m_receiving_fragments) {
+		m_receiving_fragments = false;
+		m_fragment_received_callback(ec, nullptr, 0, m_fragment_offset, m_fragment_length);
+	}
+}
+
 }
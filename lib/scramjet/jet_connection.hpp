@@ -29,32 +29,117 @@
 #ifndef SCRAMJET__JET_CONNECTION_HPP
 #define SCRAMJET__JET_CONNECTION_HPP
 
+#include <atomic>
 #include <chrono>
 #include <cstdbool>
 #include <cstdint>
 #include <cstdlib>
-#include <functional>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/strand.hpp>
 
 #include "scramjet/error_code.hpp"
+#include "scramjet/message_frames.hpp"
+#include "scramjet/receive_buffer.hpp"
+#include "scramjet/small_function.hpp"
+#include "scramjet/statistics.hpp"
 
 namespace scramjet {
 
-typedef std::function<void(enum error_code ec)> connected_callback_t;
-typedef std::function<void(enum error_code ec)> disconnected_callback_t;
-typedef std::function<void(enum error_code ec, const uint8_t *message, size_t message_length)> message_received_callback_t;
+typedef small_function<void(enum error_code ec)> connected_callback_t;
+typedef small_function<void(enum error_code ec)> disconnected_callback_t;
+typedef small_function<void(enum error_code ec, const uint8_t *message, size_t message_length)> message_received_callback_t;
+typedef small_function<void(enum error_code ec)> message_sent_callback_t;
+typedef small_function<void(void)> flow_control_callback_t;
+typedef small_function<void(enum error_code ec, const uint8_t *fragment, size_t fragment_length, size_t frame_offset, size_t frame_length)> fragment_received_callback_t;
+typedef boost::asio::strand<boost::asio::io_context::executor_type> strand_t;
 
 class jet_connection {
 public:
 	virtual ~jet_connection() noexcept = 0;
 	virtual void connect(const connected_callback_t& connect_callback, std::chrono::milliseconds timeout) noexcept = 0;
 	virtual void disconnect(void) noexcept = 0;
-	virtual void receive_message(const message_received_callback_t callback) noexcept = 0;
+	virtual void receive_message(const message_received_callback_t& callback) noexcept = 0;
+	virtual message_ref retain_message(void) noexcept = 0;
+	virtual boost::asio::io_context& get_io_context(void) noexcept = 0;
+	virtual strand_t& get_strand(void) noexcept = 0;
+	virtual void send_message(const uint8_t* message, size_t message_length, const message_sent_callback_t& callback) noexcept = 0;
+
+	const connection_counters& get_counters(void) const noexcept;
+
+	// Bytes handed to send_message() whose completion has not been
+	// reported yet. Crossing the high watermark calls on_congested, falling
+	// back to the low watermark calls on_writable. A high watermark of 0
+	// disables flow control. Configure before connecting. Queueing and
+	// draining may happen on different threads, the count and the
+	// congestion state are updated atomically and each crossing calls its
+	// callback once.
+	void set_watermarks(std::size_t high_watermark, std::size_t low_watermark) noexcept;
+	void set_flow_control_callbacks(const flow_control_callback_t& on_congested, const flow_control_callback_t& on_writable) noexcept;
+	std::size_t get_queued_bytes(void) const noexcept;
+	bool is_congested(void) const noexcept;
+
+	// A received frame longer than max_frame_size fails the connection with
+	// SCRAMJET_FRAME_TOO_LARGE as soon as its length prefix is read, before
+	// any buffer grows for it.
+	void set_max_frame_size(std::size_t max_frame_size) noexcept;
+	std::size_t get_max_frame_size(void) const noexcept;
+
+	// Frames longer than threshold bypass the message callback and are
+	// handed to the fragment callback piece by piece as they arrive, so
+	// they are never buffered whole. The last fragment ends at
+	// frame_length. If the connection fails within such a frame, the
+	// fragment callback gets the error first. A threshold of 0 disables
+	// fragmented delivery. Configure before receiving.
+	void set_fragmented_delivery(std::size_t threshold, const fragment_received_callback_t& callback) noexcept;
+
+	// Transports that support it inflate received MESSAGE_COMPRESSED
+	// frames and, with a threshold above 0, send frames longer than the
+	// threshold compressed when that makes them smaller. Only set a
+	// threshold after the far end accepted CAPABILITY_COMPRESSION; frames
+	// taking the fragmented delivery path are handed on as received.
+	virtual bool supports_compression(void) const noexcept;
+	void set_compression_threshold(std::size_t threshold) noexcept;
 
 protected:
 	connected_callback_t m_connected_callback = nullptr;
 	std::chrono::milliseconds m_connect_timeout = std::chrono::milliseconds(0);
 
 	message_received_callback_t m_message_received_callback = nullptr;
+	connection_counters m_counters;
+	std::size_t m_compression_threshold = 0;
+
+	void bytes_queued(std::size_t length) noexcept;
+	void bytes_drained(std::size_t length) noexcept;
+
+	enum frame_action {
+		FRAME_WHOLE,
+		FRAME_FRAGMENTED,
+		FRAME_INCOMPLETE,
+		FRAME_TOO_LARGE,
+	};
+
+	// Looks at the next frame in buffer. Fragments of frames above the
+	// threshold are delivered and consumed here (FRAME_FRAGMENTED), whole
+	// frames are left to next_message().
+	enum frame_action next_frame_action(receive_buffer& buffer) noexcept;
+	bool is_receiving_fragments(void) const noexcept;
+	void abort_fragments(enum error_code ec) noexcept;
+
+private:
+	std::size_t m_high_watermark = 0;
+	std::size_t m_low_watermark = 0;
+	std::atomic<std::size_t> m_queued_bytes{0};
+	std::atomic<bool> m_congested{false};
+	flow_control_callback_t m_on_congested = nullptr;
+	flow_control_callback_t m_on_writable = nullptr;
+
+	std::size_t m_max_frame_size = DEFAULT_MAX_FRAME_SIZE;
+	std::size_t m_fragment_threshold = 0;
+	fragment_received_callback_t m_fragment_received_callback = nullptr;
+	std::size_t m_fragment_offset = 0;
+	std::size_t m_fragment_length = 0;
+	bool m_receiving_fragments = false;
 };
 } // namespace scramjet
 
@@ -0,0 +1,93 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstdbool>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "scramjet/jet_message.hpp"
+#include "scramjet/json_view.hpp"
+
+namespace scramjet {
+
+static bool key_is(const json_value& key, const char* name, size_t name_length) noexcept
+{
+	return key.equals(name, name_length);
+}
+
+bool jet_message::is_notification(void) const noexcept
+{
+	return method.is_valid() && !id.is_valid();
+}
+
+bool jet_message::is_response(void) const noexcept
+{
+	return id.is_valid() && !method.is_valid() && (result.is_valid() || error.is_valid());
+}
+
+bool jet_message::parse(const uint8_t* payload, size_t payload_length, jet_message& message) noexcept
+{
+	message = jet_message();
+	json_value root = json_value::parse(payload, payload_length);
+	if (root.type() != JSON_OBJECT) {
+		return false;
+	}
+
+	json_member_iterator members(root);
+	json_value key;
+	json_value value;
+	while (members.next(key, value)) {
+		if (key_is(key, "id", 2)) {
+			message.id = value;
+		} else if (key_is(key, "method", 6)) {
+			message.method = value;
+		} else if (key_is(key, "params", 6)) {
+			message.params = value;
+		} else if (key_is(key, "result", 6)) {
+			message.result = value;
+		} else if (key_is(key, "error", 5)) {
+			message.error = value;
+		}
+	}
+
+	json_member_iterator params(message.params);
+	while (params.next(key, value)) {
+		if (key_is(key, "path", 4)) {
+			message.path = value;
+		} else if (key_is(key, "event", 5)) {
+			message.event = value;
+		} else if (key_is(key, "value", 5)) {
+			message.value = value;
+		}
+	}
+
+	return true;
+}
+
+} // namespace scramjet
@@ -26,26 +26,71 @@
  * SOFTWARE.
  */
 
+#include <algorithm>
 #include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <cmath>
 #include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <functional>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
 
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include "scramjet/frame_codec.hpp"
+#include "scramjet/handler_allocator.hpp"
 #include "scramjet/jet_connection.hpp"
 #include "scramjet/jet_peer.hpp"
+#include "scramjet/jet_protocol.hpp"
+#include "scramjet/message_batch.hpp"
+#include "scramjet/message_frames.hpp"
 #include "scramjet/message_type.hpp"
 #include "scramjet/protocol_version.hpp"
+#include "scramjet/request_table.hpp"
+#include "scramjet/statistics.hpp"
+#include "scramjet/timer_wheel.hpp"
 
 
 namespace scramjet {
 
-static protocol_version supported_version(1, 0, 0);
 
 jet_peer::jet_peer(std::unique_ptr<jet_connection> c) noexcept
         : m_connection(std::move(c))
 		, m_connected_callback(nullptr)
+        , m_next_request_id(0)
+        , m_timer_wheel(boost::asio::use_service<timer_wheel>(m_connection->get_io_context()))
+        , m_strand(m_connection->get_strand())
+        , m_connect_timeout(0)
+        , m_established(false)
+        , m_closing(false)
+        , m_optimistic(false)
+        , m_version_assumed(false)
+        , m_assumed_version(jet_protocol::supported_version())
+        , m_confirming(false)
+        , m_reconnect_enabled(false)
+        , m_reconnect_pending(false)
+        , m_backoff(0)
+        , m_random(static_cast<std::minstd_rand::result_type>(std::chrono::steady_clock::now().time_since_epoch().count()))
+        , m_reconnect_generation(0)
+        , m_on_congested(nullptr)
+        , m_on_writable(nullptr)
+        , m_flush_armed(false)
+        , m_compression_threshold(0)
+        , m_protocol(nullptr, 0)
+        , m_batching(false)
+        , m_batch_bytes(0)
+        , m_batch_timer(m_connection->get_io_context())
+        , m_batch_generation(0)
 {
 }
 
@@ -55,75 +100,912 @@ jet_peer::~jet_peer() noexcept
 
 void jet_peer::connect(const connected_callback_t& connect_callback, std::chrono::milliseconds timeout) noexcept
 {
+	if (!m_strand.running_in_this_thread()) {
+		boost::asio::post(m_strand, std::bind(&jet_peer::connect, this, connect_callback, timeout));
+		return;
+	}
+
 	m_connected_callback = connect_callback;
+	m_connect_timeout = timeout;
+	m_closing = false;
+	m_backoff = m_reconnect_options.initial_delay;
+	start_connect();
+}
+
+void jet_peer::start_connect(void)
+{
+	if (m_connects.load(std::memory_order_relaxed) > 0) {
+		counter_add(m_reconnects, 1);
+	}
+
+	counter_add(m_connects, 1);
+	m_connect_started = std::chrono::steady_clock::now();
 
 	using namespace std::placeholders;
-	m_connection->connect(std::bind(&jet_peer::connected, this, _1), timeout);
+	m_connection->connect(std::bind(&jet_peer::connected, this, _1), m_connect_timeout);
 }
 
 void jet_peer::connected(scramjet::error_code ec)
 {
+	m_connection->set_compression_threshold(0);
+	m_protocol.reset();
+	bool compress = (m_compression_threshold > 0) && m_connection->supports_compression();
+	m_protocol.set_capabilities(compress ? CAPABILITY_COMPRESSION : 0);
+	m_confirming = false;
+	m_unconfirmed.clear();
+	if (ec == scramjet::error_code::SCRAMJET_OK) {
+		m_handshake_started = std::chrono::steady_clock::now();
+		m_connect_time.record(m_handshake_started - m_connect_started);
+	}
+
 	if (m_connected_callback != nullptr) {
 		m_connected_callback(ec);
 	}
 
 	if (ec != scramjet::error_code::SCRAMJET_OK) {
 		std::cerr << "Connection not established!" << std::endl;
+		schedule_reconnect();
 		return;
 	}
 
+	if (m_optimistic && m_version_assumed && m_assumed_version.is_compatible(jet_protocol::supported_version())) {
+		// The daemon sends its version frame before any response, so
+		// nothing sent now is answered before the version is checked.
+		m_confirming = true;
+		m_established = true;
+		replay_registrations();
+		flush_states();
+	}
+
 	using namespace std::placeholders;
 	m_connection->receive_message(std::bind(&jet_peer::version_received, this, _1, _2, _3));
 }
 
 void jet_peer::disconnect(void) noexcept
 {
+    if (!m_strand.running_in_this_thread()) {
+        boost::asio::post(m_strand, std::bind(&jet_peer::disconnect, this));
+        return;
+    }
+
+    m_closing = true;
+    m_established = false;
+    m_reconnect_pending = false;
+    m_reconnect_generation++;
+    m_reconnect_timer.cancel();
+    abort_batch(scramjet::error_code::SCRAMJET_OPERATION_ABORTED);
     m_connection->disconnect();
+    fail_requests(scramjet::error_code::SCRAMJET_OPERATION_ABORTED);
+    fail_parked(scramjet::error_code::SCRAMJET_OPERATION_ABORTED);
 }
 
-static bool is_correct_protocol_version(const uint8_t* buffer, size_t buffer_length)
+void jet_peer::connection_lost(enum error_code ec)
 {
-    uint8_t message_type;
-    if (buffer_length != sizeof(message_type) + protocol_version::get_version_size()) {
-        return false;
-    }
+	m_established = false;
+	abort_batch(ec);
+	fail_requests(ec);
+	m_connection->disconnect();
+	schedule_reconnect();
+}
 
-    message_type = *buffer;
-    buffer++;
-    if (message_type != scramjet::message_type::MESSAGE_API_VERSION) {
-        return false;
-    }
-    protocol_version v(buffer);
-    v.print();
-    return v.is_compatible(supported_version);
+void jet_peer::enable_reconnect(const reconnect_options& options) noexcept
+{
+	if (!m_strand.running_in_this_thread()) {
+		boost::asio::post(m_strand, std::bind(&jet_peer::enable_reconnect, this, options));
+		return;
+	}
+
+	m_reconnect_enabled = true;
+	m_reconnect_options = options;
+	m_backoff = options.initial_delay;
+}
+
+void jet_peer::disable_reconnect(void) noexcept
+{
+	if (!m_strand.running_in_this_thread()) {
+		boost::asio::post(m_strand, std::bind(&jet_peer::disable_reconnect, this));
+		return;
+	}
+
+	m_reconnect_enabled = false;
+	m_reconnect_pending = false;
+	m_reconnect_generation++;
+	m_reconnect_timer.cancel();
+}
+
+void jet_peer::schedule_reconnect(void)
+{
+	if (m_closing || !m_reconnect_enabled || m_reconnect_pending) {
+		return;
+	}
+
+	double delay = static_cast<double>(m_backoff.count());
+	double jitter = std::min(std::max(m_reconnect_options.jitter, 0.0), 1.0);
+	std::uniform_real_distribution<double> spread(1.0 - jitter, 1.0);
+	std::chrono::milliseconds timeout(static_cast<std::chrono::milliseconds::rep>(delay * spread(m_random)));
+
+	double next = delay * std::max(m_reconnect_options.multiplier, 1.0);
+	m_backoff = std::chrono::milliseconds(static_cast<std::chrono::milliseconds::rep>(std::min(next, static_cast<double>(m_reconnect_options.max_delay.count()))));
+
+	m_reconnect_pending = true;
+	uint64_t generation = ++m_reconnect_generation;
+	m_timer_wheel.schedule(m_reconnect_timer, timeout, [this, generation]() {
+		boost::asio::post(m_strand, std::bind(&jet_peer::reconnect_timer_expired, this, generation));
+	});
+}
+
+void jet_peer::reconnect_timer_expired(uint64_t generation)
+{
+	if (generation != m_reconnect_generation) {
+		return;
+	}
+
+	m_reconnect_pending = false;
+	start_connect();
+}
+
+void jet_peer::enable_optimistic_handshake(void) noexcept
+{
+	enable_optimistic_handshake(jet_protocol::supported_version());
+}
+
+void jet_peer::enable_optimistic_handshake(const protocol_version& assumed) noexcept
+{
+	if (!m_strand.running_in_this_thread()) {
+		boost::asio::post(m_strand, [this, assumed]() {
+			enable_optimistic_handshake(assumed);
+		});
+		return;
+	}
+
+	m_optimistic = true;
+	if (!m_version_assumed) {
+		m_version_assumed = true;
+		m_assumed_version = assumed;
+	}
+}
+
+void jet_peer::disable_optimistic_handshake(void) noexcept
+{
+	if (!m_strand.running_in_this_thread()) {
+		boost::asio::post(m_strand, std::bind(&jet_peer::disable_optimistic_handshake, this));
+		return;
+	}
+
+	m_optimistic = false;
+}
+
+void jet_peer::enable_compression(std::size_t threshold) noexcept
+{
+	if (!m_strand.running_in_this_thread()) {
+		boost::asio::post(m_strand, std::bind(&jet_peer::enable_compression, this, threshold));
+		return;
+	}
+
+	m_compression_threshold = threshold;
+}
+
+void jet_peer::disable_compression(void) noexcept
+{
+	enable_compression(0);
+}
+
+void jet_peer::enable_batching(const batching_options& options) noexcept
+{
+	if (!m_strand.running_in_this_thread()) {
+		boost::asio::post(m_strand, std::bind(&jet_peer::enable_batching, this, options));
+		return;
+	}
+
+	m_batching = true;
+	m_batching_options = options;
+}
+
+void jet_peer::disable_batching(void) noexcept
+{
+	if (!m_strand.running_in_this_thread()) {
+		boost::asio::post(m_strand, std::bind(&jet_peer::disable_batching, this));
+		return;
+	}
+
+	m_batching = false;
+	flush_batch();
+}
+
+void jet_peer::add_to_batch(uint32_t slot_index, size_t frame_length)
+{
+	size_t entry_length = sizeof(uint32_t) + frame_length;
+	if (!m_batch_slots.empty() && (m_batch_bytes + entry_length > m_batching_options.max_bytes)) {
+		flush_batch();
+	}
+
+	m_batch_slots.push_back(slot_index);
+	m_batch_bytes += entry_length;
+	if (m_batch_bytes >= m_batching_options.max_bytes) {
+		flush_batch();
+		return;
+	}
+
+	if (m_batch_slots.size() > 1) {
+		return;
+	}
+
+	uint64_t generation = m_batch_generation;
+	if (m_batching_options.window.count() == 0) {
+		boost::asio::post(m_strand, make_alloc_handler(m_batch_handler_memory, std::bind(&jet_peer::batch_window_expired, this, generation)));
+		return;
+	}
+
+	m_batch_timer.expires_after(m_batching_options.window);
+	m_batch_timer.async_wait(boost::asio::bind_executor(m_strand, make_alloc_handler(m_batch_handler_memory, [this, generation](const boost::system::error_code& ec) {
+		if (ec != boost::asio::error::operation_aborted) {
+			batch_window_expired(generation);
+		}
+	})));
+}
+
+void jet_peer::batch_window_expired(uint64_t generation)
+{
+	if (generation == m_batch_generation) {
+		flush_batch();
+	}
+}
+
+void jet_peer::flush_batch(void)
+{
+	m_batch_generation++;
+	m_batch_timer.cancel();
+	if (m_batch_slots.empty()) {
+		return;
+	}
+
+	m_batch_bytes = 0;
+	if (m_batch_slots.size() == 1) {
+		uint32_t slot_index = m_batch_slots.front();
+		m_batch_slots.clear();
+		request_slot& slot = m_requests.at(slot_index);
+		m_connection->send_message(slot.frame.data(), slot.frame.size(), [this, slot_index](enum error_code send_ec) {
+			request_sent(slot_index, send_ec);
+		});
+		return;
+	}
+
+	if (m_spare_batches.empty()) {
+		m_batches_in_flight.emplace_back();
+	} else {
+		m_batches_in_flight.push_back(std::move(m_spare_batches.back()));
+		m_spare_batches.pop_back();
+	}
+
+	outgoing_batch& batch = m_batches_in_flight.back();
+	batch.slots.swap(m_batch_slots);
+	batch_writer writer(batch.frame);
+	writer.clear();
+	for (uint32_t slot_index : batch.slots) {
+		const request_slot& slot = m_requests.at(slot_index);
+		writer.append(slot.frame.data(), slot.frame.size());
+	}
+
+	counter_add(m_batch_count, 1);
+	// Sends complete in order, so the completion belongs to the oldest batch.
+	m_connection->send_message(batch.frame.data(), batch.frame.size(), [this](enum error_code send_ec) {
+		batch_sent(send_ec);
+	});
+}
+
+void jet_peer::batch_sent(enum error_code ec)
+{
+	outgoing_batch batch = std::move(m_batches_in_flight.front());
+	m_batches_in_flight.pop_front();
+	for (uint32_t slot_index : batch.slots) {
+		request_sent(slot_index, ec);
+	}
+
+	batch.slots.clear();
+	m_spare_batches.push_back(std::move(batch));
+}
+
+void jet_peer::abort_batch(enum error_code ec)
+{
+	m_batch_generation++;
+	m_batch_timer.cancel();
+	m_batch_bytes = 0;
+
+	std::vector<uint32_t> slots;
+	slots.swap(m_batch_slots);
+	for (uint32_t slot_index : slots) {
+		request_sent(slot_index, ec);
+	}
 }
 
 void jet_peer::version_received(enum error_code ec, const uint8_t* message, size_t message_length)
 {
 	if (ec != scramjet::error_code::SCRAMJET_OK) {
-			disconnect();
+			connection_lost(ec);
 			return;
 	}
 
-	std::cout << "Got message of length: " << message_length << std::endl;
-
-	if (!is_correct_protocol_version(message, message_length)) {
+	m_protocol.feed_frame(message, message_length);
+	protocol_event event;
+	if (!m_protocol.poll(event) || (event.type != PROTOCOL_EVENT_ESTABLISHED)) {
 			std::cerr << "protocol API version not supported!" << std::endl;
+			version_mismatch();
+			connection_lost(scramjet::error_code::SCRAMJET_VERSION_MISMATCH);
 			return;
 	}
-	
+
+	m_handshake_time.record(std::chrono::steady_clock::now() - m_handshake_started);
+	m_version_assumed = true;
+	m_assumed_version = jet_protocol::supported_version();
+	m_backoff = m_reconnect_options.initial_delay;
+	send_protocol_output();
+	if ((event.capabilities & CAPABILITY_COMPRESSION) != 0) {
+		// The daemon inflates frames sent after the answer and starts to
+		// compress its own once it read it.
+		m_connection->set_compression_threshold(m_compression_threshold);
+	}
+
 	using namespace std::placeholders;
 	m_connection->receive_message(std::bind(&jet_peer::message_received, this, _1, _2, _3));
+	if (m_confirming) {
+		m_confirming = false;
+		m_unconfirmed.clear();
+		return;
+	}
+
+	m_established = true;
+	replay_registrations();
+	flush_states();
+}
+
+void jet_peer::send_protocol_output(void)
+{
+	const uint8_t* output;
+	std::size_t output_length = m_protocol.pending_output(output);
+	if (output_length <= jet_protocol::LENGTH_PREFIX_SIZE) {
+		return;
+	}
+
+	// The connection writes the length prefix itself. The bytes stay in
+	// m_protocol until the next handshake.
+	m_connection->send_message(output + jet_protocol::LENGTH_PREFIX_SIZE, output_length - jet_protocol::LENGTH_PREFIX_SIZE, nullptr);
+	m_protocol.consume_output(output_length);
+}
+
+void jet_peer::version_mismatch(void)
+{
+	m_version_assumed = false;
+	m_established = false;
+	if (!m_confirming) {
+		return;
+	}
+
+	m_confirming = false;
+	std::vector<unconfirmed_request> unconfirmed;
+	unconfirmed.swap(m_unconfirmed);
+	for (const unconfirmed_request& r : unconfirmed) {
+		request_slot& slot = m_requests.at(r.slot_index);
+		if (!slot.pending || (slot.id != r.id)) {
+			continue;
+		}
+
+		response_callback_t callback = std::move(slot.callback);
+		m_requests.erase(slot);
+		if (callback != nullptr) {
+			callback(scramjet::error_code::SCRAMJET_VERSION_MISMATCH, nullptr, 0);
+		}
+	}
 }
 
 void jet_peer::message_received(enum error_code ec, const uint8_t* message, size_t message_length)
 {
     if (ec != scramjet::error_code::SCRAMJET_OK) {
-        disconnect();
+        connection_lost(ec);
         return;
     }
 
-	(void)message;
-	std::cout << "Got message of length: " << message_length << std::endl;
+	m_protocol.feed_frame(message, message_length);
+	protocol_event event;
+	while (m_protocol.poll(event)) {
+		if (event.type == PROTOCOL_EVENT_RESPONSE) {
+			response_received(event.request_id, event.data, event.length);
+		}
+	}
+}
+
+void jet_peer::request(const uint8_t* payload, size_t payload_length, const response_callback_t& callback, std::chrono::milliseconds timeout) noexcept
+{
+	if (!m_strand.running_in_this_thread()) {
+		// A thread running the connection's io_context may be the only one
+		// able to drain the queue, it must not wait for that.
+		bool blocking = (m_flow_control.policy == OVERFLOW_BLOCK) &&
+		                !m_connection->get_io_context().get_executor().running_in_this_thread();
+		if (blocking) {
+			wait_writable(payload_length);
+		}
+
+		std::shared_ptr<std::vector<uint8_t>> copy = std::make_shared<std::vector<uint8_t>>(payload, payload + payload_length);
+		boost::asio::post(m_strand, [this, copy, callback, timeout, blocking]() {
+			if (blocking) {
+				posted_request_done(copy->size());
+			}
+			request(copy->data(), copy->size(), callback, timeout);
+		});
+		return;
+	}
+
+	if ((m_flow_control.policy == OVERFLOW_REJECT) && m_connection->is_congested()) {
+		if (callback != nullptr) {
+			callback(scramjet::error_code::SCRAMJET_SEND_QUEUE_FULL, nullptr, 0);
+		}
+		return;
+	}
+
+	send_request(payload, payload_length, callback, timeout);
+}
+
+void jet_peer::send_request(const uint8_t* payload, size_t payload_length, const response_callback_t& callback, std::chrono::milliseconds timeout)
+{
+	uint32_t id = m_next_request_id++;
+	while (m_requests.find(id) != nullptr) {
+		id = m_next_request_id++;
+	}
+
+	request_slot& slot = m_requests.insert(id);
+	slot.callback = callback;
+	slot.sending = true;
+	slot.started = std::chrono::steady_clock::now();
+	counter_add(m_request_count, 1);
+
+	slot.frame.resize(request_frame_t::size() + payload_length);
+	request_frame_t::encode(slot.frame.data(), slot.frame.size(), scramjet::message_type::MESSAGE_REQUEST, id);
+	if (payload_length > 0) {
+		std::memcpy(&slot.frame[request_frame_t::size()], payload, payload_length);
+	}
+
+	uint32_t slot_index = slot.index;
+	uint32_t request_id = slot.id;
+	if (m_confirming) {
+		m_unconfirmed.push_back(unconfirmed_request{slot_index, request_id});
+	}
+
+	m_timer_wheel.schedule(slot.timeout, timeout, [this, slot_index, request_id]() {
+		boost::asio::post(m_strand, std::bind(&jet_peer::request_timed_out, this, slot_index, request_id));
+	});
+	if (m_batching) {
+		add_to_batch(slot_index, slot.frame.size());
+		return;
+	}
+
+	m_connection->send_message(slot.frame.data(), slot.frame.size(), [this, slot_index](enum error_code send_ec) {
+		request_sent(slot_index, send_ec);
+	});
+}
+
+void jet_peer::request_sent(uint32_t slot_index, enum error_code ec)
+{
+	request_slot& slot = m_requests.at(slot_index);
+	response_callback_t callback = nullptr;
+	if ((ec != scramjet::error_code::SCRAMJET_OK) && slot.pending) {
+		callback = std::move(slot.callback);
+		m_requests.erase(slot);
+	}
+
+	m_requests.sent(slot_index);
+	if (callback != nullptr) {
+		callback(ec, nullptr, 0);
+	}
+}
+
+void jet_peer::response_received(uint32_t request_id, const uint8_t* payload, size_t payload_length)
+{
+	request_slot* slot = m_requests.find(request_id);
+	if (slot == nullptr) {
+		return;
+	}
+
+	std::chrono::steady_clock::time_point received = std::chrono::steady_clock::now();
+	m_round_trip_time.record(received - slot->started);
+	counter_add(m_response_count, 1);
+
+	response_callback_t callback = std::move(slot->callback);
+	m_requests.erase(*slot);
+	if (callback != nullptr) {
+		callback(scramjet::error_code::SCRAMJET_OK, payload, payload_length);
+		m_callback_time.record(std::chrono::steady_clock::now() - received);
+	}
+}
+
+void jet_peer::request_timed_out(uint32_t slot_index, uint32_t request_id)
+{
+	request_slot& slot = m_requests.at(slot_index);
+	if (!slot.pending || (slot.id != request_id)) {
+		return;
+	}
+
+	counter_add(m_timeouts, 1);
+	response_callback_t callback = std::move(slot.callback);
+	m_requests.erase(slot);
+	if (callback != nullptr) {
+		callback(scramjet::error_code::SCRAMJET_REQUEST_TIMEOUT, nullptr, 0);
+	}
+}
+
+registration_id_t jet_peer::add_registration(const uint8_t* payload, size_t payload_length, const response_callback_t& callback, std::chrono::milliseconds timeout) noexcept
+{
+	registration_id_t id = m_next_registration_id.fetch_add(1, std::memory_order_relaxed) + 1;
+	if (!m_strand.running_in_this_thread()) {
+		std::shared_ptr<std::vector<uint8_t>> copy = std::make_shared<std::vector<uint8_t>>(payload, payload + payload_length);
+		boost::asio::post(m_strand, [this, id, copy, callback, timeout]() {
+			insert_registration(id, copy->data(), copy->size(), callback, timeout);
+		});
+		return id;
+	}
+
+	insert_registration(id, payload, payload_length, callback, timeout);
+	return id;
+}
+
+void jet_peer::insert_registration(registration_id_t id, const uint8_t* payload, size_t payload_length, const response_callback_t& callback, std::chrono::milliseconds timeout)
+{
+	registration& r = m_registrations[id];
+	r.payload.assign(payload, payload + payload_length);
+	r.callback = callback;
+	r.timeout = timeout;
+	if (m_established) {
+		send_registration(id, r);
+	}
+}
+
+void jet_peer::remove_registration(registration_id_t id) noexcept
+{
+	if (!m_strand.running_in_this_thread()) {
+		boost::asio::post(m_strand, std::bind(&jet_peer::remove_registration, this, id));
+		return;
+	}
+
+	m_registrations.erase(id);
+}
+
+void jet_peer::send_registration(registration_id_t id, const registration& r)
+{
+	send_request(r.payload.data(), r.payload.size(), [this, id](enum error_code ec, const uint8_t* message, size_t message_length) {
+		registration_response(id, ec, message, message_length);
+	},
+	        r.timeout);
+}
+
+void jet_peer::registration_response(registration_id_t id, enum error_code ec, const uint8_t* message, size_t message_length)
+{
+	auto it = m_registrations.find(id);
+	if ((it == m_registrations.end()) || (it->second.callback == nullptr)) {
+		return;
+	}
+
+	// The callback may remove its own registration.
+	response_callback_t callback = it->second.callback;
+	callback(ec, message, message_length);
+}
+
+void jet_peer::replay_registrations(void)
+{
+	// All requests are queued before the connection gets to flush, so the
+	// whole registry leaves in one pipelined batch of writes.
+	for (const auto& entry : m_registrations) {
+		send_registration(entry.first, entry.second);
+	}
+}
+
+void jet_peer::set_flow_control(const flow_control_options& options, const flow_control_callback_t& on_congested, const flow_control_callback_t& on_writable) noexcept
+{
+	m_flow_control = options;
+	m_on_congested = on_congested;
+	m_on_writable = on_writable;
+	m_connection->set_watermarks(options.high_watermark, options.low_watermark);
+	m_connection->set_flow_control_callbacks(std::bind(&jet_peer::send_queue_congested, this), std::bind(&jet_peer::send_queue_writable, this));
+}
+
+bool jet_peer::is_congested(void) const noexcept
+{
+	return m_connection->is_congested();
+}
+
+void jet_peer::wait_writable(size_t payload_length)
+{
+	std::unique_lock<std::mutex> lock(m_writable_mutex);
+	m_writable_condition.wait(lock, [this]() {
+		return (m_flow_control.high_watermark == 0) ||
+		       (!m_connection->is_congested() && (m_posted_bytes.load(std::memory_order_relaxed) < m_flow_control.high_watermark));
+	});
+	m_posted_bytes.fetch_add(payload_length, std::memory_order_relaxed);
+}
+
+void jet_peer::posted_request_done(size_t payload_length)
+{
+	// Requests still waiting for the strand count against the high
+	// watermark too, otherwise producers could outrun the strand.
+	std::size_t posted = m_posted_bytes.fetch_sub(payload_length, std::memory_order_relaxed);
+	if ((posted >= m_flow_control.high_watermark) && (posted - payload_length < m_flow_control.high_watermark)) {
+		notify_writable();
+	}
+}
+
+void jet_peer::notify_writable(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_writable_mutex);
+	}
+	m_writable_condition.notify_all();
+}
+
+void jet_peer::send_queue_congested(void)
+{
+	if (m_on_congested != nullptr) {
+		m_on_congested();
+	}
+}
+
+void jet_peer::send_queue_writable(void)
+{
+	if (m_flow_control.policy == OVERFLOW_BLOCK) {
+		notify_writable();
+	}
+
+	flush_parked();
+	flush_states();
+	if (m_on_writable != nullptr) {
+		m_on_writable();
+	}
+}
+
+void jet_peer::publish(const std::string& path, const uint8_t* payload, size_t payload_length, const response_callback_t& callback, std::chrono::milliseconds timeout) noexcept
+{
+	if (m_flow_control.policy != OVERFLOW_COALESCE) {
+		request(payload, payload_length, callback, timeout);
+		return;
+	}
+
+	if (!m_strand.running_in_this_thread()) {
+		std::shared_ptr<std::vector<uint8_t>> copy = std::make_shared<std::vector<uint8_t>>(payload, payload + payload_length);
+		boost::asio::post(m_strand, [this, path, copy, callback, timeout]() {
+			publish(path, copy->data(), copy->size(), callback, timeout);
+		});
+		return;
+	}
+
+	if (m_connection->is_congested()) {
+		park_publish(path, payload, payload_length, callback, timeout);
+		return;
+	}
+
+	send_request(payload, payload_length, callback, timeout);
+}
+
+void jet_peer::park_publish(const std::string& path, const uint8_t* payload, size_t payload_length, const response_callback_t& callback, std::chrono::milliseconds timeout)
+{
+	parked_publish& parked = m_parked[path];
+	response_callback_t superseded = std::move(parked.callback);
+	parked.payload.assign(payload, payload + payload_length);
+	parked.callback = callback;
+	parked.timeout = timeout;
+	if (superseded != nullptr) {
+		superseded(scramjet::error_code::SCRAMJET_SUPERSEDED, nullptr, 0);
+	}
+}
+
+void jet_peer::flush_parked(void)
+{
+	// Stops as soon as the queue congests again, the rest stays parked and
+	// keeps coalescing until the next on_writable.
+	while (!m_parked.empty() && !m_connection->is_congested()) {
+		auto it = m_parked.begin();
+		parked_publish parked = std::move(it->second);
+		m_parked.erase(it);
+		send_request(parked.payload.data(), parked.payload.size(), parked.callback, parked.timeout);
+	}
+}
+
+void jet_peer::fail_parked(enum error_code ec)
+{
+	std::map<std::string, parked_publish> parked;
+	parked.swap(m_parked);
+	for (auto& entry : parked) {
+		if (entry.second.callback != nullptr) {
+			entry.second.callback(ec, nullptr, 0);
+		}
+	}
+}
+
+state_handle_t jet_peer::add_state(const state_publish_options& options, const response_callback_t& callback, std::chrono::milliseconds timeout) noexcept
+{
+	std::lock_guard<std::mutex> lock(m_states_mutex);
+	state_handle_t handle;
+	if (!m_free_states.empty()) {
+		handle = m_free_states.back();
+		m_free_states.pop_back();
+	} else {
+		handle = static_cast<state_handle_t>(m_states.size());
+		m_states.emplace_back();
+	}
+
+	state_slot& slot = m_states[handle];
+	slot.options = options;
+	slot.callback = callback;
+	slot.timeout = timeout;
+	slot.pending.clear();
+	slot.pending_value = 0.0;
+	slot.sent_value = 0.0;
+	slot.in_use = true;
+	slot.dirty = false;
+	slot.sent = false;
+	return handle;
+}
+
+void jet_peer::remove_state(state_handle_t handle) noexcept
+{
+	std::lock_guard<std::mutex> lock(m_states_mutex);
+	if ((handle >= m_states.size()) || !m_states[handle].in_use) {
+		return;
+	}
+
+	state_slot& slot = m_states[handle];
+	slot.in_use = false;
+	slot.dirty = false;
+	slot.callback = nullptr;
+	m_free_states.push_back(handle);
+}
+
+void jet_peer::change_state(state_handle_t handle, const uint8_t* payload, size_t payload_length) noexcept
+{
+	std::lock_guard<std::mutex> lock(m_states_mutex);
+	if ((handle >= m_states.size()) || !m_states[handle].in_use) {
+		return;
+	}
+
+	state_slot& slot = m_states[handle];
+	counter_add(m_state_changes, 1);
+	slot.pending.assign(payload, payload + payload_length);
+	mark_state_dirty(handle, slot);
+}
+
+void jet_peer::change_state(state_handle_t handle, const uint8_t* payload, size_t payload_length, double value) noexcept
+{
+	std::lock_guard<std::mutex> lock(m_states_mutex);
+	if ((handle >= m_states.size()) || !m_states[handle].in_use) {
+		return;
+	}
+
+	state_slot& slot = m_states[handle];
+	counter_add(m_state_changes, 1);
+	bool significant = !slot.sent || (std::abs(value - slot.sent_value) >= slot.options.change_threshold);
+	if (!slot.dirty && !significant) {
+		return;
+	}
+
+	slot.pending.assign(payload, payload + payload_length);
+	slot.pending_value = value;
+	mark_state_dirty(handle, slot);
+}
+
+void jet_peer::mark_state_dirty(state_handle_t handle, state_slot& slot)
+{
+	if (slot.dirty) {
+		return;
+	}
+
+	slot.dirty = true;
+	m_dirty_states.push_back(handle);
+
+	std::chrono::steady_clock::time_point due = slot.sent ? (slot.sent_at + slot.options.min_interval) : std::chrono::steady_clock::time_point::min();
+	if (!m_flush_armed || (due < m_flush_due)) {
+		arm_flush(due);
+	}
+}
+
+void jet_peer::arm_flush(std::chrono::steady_clock::time_point due)
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	std::chrono::milliseconds delay(0);
+	if (due > now) {
+		delay = std::chrono::duration_cast<std::chrono::milliseconds>(due - now + std::chrono::milliseconds(1) - std::chrono::nanoseconds(1));
+	}
+
+	m_flush_armed = true;
+	m_flush_due = std::max(due, now);
+	m_timer_wheel.schedule(m_flush_timer, delay, [this]() {
+		boost::asio::post(m_strand, std::bind(&jet_peer::flush_states, this));
+	});
+}
+
+void jet_peer::flush_states(void)
+{
+	std::size_t count = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_states_mutex);
+		m_flush_armed = false;
+		if (!m_established || m_connection->is_congested()) {
+			// Kept dirty, the handshake or on_writable flushes them.
+			return;
+		}
+
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::time_point next_due = std::chrono::steady_clock::time_point::max();
+		std::size_t kept = 0;
+		for (state_handle_t handle : m_dirty_states) {
+			state_slot& slot = m_states[handle];
+			if (!slot.dirty) {
+				continue;
+			}
+
+			std::chrono::steady_clock::time_point due = slot.sent ? (slot.sent_at + slot.options.min_interval) : now;
+			if (due > now) {
+				m_dirty_states[kept++] = handle;
+				next_due = std::min(next_due, due);
+				continue;
+			}
+
+			if (count == m_state_updates.size()) {
+				m_state_updates.emplace_back();
+			}
+
+			// Swapping hands the slot the previous update's buffer, so
+			// steady state publishing does not allocate.
+			state_update& update = m_state_updates[count++];
+			update.payload.swap(slot.pending);
+			update.callback = slot.callback;
+			update.timeout = slot.timeout;
+			slot.dirty = false;
+			slot.sent = true;
+			slot.sent_at = now;
+			slot.sent_value = slot.pending_value;
+		}
+
+		m_dirty_states.resize(kept);
+		if (kept > 0) {
+			arm_flush(next_due);
+		}
+	}
+
+	counter_add(m_state_update_count, count);
+	for (std::size_t i = 0; i < count; i++) {
+		state_update& update = m_state_updates[i];
+		send_request(update.payload.data(), update.payload.size(), update.callback, update.timeout);
+		update.callback = nullptr;
+	}
+}
+
+jet_peer_statistics jet_peer::get_statistics(void) const
+{
+	jet_peer_statistics statistics;
+	statistics.connection = m_connection->get_counters().snapshot();
+	statistics.connects = m_connects.load(std::memory_order_relaxed);
+	statistics.reconnects = m_reconnects.load(std::memory_order_relaxed);
+	statistics.requests = m_request_count.load(std::memory_order_relaxed);
+	statistics.responses = m_response_count.load(std::memory_order_relaxed);
+	statistics.timeouts = m_timeouts.load(std::memory_order_relaxed);
+	statistics.state_changes = m_state_changes.load(std::memory_order_relaxed);
+	statistics.state_updates = m_state_update_count.load(std::memory_order_relaxed);
+	statistics.batches = m_batch_count.load(std::memory_order_relaxed);
+	statistics.connect_time = m_connect_time.snapshot();
+	statistics.handshake_time = m_handshake_time.snapshot();
+	statistics.round_trip_time = m_round_trip_time.snapshot();
+	statistics.callback_time = m_callback_time.snapshot();
+	return statistics;
+}
+
+void jet_peer::fail_requests(enum error_code ec)
+{
+	for (uint32_t i = 0; (m_requests.size() > 0) && (i < m_requests.slot_count()); i++) {
+		request_slot& slot = m_requests.at(i);
+		if (!slot.pending) {
+			continue;
+		}
+
+		response_callback_t callback = std::move(slot.callback);
+		m_requests.erase(slot);
+		if (callback != nullptr) {
+			callback(ec, nullptr, 0);
+		}
+	}
 }
 } // namespace scramjet
@@ -29,14 +29,95 @@
 #ifndef SCRAMJET__JET_PEER_HPP
 #define SCRAMJET__JET_PEER_HPP
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/asio/steady_timer.hpp>
 
 #include "scramjet/error_code.hpp"
+#include "scramjet/handler_allocator.hpp"
 #include "scramjet/jet_connection.hpp"
+#include "scramjet/jet_protocol.hpp"
+#include "scramjet/message_frames.hpp"
+#include "scramjet/protocol_version.hpp"
+#include "scramjet/request_table.hpp"
+#include "scramjet/statistics.hpp"
+#include "scramjet/timer_wheel.hpp"
 
 namespace scramjet {
 
+struct jet_peer_statistics {
+	connection_counters_snapshot connection;
+	uint64_t connects = 0;
+	uint64_t reconnects = 0;
+	uint64_t requests = 0;
+	uint64_t responses = 0;
+	uint64_t timeouts = 0;
+	uint64_t state_changes = 0;
+	uint64_t state_updates = 0;
+	uint64_t batches = 0;
+	histogram_snapshot connect_time;
+	histogram_snapshot handshake_time;
+	histogram_snapshot round_trip_time;
+	histogram_snapshot callback_time;
+};
+
+struct reconnect_options {
+	std::chrono::milliseconds initial_delay = std::chrono::milliseconds(100);
+	std::chrono::milliseconds max_delay = std::chrono::milliseconds(30000);
+	double multiplier = 2.0;
+	// Fraction of each delay that is randomised, spreading out the
+	// reconnects of many peers after a daemon restart.
+	double jitter = 0.5;
+};
+
+typedef uint64_t registration_id_t;
+typedef uint32_t state_handle_t;
+
+struct state_publish_options {
+	// Changes arriving within min_interval of the last update overwrite the
+	// pending one. With a change_threshold, values that moved less than the
+	// threshold since the last update do not cause a new one.
+	std::chrono::milliseconds min_interval = std::chrono::milliseconds(0);
+	double change_threshold = 0.0;
+};
+
+enum overflow_policy {
+	// Fail new requests with SCRAMJET_SEND_QUEUE_FULL.
+	OVERFLOW_REJECT,
+	// Block producers on other threads until the queue drained to the low
+	// watermark. Requests issued on a thread running the connection's
+	// io_context, on the strand or in any other handler, cannot block and
+	// are queued.
+	OVERFLOW_BLOCK,
+	// Park publish() calls and keep only the latest value per path, the
+	// replaced one completes with SCRAMJET_SUPERSEDED.
+	OVERFLOW_COALESCE,
+};
+
+struct flow_control_options {
+	std::size_t high_watermark = 0;
+	std::size_t low_watermark = 0;
+	enum overflow_policy policy = OVERFLOW_REJECT;
+};
+
+struct batching_options {
+	// Requests issued within window of the first one leave together in a
+	// single MESSAGE_BATCH frame, earlier once the batch reaches max_bytes.
+	// A zero window batches the requests issued by the current handler.
+	std::chrono::microseconds window = std::chrono::microseconds(0);
+	std::size_t max_bytes = 64 * 1024;
+};
+
 class jet_peer final {
 public:
 	jet_peer(std::unique_ptr<jet_connection> c) noexcept;
@@ -44,14 +125,214 @@ public:
 
 	void connect(const connected_callback_t& connect_callback, std::chrono::milliseconds timeout) noexcept;
 	void disconnect(void) noexcept;
+	void request(const uint8_t* payload, size_t payload_length, const response_callback_t& callback, std::chrono::milliseconds timeout) noexcept;
+
+	void enable_reconnect(const reconnect_options& options = reconnect_options()) noexcept;
+	void disable_reconnect(void) noexcept;
+
+	// Replays registrations and sends requests right behind the connect
+	// instead of waiting a round trip for the daemon's version frame,
+	// assuming the daemon speaks the version last confirmed on this peer
+	// (initially `assumed`, by default our own). If the version frame turns
+	// out incompatible, requests sent ahead of it fail with
+	// SCRAMJET_VERSION_MISMATCH and the next connect waits for the version.
+	void enable_optimistic_handshake(void) noexcept;
+	void enable_optimistic_handshake(const protocol_version& assumed) noexcept;
+	void disable_optimistic_handshake(void) noexcept;
+
+	// Frames longer than threshold are sent compressed on connections whose
+	// daemon offers CAPABILITY_COMPRESSION in its version frame and whose
+	// transport supports it. Takes effect with the next handshake.
+	void enable_compression(std::size_t threshold = DEFAULT_COMPRESSION_THRESHOLD) noexcept;
+	void disable_compression(void) noexcept;
+
+	// Responses arriving in a batch are split back to the individual
+	// request callbacks whether or not batching is enabled.
+	void enable_batching(const batching_options& options = batching_options()) noexcept;
+	void disable_batching(void) noexcept;
+
+	// A registration is a request (adding a state or method, a fetch, ...)
+	// that is sent now if connected and replayed after every handshake.
+	// The callback receives the response of each replay.
+	registration_id_t add_registration(const uint8_t* payload, size_t payload_length, const response_callback_t& callback, std::chrono::milliseconds timeout) noexcept;
+	void remove_registration(registration_id_t id) noexcept;
+
+	// Configure before connecting. The callbacks run on the strand.
+	void set_flow_control(const flow_control_options& options, const flow_control_callback_t& on_congested = nullptr, const flow_control_callback_t& on_writable = nullptr) noexcept;
+	bool is_congested(void) const noexcept;
+
+	// A request carrying the value of a state path, subject to
+	// OVERFLOW_COALESCE while the send queue is congested.
+	void publish(const std::string& path, const uint8_t* payload, size_t payload_length, const response_callback_t& callback, std::chrono::milliseconds timeout) noexcept;
+
+	// Rate-limited publishing of states. The payload of the latest change
+	// is sent as a request once the state's interval elapsed; all states
+	// due at the same tick leave together. Changes made while
+	// disconnected or congested are sent after the handshake or once the
+	// send queue is writable. May be called from any thread.
+	state_handle_t add_state(const state_publish_options& options, const response_callback_t& callback, std::chrono::milliseconds timeout) noexcept;
+	void change_state(state_handle_t handle, const uint8_t* payload, size_t payload_length) noexcept;
+	void change_state(state_handle_t handle, const uint8_t* payload, size_t payload_length, double value) noexcept;
+	void remove_state(state_handle_t handle) noexcept;
+
+	jet_peer_statistics get_statistics(void) const;
+
+	static const std::size_t DEFAULT_COMPRESSION_THRESHOLD = 1024;
 
 private:
 	std::unique_ptr<jet_connection> m_connection;
 	connected_callback_t m_connected_callback;
+	request_table m_requests;
+	uint32_t m_next_request_id;
+	timer_wheel& m_timer_wheel;
+	strand_t& m_strand;
+	std::chrono::milliseconds m_connect_timeout;
+	bool m_established;
+	bool m_closing;
+
+	struct unconfirmed_request {
+		uint32_t slot_index;
+		uint32_t id;
+	};
+
+	bool m_optimistic;
+	bool m_version_assumed;
+	protocol_version m_assumed_version;
+	bool m_confirming;
+	std::vector<unconfirmed_request> m_unconfirmed;
+
+	struct registration {
+		std::vector<uint8_t> payload;
+		response_callback_t callback;
+		std::chrono::milliseconds timeout;
+	};
+
+	std::map<registration_id_t, registration> m_registrations;
+	std::atomic<registration_id_t> m_next_registration_id{0};
+
+	bool m_reconnect_enabled;
+	bool m_reconnect_pending;
+	reconnect_options m_reconnect_options;
+	std::chrono::milliseconds m_backoff;
+	std::minstd_rand m_random;
+	wheel_timer m_reconnect_timer;
+	uint64_t m_reconnect_generation;
+
+	struct parked_publish {
+		std::vector<uint8_t> payload;
+		response_callback_t callback;
+		std::chrono::milliseconds timeout;
+	};
+
+	flow_control_options m_flow_control;
+	flow_control_callback_t m_on_congested;
+	flow_control_callback_t m_on_writable;
+	std::map<std::string, parked_publish> m_parked;
+	std::atomic<std::size_t> m_posted_bytes{0};
+	std::mutex m_writable_mutex;
+	std::condition_variable m_writable_condition;
+
+	struct state_slot {
+		state_publish_options options;
+		response_callback_t callback;
+		std::chrono::milliseconds timeout;
+		std::vector<uint8_t> pending;
+		double pending_value;
+		double sent_value;
+		bool in_use;
+		bool dirty;
+		bool sent;
+		std::chrono::steady_clock::time_point sent_at;
+	};
+
+	struct state_update {
+		std::vector<uint8_t> payload;
+		response_callback_t callback;
+		std::chrono::milliseconds timeout;
+	};
 
+	std::mutex m_states_mutex;
+	std::vector<state_slot> m_states;
+	std::vector<state_handle_t> m_free_states;
+	std::vector<state_handle_t> m_dirty_states;
+	std::vector<state_update> m_state_updates;
+	wheel_timer m_flush_timer;
+	bool m_flush_armed;
+	std::chrono::steady_clock::time_point m_flush_due;
+
+	std::size_t m_compression_threshold;
+	jet_protocol m_protocol;
+
+	struct outgoing_batch {
+		std::vector<uint8_t> frame;
+		std::vector<uint32_t> slots;
+	};
+
+	bool m_batching;
+	batching_options m_batching_options;
+	std::vector<uint32_t> m_batch_slots;
+	std::size_t m_batch_bytes;
+	std::deque<outgoing_batch> m_batches_in_flight;
+	std::vector<outgoing_batch> m_spare_batches;
+	boost::asio::steady_timer m_batch_timer;
+	handler_memory m_batch_handler_memory;
+	uint64_t m_batch_generation;
+
+	std::atomic<uint64_t> m_connects{0};
+	std::atomic<uint64_t> m_reconnects{0};
+	std::atomic<uint64_t> m_request_count{0};
+	std::atomic<uint64_t> m_response_count{0};
+	std::atomic<uint64_t> m_timeouts{0};
+	std::atomic<uint64_t> m_state_changes{0};
+	std::atomic<uint64_t> m_state_update_count{0};
+	std::atomic<uint64_t> m_batch_count{0};
+	latency_histogram m_connect_time;
+	latency_histogram m_handshake_time;
+	latency_histogram m_round_trip_time;
+	latency_histogram m_callback_time;
+	std::chrono::steady_clock::time_point m_connect_started;
+	std::chrono::steady_clock::time_point m_handshake_started;
+
+	void start_connect(void);
 	void connected(scramjet::error_code ec);
+	void connection_lost(enum error_code ec);
+	void schedule_reconnect(void);
+	void reconnect_timer_expired(uint64_t generation);
+	void version_mismatch(void);
+	void send_protocol_output(void);
 	void version_received(enum error_code ec, const uint8_t* message, size_t message_length);
 	void message_received(enum error_code ec, const uint8_t* message, size_t message_length);
+
+	void request_sent(uint32_t slot_index, enum error_code ec);
+	void response_received(uint32_t request_id, const uint8_t* payload, size_t payload_length);
+	void request_timed_out(uint32_t slot_index, uint32_t request_id);
+	void fail_requests(enum error_code ec);
+
+	void add_to_batch(uint32_t slot_index, size_t frame_length);
+	void batch_window_expired(uint64_t generation);
+	void flush_batch(void);
+	void batch_sent(enum error_code ec);
+	void abort_batch(enum error_code ec);
+
+	void send_request(const uint8_t* payload, size_t payload_length, const response_callback_t& callback, std::chrono::milliseconds timeout);
+
+	void wait_writable(size_t payload_length);
+	void posted_request_done(size_t payload_length);
+	void notify_writable(void);
+	void send_queue_congested(void);
+	void send_queue_writable(void);
+	void park_publish(const std::string& path, const uint8_t* payload, size_t payload_length, const response_callback_t& callback, std::chrono::milliseconds timeout);
+	void flush_parked(void);
+	void fail_parked(enum error_code ec);
+
+	void mark_state_dirty(state_handle_t handle, state_slot& slot);
+	void arm_flush(std::chrono::steady_clock::time_point due);
+	void flush_states(void);
+
+	void insert_registration(registration_id_t id, const uint8_t* payload, size_t payload_length, const response_callback_t& callback, std::chrono::milliseconds timeout);
+	void send_registration(registration_id_t id, const registration& r);
+	void registration_response(registration_id_t id, enum error_code ec, const uint8_t* message, size_t message_length);
+	void replay_registrations(void);
 };
 } // namespace scramjet
 
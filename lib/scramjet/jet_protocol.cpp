@@ -0,0 +1,324 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "scramjet/error_code.hpp"
+#include "scramjet/frame_codec.hpp"
+#include "scramjet/jet_protocol.hpp"
+#include "scramjet/message_batch.hpp"
+#include "scramjet/message_frames.hpp"
+#include "scramjet/message_type.hpp"
+#include "scramjet/protocol_version.hpp"
+
+namespace scramjet {
+
+static const uint32_t SUPPORTED_MAJOR = 1;
+static const uint32_t SUPPORTED_MINOR = 0;
+static const uint32_t SUPPORTED_PATCH = 0;
+
+jet_protocol::jet_protocol(uint8_t* reassembly_buffer, std::size_t reassembly_capacity) noexcept
+        : m_reassembly(reassembly_buffer)
+        , m_reassembly_capacity(reassembly_capacity)
+        , m_reassembly_length(0)
+        , m_max_frame_size(DEFAULT_MAX_FRAME_SIZE)
+        , m_input(nullptr)
+        , m_input_length(0)
+        , m_frame(nullptr)
+        , m_frame_length(0)
+        , m_wanted_capabilities(0)
+        , m_capabilities(0)
+        , m_established(false)
+        , m_failed(false)
+        , m_batch(nullptr, 0)
+        , m_output_offset(0)
+        , m_output_length(0)
+{
+}
+
+void jet_protocol::reset(void) noexcept
+{
+	m_reassembly_length = 0;
+	m_input = nullptr;
+	m_input_length = 0;
+	m_frame = nullptr;
+	m_frame_length = 0;
+	m_capabilities = 0;
+	m_established = false;
+	m_failed = false;
+	m_batch = batch_reader(nullptr, 0);
+	m_output_offset = 0;
+	m_output_length = 0;
+}
+
+void jet_protocol::set_capabilities(uint32_t wanted) noexcept
+{
+	m_wanted_capabilities = wanted;
+}
+
+void jet_protocol::set_max_frame_size(std::size_t max_frame_size) noexcept
+{
+	m_max_frame_size = max_frame_size;
+}
+
+void jet_protocol::feed(const uint8_t* data, std::size_t length) noexcept
+{
+	m_input = data;
+	m_input_length = length;
+}
+
+void jet_protocol::feed_frame(const uint8_t* frame, std::size_t frame_length) noexcept
+{
+	m_frame = frame;
+	m_frame_length = frame_length;
+}
+
+void jet_protocol::assume_established(uint32_t capabilities) noexcept
+{
+	m_established = true;
+	m_capabilities = capabilities;
+}
+
+bool jet_protocol::poll(protocol_event& event) noexcept
+{
+	if (m_failed) {
+		return false;
+	}
+
+	for (;;) {
+		const uint8_t* entry;
+		std::size_t entry_length;
+		while (m_batch.next(entry, entry_length)) {
+			response_frame_t::view response;
+			if (response_frame_t::decode(entry, entry_length, response) && (response.get<0>() == message_type::MESSAGE_RESPONSE)) {
+				event = {PROTOCOL_EVENT_RESPONSE, SCRAMJET_OK, response.payload(), response.payload_length(), response.get<1>(), m_capabilities};
+				return true;
+			}
+		}
+
+		const uint8_t* frame;
+		std::size_t frame_length;
+		enum error_code ec;
+		if (!next_frame(frame, frame_length, ec)) {
+			return (ec != SCRAMJET_OK) ? fail(ec, event) : false;
+		}
+
+		if (frame_event(frame, frame_length, event)) {
+			return true;
+		}
+	}
+}
+
+bool jet_protocol::next_frame(const uint8_t*& frame, std::size_t& frame_length, enum error_code& ec) noexcept
+{
+	ec = SCRAMJET_OK;
+	if (m_frame != nullptr) {
+		frame = m_frame;
+		frame_length = m_frame_length;
+		m_frame = nullptr;
+		return true;
+	}
+
+	if ((m_reassembly_length == 0) && (m_input_length >= LENGTH_PREFIX_SIZE)) {
+		std::size_t length = load_little<uint32_t>(m_input);
+		if (length > m_max_frame_size) {
+			ec = SCRAMJET_FRAME_TOO_LARGE;
+			return false;
+		}
+
+		if (m_input_length - LENGTH_PREFIX_SIZE >= length) {
+			frame = m_input + LENGTH_PREFIX_SIZE;
+			frame_length = length;
+			m_input += LENGTH_PREFIX_SIZE + length;
+			m_input_length -= LENGTH_PREFIX_SIZE + length;
+			return true;
+		}
+	}
+
+	if (m_reassembly_capacity < LENGTH_PREFIX_SIZE) {
+		if (m_input_length > 0) {
+			ec = SCRAMJET_FRAME_TOO_LARGE;
+		}
+		return false;
+	}
+
+	if (!gather(LENGTH_PREFIX_SIZE)) {
+		return false;
+	}
+
+	std::size_t length = load_little<uint32_t>(m_reassembly);
+	if ((length > m_max_frame_size) || (length > m_reassembly_capacity - LENGTH_PREFIX_SIZE)) {
+		ec = SCRAMJET_FRAME_TOO_LARGE;
+		return false;
+	}
+
+	if (!gather(LENGTH_PREFIX_SIZE + length)) {
+		return false;
+	}
+
+	frame = m_reassembly + LENGTH_PREFIX_SIZE;
+	frame_length = length;
+	m_reassembly_length = 0;
+	return true;
+}
+
+bool jet_protocol::gather(std::size_t length) noexcept
+{
+	std::size_t missing = length - std::min(length, m_reassembly_length);
+	std::size_t copied = std::min(missing, m_input_length);
+	if (copied > 0) {
+		std::memcpy(m_reassembly + m_reassembly_length, m_input, copied);
+		m_reassembly_length += copied;
+		m_input += copied;
+		m_input_length -= copied;
+	}
+
+	return copied == missing;
+}
+
+bool jet_protocol::frame_event(const uint8_t* frame, std::size_t frame_length, protocol_event& event) noexcept
+{
+	if (!m_established) {
+		protocol_version version(0, 0, 0);
+		uint32_t offered;
+		if (!read_version(frame, frame_length, version, offered) || !version.is_compatible(supported_version())) {
+			return fail(SCRAMJET_VERSION_MISMATCH, event);
+		}
+
+		m_established = true;
+		m_capabilities = offered & m_wanted_capabilities;
+		if (m_capabilities != 0) {
+			store_little(m_output.data(), static_cast<uint32_t>(VERSION_FRAME_SIZE));
+			encode_version(&m_output[LENGTH_PREFIX_SIZE], VERSION_FRAME_SIZE, m_capabilities);
+			m_output_offset = 0;
+			m_output_length = m_output.size();
+		}
+
+		event = {PROTOCOL_EVENT_ESTABLISHED, SCRAMJET_OK, frame, frame_length, 0, m_capabilities};
+		return true;
+	}
+
+	response_frame_t::view response;
+	if (response_frame_t::decode(frame, frame_length, response) && (response.get<0>() == message_type::MESSAGE_RESPONSE)) {
+		event = {PROTOCOL_EVENT_RESPONSE, SCRAMJET_OK, response.payload(), response.payload_length(), response.get<1>(), m_capabilities};
+		return true;
+	}
+
+	batch_reader batch(frame, frame_length);
+	if (batch.is_batch()) {
+		m_batch = batch;
+		return false;
+	}
+
+	event = {PROTOCOL_EVENT_MESSAGE, SCRAMJET_OK, frame, frame_length, 0, m_capabilities};
+	return true;
+}
+
+bool jet_protocol::fail(enum error_code ec, protocol_event& event) noexcept
+{
+	m_failed = true;
+	m_reassembly_length = 0;
+	m_input_length = 0;
+	event = {PROTOCOL_EVENT_ERROR, ec, nullptr, 0, 0, m_capabilities};
+	return true;
+}
+
+std::size_t jet_protocol::pending_output(const uint8_t*& data) const noexcept
+{
+	data = m_output.data() + m_output_offset;
+	return m_output_length - m_output_offset;
+}
+
+void jet_protocol::consume_output(std::size_t length) noexcept
+{
+	m_output_offset += std::min(length, m_output_length - m_output_offset);
+	if (m_output_offset == m_output_length) {
+		m_output_offset = 0;
+		m_output_length = 0;
+	}
+}
+
+bool jet_protocol::is_established(void) const noexcept
+{
+	return m_established;
+}
+
+uint32_t jet_protocol::get_capabilities(void) const noexcept
+{
+	return m_capabilities;
+}
+
+std::size_t jet_protocol::encode_request_header(uint8_t* buffer, std::size_t buffer_length, uint32_t id, std::size_t payload_length) noexcept
+{
+	if ((buffer == nullptr) || (buffer_length < REQUEST_HEADER_SIZE)) {
+		return 0;
+	}
+
+	store_little(buffer, static_cast<uint32_t>(request_frame_t::size() + payload_length));
+	request_frame_t::encode(buffer + LENGTH_PREFIX_SIZE, buffer_length - LENGTH_PREFIX_SIZE, message_type::MESSAGE_REQUEST, id);
+	return REQUEST_HEADER_SIZE;
+}
+
+std::size_t jet_protocol::encode_version(uint8_t* buffer, std::size_t buffer_length, uint32_t capabilities) noexcept
+{
+	if ((buffer == nullptr) || (buffer_length < VERSION_FRAME_SIZE)) {
+		return 0;
+	}
+
+	api_version_frame_t::encode(buffer, buffer_length, message_type::MESSAGE_API_VERSION, SUPPORTED_MAJOR, SUPPORTED_MINOR, SUPPORTED_PATCH);
+	store_little(buffer + api_version_frame_t::size(), capabilities);
+	return VERSION_FRAME_SIZE;
+}
+
+bool jet_protocol::read_version(const uint8_t* frame, std::size_t frame_length, protocol_version& version, uint32_t& capabilities) noexcept
+{
+	api_version_frame_t::view view;
+	if (!api_version_frame_t::decode(frame, frame_length, view) ||
+	    ((view.payload_length() != 0) && (view.payload_length() != sizeof(capabilities)))) {
+		return false;
+	}
+
+	if (view.get<0>() != message_type::MESSAGE_API_VERSION) {
+		return false;
+	}
+
+	version = protocol_version(view.get<1>(), view.get<2>(), view.get<3>());
+	capabilities = (view.payload_length() != 0) ? load_little<uint32_t>(view.payload()) : 0;
+	return true;
+}
+
+const protocol_version& jet_protocol::supported_version(void) noexcept
+{
+	static const protocol_version version(SUPPORTED_MAJOR, SUPPORTED_MINOR, SUPPORTED_PATCH);
+	return version;
+}
+
+} // namespace scramjet
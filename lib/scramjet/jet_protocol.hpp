@@ -0,0 +1,152 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCRAMJET__JET_PROTOCOL_HPP
+#define SCRAMJET__JET_PROTOCOL_HPP
+
+#include <array>
+#include <cstdbool>
+#include <cstdint>
+#include <cstdlib>
+
+#include "scramjet/error_code.hpp"
+#include "scramjet/message_batch.hpp"
+#include "scramjet/message_frames.hpp"
+#include "scramjet/protocol_version.hpp"
+
+namespace scramjet {
+
+enum protocol_event_type {
+	// The daemon's version frame was accepted. capabilities holds those
+	// both sides are going to use.
+	PROTOCOL_EVENT_ESTABLISHED,
+	// A response, on its own or out of a batch. data points to the payload.
+	PROTOCOL_EVENT_RESPONSE,
+	// Any other frame, including MESSAGE_COMPRESSED ones, handed on whole.
+	PROTOCOL_EVENT_MESSAGE,
+	// The stream is unusable, no further events follow until reset().
+	PROTOCOL_EVENT_ERROR,
+};
+
+struct protocol_event {
+	enum protocol_event_type type;
+	enum error_code ec;
+	const uint8_t* data;
+	std::size_t length;
+	uint32_t request_id;
+	uint32_t capabilities;
+};
+
+// The framing and handshake of a Jet peer without any I/O: bytes go in
+// through feed(), frames and handshake results come out of poll(), and
+// the bytes the protocol itself has to send are taken from
+// pending_output(). It neither allocates nor depends on asio.
+//
+// Frames that lie within the fed data are handed out in place. Only a
+// frame split across feed() calls is gathered in the caller's reassembly
+// buffer, which therefore bounds the size of such frames. Event data stays
+// valid until the next call to feed() or poll().
+class jet_protocol final {
+public:
+	jet_protocol(uint8_t* reassembly_buffer, std::size_t reassembly_capacity) noexcept;
+
+	jet_protocol(const jet_protocol&) = delete;
+	jet_protocol& operator=(const jet_protocol&) = delete;
+
+	// Starts over for a new connection.
+	void reset(void) noexcept;
+
+	// Capabilities to accept when the daemon offers them. Set before the
+	// handshake.
+	void set_capabilities(uint32_t wanted) noexcept;
+	void set_max_frame_size(std::size_t max_frame_size) noexcept;
+
+	// Hands over the next received bytes. poll() then returns events until
+	// it returns false, at which point every byte was used or gathered and
+	// data may be reused.
+	void feed(const uint8_t* data, std::size_t length) noexcept;
+	bool poll(protocol_event& event) noexcept;
+
+	// For transports that delimit frames themselves: hands over one whole
+	// frame without its length prefix, to be polled like fed bytes.
+	// Callers that read the version frame on their own report the result
+	// through assume_established() first.
+	void feed_frame(const uint8_t* frame, std::size_t frame_length) noexcept;
+	void assume_established(uint32_t capabilities) noexcept;
+
+	std::size_t pending_output(const uint8_t*& data) const noexcept;
+	void consume_output(std::size_t length) noexcept;
+
+	bool is_established(void) const noexcept;
+	uint32_t get_capabilities(void) const noexcept;
+
+	// Writes the length prefix and request header that precede a payload
+	// of payload_length bytes on the wire. Returns REQUEST_HEADER_SIZE, or
+	// 0 if buffer is too small.
+	static std::size_t encode_request_header(uint8_t* buffer, std::size_t buffer_length, uint32_t id, std::size_t payload_length) noexcept;
+
+	// A MESSAGE_API_VERSION frame carrying capabilities, without length
+	// prefix.
+	static std::size_t encode_version(uint8_t* buffer, std::size_t buffer_length, uint32_t capabilities) noexcept;
+	static bool read_version(const uint8_t* frame, std::size_t frame_length, protocol_version& version, uint32_t& capabilities) noexcept;
+	static const protocol_version& supported_version(void) noexcept;
+
+	static const std::size_t LENGTH_PREFIX_SIZE = sizeof(uint32_t);
+	static const std::size_t REQUEST_HEADER_SIZE = LENGTH_PREFIX_SIZE + request_frame_t::size();
+	static const std::size_t VERSION_FRAME_SIZE = api_version_frame_t::size() + sizeof(uint32_t);
+
+private:
+	uint8_t* m_reassembly;
+	std::size_t m_reassembly_capacity;
+	std::size_t m_reassembly_length;
+	std::size_t m_max_frame_size;
+
+	const uint8_t* m_input;
+	std::size_t m_input_length;
+	const uint8_t* m_frame;
+	std::size_t m_frame_length;
+
+	uint32_t m_wanted_capabilities;
+	uint32_t m_capabilities;
+	bool m_established;
+	bool m_failed;
+	batch_reader m_batch;
+
+	std::array<uint8_t, LENGTH_PREFIX_SIZE + VERSION_FRAME_SIZE> m_output;
+	std::size_t m_output_offset;
+	std::size_t m_output_length;
+
+	bool next_frame(const uint8_t*& frame, std::size_t& frame_length, enum error_code& ec) noexcept;
+	bool gather(std::size_t length) noexcept;
+	bool frame_event(const uint8_t* frame, std::size_t frame_length, protocol_event& event) noexcept;
+	bool fail(enum error_code ec, protocol_event& event) noexcept;
+};
+
+} // namespace scramjet
+
+#endif
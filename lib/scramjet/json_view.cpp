@@ -0,0 +1,721 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstdbool>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <new>
+
+#include <locale.h>
+#include <stdlib.h>
+#if defined(__APPLE__)
+#include <xlocale.h>
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "scramjet/json_view.hpp"
+
+namespace scramjet {
+
+static const std::size_t NUMBER_BUFFER_SIZE = 64;
+static const int MAX_MANTISSA_DIGITS = 19;
+static const int MAX_EXACT_DIGITS = 15;
+static const int MAX_EXACT_POWER = 22;
+static const int MAX_EXPONENT = 100000;
+
+static const double POWERS_OF_TEN[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                       1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static bool is_whitespace(char c) noexcept
+{
+	return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+}
+
+static const char* skip_whitespace(const char* p, const char* end) noexcept
+{
+	while ((p < end) && is_whitespace(*p)) {
+		p++;
+	}
+
+	return p;
+}
+
+static bool is_digit(char c) noexcept
+{
+	return (c >= '0') && (c <= '9');
+}
+
+#if defined(_WIN32)
+typedef _locale_t c_locale_t;
+
+static c_locale_t get_c_locale(void) noexcept
+{
+	static const c_locale_t locale = _create_locale(LC_ALL, "C");
+	return locale;
+}
+
+static double strtod_c(const char* string, char** string_end, c_locale_t locale) noexcept
+{
+	return _strtod_l(string, string_end, locale);
+}
+#else
+typedef locale_t c_locale_t;
+
+static c_locale_t get_c_locale(void) noexcept
+{
+	static const c_locale_t locale = newlocale(LC_ALL_MASK, "C", static_cast<locale_t>(0));
+	return locale;
+}
+
+static double strtod_c(const char* string, char** string_end, c_locale_t locale) noexcept
+{
+	return strtod_l(string, string_end, locale);
+}
+#endif
+
+// For numbers beyond the exact fast path. The number is copied to have it
+// terminated and converted in the "C" locale, whatever the process uses.
+static bool parse_double_slow(const char* number, size_t number_length, double& value) noexcept
+{
+	c_locale_t locale = get_c_locale();
+	if (locale == static_cast<c_locale_t>(0)) {
+		return false;
+	}
+
+	char stack_buffer[NUMBER_BUFFER_SIZE];
+	std::unique_ptr<char[]> heap_buffer;
+	char* buffer = stack_buffer;
+	if (number_length >= sizeof(stack_buffer)) {
+		heap_buffer.reset(new (std::nothrow) char[number_length + 1]);
+		if (heap_buffer == nullptr) {
+			return false;
+		}
+
+		buffer = heap_buffer.get();
+	}
+
+	std::memcpy(buffer, number, number_length);
+	buffer[number_length] = '\0';
+	char* buffer_end;
+	value = strtod_c(buffer, &buffer_end, locale);
+	return buffer_end == buffer + number_length;
+}
+
+#if defined(__AVX2__)
+static const std::size_t SIMD_WIDTH = 32;
+
+static unsigned int string_mask(const char* p) noexcept
+{
+	__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+	__m256i quotes = _mm256_cmpeq_epi8(block, _mm256_set1_epi8('"'));
+	__m256i backslashes = _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\\'));
+	return static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_or_si256(quotes, backslashes)));
+}
+
+static unsigned int structural_mask(const char* p) noexcept
+{
+	__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+	__m256i quotes = _mm256_cmpeq_epi8(block, _mm256_set1_epi8('"'));
+	__m256i braces = _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(block, _mm256_set1_epi8('}')));
+	__m256i brackets = _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('[')), _mm256_cmpeq_epi8(block, _mm256_set1_epi8(']')));
+	return static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_or_si256(quotes, _mm256_or_si256(braces, brackets))));
+}
+#elif defined(__SSE2__)
+static const std::size_t SIMD_WIDTH = 16;
+
+static unsigned int string_mask(const char* p) noexcept
+{
+	__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+	__m128i quotes = _mm_cmpeq_epi8(block, _mm_set1_epi8('"'));
+	__m128i backslashes = _mm_cmpeq_epi8(block, _mm_set1_epi8('\\'));
+	return static_cast<unsigned int>(_mm_movemask_epi8(_mm_or_si128(quotes, backslashes)));
+}
+
+static unsigned int structural_mask(const char* p) noexcept
+{
+	__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+	__m128i quotes = _mm_cmpeq_epi8(block, _mm_set1_epi8('"'));
+	__m128i braces = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('{')), _mm_cmpeq_epi8(block, _mm_set1_epi8('}')));
+	__m128i brackets = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('[')), _mm_cmpeq_epi8(block, _mm_set1_epi8(']')));
+	return static_cast<unsigned int>(_mm_movemask_epi8(_mm_or_si128(quotes, _mm_or_si128(braces, brackets))));
+}
+#endif
+
+static bool is_string_special(char c) noexcept
+{
+	return (c == '"') || (c == '\\');
+}
+
+static bool is_structural(char c) noexcept
+{
+	return (c == '"') || (c == '{') || (c == '}') || (c == '[') || (c == ']');
+}
+
+static const char* find_string_special(const char* p, const char* end) noexcept
+{
+#if defined(__AVX2__) || defined(__SSE2__)
+	while (static_cast<std::size_t>(end - p) >= SIMD_WIDTH) {
+		unsigned int mask = string_mask(p);
+		if (mask != 0) {
+			return p + __builtin_ctz(mask);
+		}
+
+		p += SIMD_WIDTH;
+	}
+#endif
+
+	while ((p < end) && !is_string_special(*p)) {
+		p++;
+	}
+
+	return p;
+}
+
+static const char* find_structural(const char* p, const char* end) noexcept
+{
+#if defined(__AVX2__) || defined(__SSE2__)
+	while (static_cast<std::size_t>(end - p) >= SIMD_WIDTH) {
+		unsigned int mask = structural_mask(p);
+		if (mask != 0) {
+			return p + __builtin_ctz(mask);
+		}
+
+		p += SIMD_WIDTH;
+	}
+#endif
+
+	while ((p < end) && !is_structural(*p)) {
+		p++;
+	}
+
+	return p;
+}
+
+static const char* skip_string(const char* p, const char* end) noexcept
+{
+	p++;
+	while (p < end) {
+		p = find_string_special(p, end);
+		if (p >= end) {
+			return nullptr;
+		}
+
+		if (*p == '"') {
+			return p + 1;
+		}
+
+		p += 2;
+	}
+
+	return nullptr;
+}
+
+static bool close_container(char c, unsigned int& depth) noexcept
+{
+	if ((c == '{') || (c == '[')) {
+		depth++;
+		return false;
+	}
+
+	depth--;
+	return depth == 0;
+}
+
+static const char* skip_container(const char* p, const char* end) noexcept
+{
+	unsigned int depth = 0;
+
+#if defined(__AVX2__) || defined(__SSE2__)
+	while (static_cast<std::size_t>(end - p) >= SIMD_WIDTH) {
+		unsigned int mask = structural_mask(p);
+		const char* next_block = p + SIMD_WIDTH;
+		while (mask != 0) {
+			const char* structural = p + __builtin_ctz(mask);
+			mask &= mask - 1;
+			if (*structural != '"') {
+				if (close_container(*structural, depth)) {
+					return structural + 1;
+				}
+
+				continue;
+			}
+
+			const char* string_end = skip_string(structural, end);
+			if (string_end == nullptr) {
+				return nullptr;
+			}
+
+			if (string_end >= next_block) {
+				next_block = string_end;
+				break;
+			}
+
+			mask &= ~((1U << (string_end - p)) - 1U);
+		}
+
+		p = next_block;
+	}
+#endif
+
+	while (p < end) {
+		p = find_structural(p, end);
+		if (p >= end) {
+			return nullptr;
+		}
+
+		if (*p == '"') {
+			p = skip_string(p, end);
+			if (p == nullptr) {
+				return nullptr;
+			}
+
+			continue;
+		}
+
+		if (close_container(*p, depth)) {
+			return p + 1;
+		}
+
+		p++;
+	}
+
+	return nullptr;
+}
+
+static bool is_number_character(char c) noexcept
+{
+	return ((c >= '0') && (c <= '9')) || (c == '-') || (c == '+') || (c == '.') || (c == 'e') || (c == 'E');
+}
+
+static const char* skip_literal(const char* p, const char* end, const char* literal, std::size_t literal_length) noexcept
+{
+	if ((static_cast<std::size_t>(end - p) < literal_length) || (std::memcmp(p, literal, literal_length) != 0)) {
+		return nullptr;
+	}
+
+	return p + literal_length;
+}
+
+static json_value scan_value(const char* p, const char* end) noexcept
+{
+	if (p >= end) {
+		return json_value();
+	}
+
+	const char* value_end = nullptr;
+	enum json_type type = JSON_INVALID;
+	switch (*p) {
+	case '"':
+		type = JSON_STRING;
+		value_end = skip_string(p, end);
+		break;
+
+	case '{':
+		type = JSON_OBJECT;
+		value_end = skip_container(p, end);
+		break;
+
+	case '[':
+		type = JSON_ARRAY;
+		value_end = skip_container(p, end);
+		break;
+
+	case 't':
+		type = JSON_BOOLEAN;
+		value_end = skip_literal(p, end, "true", 4);
+		break;
+
+	case 'f':
+		type = JSON_BOOLEAN;
+		value_end = skip_literal(p, end, "false", 5);
+		break;
+
+	case 'n':
+		type = JSON_NULL;
+		value_end = skip_literal(p, end, "null", 4);
+		break;
+
+	default:
+		if (!is_number_character(*p)) {
+			return json_value();
+		}
+
+		type = JSON_NUMBER;
+		value_end = p;
+		while ((value_end < end) && is_number_character(*value_end)) {
+			value_end++;
+		}
+		break;
+	}
+
+	if (value_end == nullptr) {
+		return json_value();
+	}
+
+	return json_value(type, p, static_cast<size_t>(value_end - p));
+}
+
+json_value::json_value() noexcept
+        : m_type(JSON_INVALID)
+        , m_data(nullptr)
+        , m_size(0)
+{
+}
+
+json_value::json_value(enum json_type type, const char* data, size_t size) noexcept
+        : m_type(type)
+        , m_data(data)
+        , m_size(size)
+{
+}
+
+json_value json_value::parse(const uint8_t* buffer, size_t buffer_length) noexcept
+{
+	if (buffer == nullptr) {
+		return json_value();
+	}
+
+	const char* p = reinterpret_cast<const char*>(buffer);
+	const char* end = p + buffer_length;
+	p = skip_whitespace(p, end);
+	while ((end > p) && is_whitespace(*(end - 1))) {
+		end--;
+	}
+
+	if (p >= end) {
+		return json_value();
+	}
+
+	if ((*p == '{') || (*p == '[')) {
+		if (*(end - 1) != ((*p == '{') ? '}' : ']')) {
+			return json_value();
+		}
+
+		return json_value((*p == '{') ? JSON_OBJECT : JSON_ARRAY, p, static_cast<size_t>(end - p));
+	}
+
+	json_value value = scan_value(p, end);
+	if (value.m_data + value.m_size != end) {
+		return json_value();
+	}
+
+	return value;
+}
+
+enum json_type json_value::type(void) const noexcept
+{
+	return m_type;
+}
+
+const char* json_value::data(void) const noexcept
+{
+	return m_data;
+}
+
+size_t json_value::size(void) const noexcept
+{
+	return m_size;
+}
+
+bool json_value::is_valid(void) const noexcept
+{
+	return m_type != JSON_INVALID;
+}
+
+bool json_value::get_string(const char*& string, size_t& string_length) const noexcept
+{
+	if (m_type != JSON_STRING) {
+		return false;
+	}
+
+	string = m_data + 1;
+	string_length = m_size - 2;
+	return true;
+}
+
+bool json_value::get_bool(bool& value) const noexcept
+{
+	if (m_type != JSON_BOOLEAN) {
+		return false;
+	}
+
+	value = (*m_data == 't');
+	return true;
+}
+
+bool json_value::get_int64(int64_t& value) const noexcept
+{
+	if ((m_type != JSON_NUMBER) || (m_size == 0)) {
+		return false;
+	}
+
+	const char* p = m_data;
+	const char* end = m_data + m_size;
+	bool negative = (*p == '-');
+	if (negative) {
+		p++;
+	}
+
+	if (p == end) {
+		return false;
+	}
+
+	uint64_t limit = negative ? static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) + 1 : static_cast<uint64_t>(std::numeric_limits<int64_t>::max());
+	uint64_t result = 0;
+	for (; p < end; p++) {
+		if ((*p < '0') || (*p > '9')) {
+			return false;
+		}
+
+		uint64_t digit = static_cast<uint64_t>(*p - '0');
+		if (result > (limit - digit) / 10) {
+			return false;
+		}
+
+		result = result * 10 + digit;
+	}
+
+	value = negative ? static_cast<int64_t>(0 - result) : static_cast<int64_t>(result);
+	return true;
+}
+
+bool json_value::get_double(double& value) const noexcept
+{
+	if (m_type != JSON_NUMBER) {
+		return false;
+	}
+
+	const char* p = m_data;
+	const char* end = m_data + m_size;
+	bool negative = (p < end) && (*p == '-');
+	if (negative) {
+		p++;
+	}
+
+	if ((p == end) || !is_digit(*p)) {
+		return false;
+	}
+
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool exact = true;
+	if (*p == '0') {
+		p++;
+	} else {
+		for (; (p < end) && is_digit(*p); p++) {
+			if (digits < MAX_MANTISSA_DIGITS) {
+				mantissa = (mantissa * 10) + static_cast<uint64_t>(*p - '0');
+				digits++;
+			} else {
+				exponent++;
+				exact = exact && (*p == '0');
+			}
+		}
+	}
+
+	if ((p < end) && (*p == '.')) {
+		p++;
+		if ((p == end) || !is_digit(*p)) {
+			return false;
+		}
+
+		for (; (p < end) && is_digit(*p); p++) {
+			if ((mantissa == 0) && (*p == '0')) {
+				exponent--;
+			} else if (digits < MAX_MANTISSA_DIGITS) {
+				mantissa = (mantissa * 10) + static_cast<uint64_t>(*p - '0');
+				digits++;
+				exponent--;
+			} else {
+				exact = exact && (*p == '0');
+			}
+		}
+	}
+
+	if ((p < end) && ((*p == 'e') || (*p == 'E'))) {
+		p++;
+		bool negative_exponent = (p < end) && (*p == '-');
+		if ((p < end) && ((*p == '-') || (*p == '+'))) {
+			p++;
+		}
+
+		if ((p == end) || !is_digit(*p)) {
+			return false;
+		}
+
+		int explicit_exponent = 0;
+		for (; (p < end) && is_digit(*p); p++) {
+			if (explicit_exponent < MAX_EXPONENT) {
+				explicit_exponent = (explicit_exponent * 10) + (*p - '0');
+			}
+		}
+
+		exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+	}
+
+	if (p != end) {
+		return false;
+	}
+
+	// Mantissas and powers of ten that are both exact doubles give a
+	// correctly rounded result with a single operation.
+	if (mantissa == 0) {
+		value = negative ? -0.0 : 0.0;
+		return true;
+	}
+
+	if (exact && (digits <= MAX_EXACT_DIGITS) && (exponent >= -MAX_EXACT_POWER) && (exponent <= MAX_EXACT_POWER)) {
+		double result = static_cast<double>(mantissa);
+		result = (exponent < 0) ? result / POWERS_OF_TEN[-exponent] : result * POWERS_OF_TEN[exponent];
+		value = negative ? -result : result;
+		return true;
+	}
+
+	return parse_double_slow(m_data, m_size, value);
+}
+
+bool json_value::equals(const char* string, size_t string_length) const noexcept
+{
+	return (m_type == JSON_STRING) && (m_size == string_length + 2) && (std::memcmp(m_data + 1, string, string_length) == 0);
+}
+
+bool json_value::equals(const char* string) const noexcept
+{
+	return equals(string, std::strlen(string));
+}
+
+json_value json_value::find(const char* key, size_t key_length) const noexcept
+{
+	json_member_iterator members(*this);
+	json_value member_key;
+	json_value member_value;
+	while (members.next(member_key, member_value)) {
+		if (member_key.equals(key, key_length)) {
+			return member_value;
+		}
+	}
+
+	return json_value();
+}
+
+json_value json_value::find(const char* key) const noexcept
+{
+	return find(key, std::strlen(key));
+}
+
+json_member_iterator::json_member_iterator(const json_value& object) noexcept
+        : m_position(nullptr)
+        , m_end(nullptr)
+{
+	if (object.type() == JSON_OBJECT) {
+		m_position = object.data() + 1;
+		m_end = object.data() + object.size();
+	}
+}
+
+bool json_member_iterator::next(json_value& key, json_value& value) noexcept
+{
+	if (m_position == nullptr) {
+		return false;
+	}
+
+	const char* p = skip_whitespace(m_position, m_end);
+	if ((p >= m_end) || (*p != '"')) {
+		m_position = nullptr;
+		return false;
+	}
+
+	key = scan_value(p, m_end);
+	if (!key.is_valid()) {
+		m_position = nullptr;
+		return false;
+	}
+
+	p = skip_whitespace(key.data() + key.size(), m_end);
+	if ((p >= m_end) || (*p != ':')) {
+		m_position = nullptr;
+		return false;
+	}
+
+	value = scan_value(skip_whitespace(p + 1, m_end), m_end);
+	if (!value.is_valid()) {
+		m_position = nullptr;
+		return false;
+	}
+
+	p = skip_whitespace(value.data() + value.size(), m_end);
+	if ((p < m_end) && (*p == ',')) {
+		m_position = p + 1;
+	} else {
+		m_position = nullptr;
+	}
+
+	return true;
+}
+
+json_element_iterator::json_element_iterator(const json_value& array) noexcept
+        : m_position(nullptr)
+        , m_end(nullptr)
+{
+	if (array.type() == JSON_ARRAY) {
+		m_position = array.data() + 1;
+		m_end = array.data() + array.size();
+	}
+}
+
+bool json_element_iterator::next(json_value& value) noexcept
+{
+	if (m_position == nullptr) {
+		return false;
+	}
+
+	const char* p = skip_whitespace(m_position, m_end);
+	value = scan_value(p, m_end);
+	if (!value.is_valid()) {
+		m_position = nullptr;
+		return false;
+	}
+
+	p = skip_whitespace(value.data() + value.size(), m_end);
+	if ((p < m_end) && (*p == ',')) {
+		m_position = p + 1;
+	} else {
+		m_position = nullptr;
+	}
+
+	return true;
+}
+
+} // namespace scramjet
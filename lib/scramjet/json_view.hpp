@@ -0,0 +1,104 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCRAMJET__JSON_VIEW_HPP
+#define SCRAMJET__JSON_VIEW_HPP
+
+#include <cstdbool>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace scramjet {
+
+enum json_type {
+	JSON_INVALID = 0,
+	JSON_NULL,
+	JSON_BOOLEAN,
+	JSON_NUMBER,
+	JSON_STRING,
+	JSON_ARRAY,
+	JSON_OBJECT
+};
+
+class json_value final {
+public:
+	json_value() noexcept;
+	json_value(enum json_type type, const char* data, size_t size) noexcept;
+
+	static json_value parse(const uint8_t* buffer, size_t buffer_length) noexcept;
+
+	enum json_type type(void) const noexcept;
+	const char* data(void) const noexcept;
+	size_t size(void) const noexcept;
+	bool is_valid(void) const noexcept;
+
+	// The bytes between the quotes as they are in the message, escape
+	// sequences are not decoded.
+	bool get_string(const char*& string, size_t& string_length) const noexcept;
+	bool get_bool(bool& value) const noexcept;
+	bool get_int64(int64_t& value) const noexcept;
+	// Parses JSON number syntax regardless of the process locale.
+	bool get_double(double& value) const noexcept;
+	bool equals(const char* string, size_t string_length) const noexcept;
+	bool equals(const char* string) const noexcept;
+
+	json_value find(const char* key, size_t key_length) const noexcept;
+	json_value find(const char* key) const noexcept;
+
+private:
+	enum json_type m_type;
+	const char* m_data;
+	size_t m_size;
+};
+
+class json_member_iterator final {
+public:
+	explicit json_member_iterator(const json_value& object) noexcept;
+
+	bool next(json_value& key, json_value& value) noexcept;
+
+private:
+	const char* m_position;
+	const char* m_end;
+};
+
+class json_element_iterator final {
+public:
+	explicit json_element_iterator(const json_value& array) noexcept;
+
+	bool next(json_value& value) noexcept;
+
+private:
+	const char* m_position;
+	const char* m_end;
+};
+
+} // namespace scramjet
+
+#endif
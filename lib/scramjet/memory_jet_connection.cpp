@@ -0,0 +1,461 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/endian/conversion.hpp>
+
+#include "scramjet/handler_allocator.hpp"
+#include "scramjet/jet_connection.hpp"
+#include "scramjet/memory_jet_connection.hpp"
+#include "scramjet/receive_buffer.hpp"
+#include "scramjet/statistics.hpp"
+
+namespace scramjet {
+
+// Both endpoints share one strand, so everything crossing the link is
+// ordered deterministically and needs no locking.
+struct memory_link {
+	memory_link(boost::asio::io_context& ioc, const memory_link_options& link_options)
+	    : options(link_options)
+	    , strand(boost::asio::make_strand(ioc))
+	{
+	}
+
+	const memory_link_options options;
+	strand_t strand;
+	memory_jet_connection* endpoints[2] = {nullptr, nullptr};
+};
+
+memory_jet_connection::pair_t memory_jet_connection::create_pair(boost::asio::io_context& ioc, const memory_link_options& options)
+{
+	std::shared_ptr<memory_link> link = std::make_shared<memory_link>(ioc, options);
+	std::unique_ptr<memory_jet_connection> first(new memory_jet_connection(ioc, link, 0));
+	std::unique_ptr<memory_jet_connection> second(new memory_jet_connection(ioc, link, 1));
+	link->endpoints[0] = first.get();
+	link->endpoints[1] = second.get();
+	return pair_t(std::move(first), std::move(second));
+}
+
+memory_jet_connection::memory_jet_connection(boost::asio::io_context& ioc, const std::shared_ptr<memory_link>& link, unsigned int side) noexcept
+        : m_io_context(ioc)
+        , m_strand(link->strand)
+        , m_link(link)
+        , m_side(side)
+        , m_random(link->options.seed + side)
+        , m_delivery_timer(ioc)
+        , m_completion_timer(ioc)
+{
+}
+
+memory_jet_connection::~memory_jet_connection() noexcept
+{
+	m_link->endpoints[m_side] = nullptr;
+	memory_jet_connection* other = peer();
+	if ((other != nullptr) && !m_closed) {
+		other->close_inbox();
+	}
+}
+
+memory_jet_connection* memory_jet_connection::peer(void) const noexcept
+{
+	return m_link->endpoints[1 - m_side];
+}
+
+bool memory_jet_connection::is_immediate(void) const noexcept
+{
+	return (m_link->options.latency.count() == 0) && (m_link->options.bandwidth == 0);
+}
+
+void memory_jet_connection::connect(const connected_callback_t& connect_callback, std::chrono::milliseconds timeout) noexcept
+{
+	if (!m_strand.running_in_this_thread()) {
+		boost::asio::post(m_strand, std::bind(&memory_jet_connection::connect, this, connect_callback, timeout));
+		return;
+	}
+
+	m_connected_callback = connect_callback;
+	m_connect_timeout = timeout;
+
+	enum error_code result = SCRAMJET_CONNECTION_REFUSED;
+	if (peer() != nullptr) {
+		m_closed = false;
+		result = SCRAMJET_OK;
+	}
+
+	m_connected = (result == SCRAMJET_OK);
+	m_peer_closed = false;
+	boost::asio::post(m_strand, [this, result]() {
+		m_connected_callback(result);
+	});
+}
+
+void memory_jet_connection::disconnect(void) noexcept
+{
+	if (!m_strand.running_in_this_thread()) {
+		boost::asio::post(m_strand, std::bind(&memory_jet_connection::disconnect, this));
+		return;
+	}
+
+	if (!m_closed) {
+		m_closed = true;
+		memory_jet_connection* other = peer();
+		if (other != nullptr) {
+			other->close_inbox();
+		}
+	}
+
+	m_inbox.clear();
+	m_delayed_inbox.clear();
+	m_inbox_closed = false;
+
+	m_connected = false;
+	m_drain.clear();
+	m_drain_position = 0;
+	m_delivery_timer.cancel();
+
+	if (m_receiving) {
+		m_receiving = false;
+		m_receive_buffer.clear();
+		boost::asio::post(m_strand, [this]() {
+			abort_fragments(SCRAMJET_OPERATION_ABORTED);
+			m_message_received_callback(SCRAMJET_OPERATION_ABORTED, nullptr, 0);
+		});
+	}
+}
+
+void memory_jet_connection::close_inbox(void) noexcept
+{
+	if (is_immediate()) {
+		m_inbox_closed = true;
+	} else {
+		memory_jet_connection* other = peer();
+		clock_t::time_point ready_at = std::max(clock_t::now(), (other != nullptr) ? other->m_link_free_at : clock_t::now());
+		delayed_chunk chunk;
+		chunk.ready_at = ready_at + m_link->options.latency;
+		chunk.end_of_stream = true;
+		m_delayed_inbox.push_back(std::move(chunk));
+	}
+
+	schedule_delivery();
+}
+
+void memory_jet_connection::schedule_delivery(void) noexcept
+{
+	if (!m_delivery_scheduled) {
+		m_delivery_scheduled = true;
+		boost::asio::post(m_strand, make_alloc_handler(m_delivery_handler_memory, std::bind(&memory_jet_connection::deliver, this)));
+	}
+}
+
+void memory_jet_connection::receive_message(const message_received_callback_t& callback) noexcept
+{
+	if (!m_strand.running_in_this_thread()) {
+		boost::asio::post(m_strand, std::bind(&memory_jet_connection::receive_message, this, callback));
+		return;
+	}
+
+	if (m_dispatching) {
+		m_pending_message_received_callback = callback;
+		return;
+	}
+
+	m_message_received_callback = callback;
+	if (!m_receiving) {
+		m_receiving = true;
+		deliver();
+	}
+}
+
+message_ref memory_jet_connection::retain_message(void) noexcept
+{
+	return m_receive_buffer.retain_message();
+}
+
+void memory_jet_connection::deliver(void) noexcept
+{
+	take_inbox();
+	feed_receive_buffer();
+}
+
+void memory_jet_connection::take_inbox(void) noexcept
+{
+	if (m_drain_position == m_drain.size()) {
+		m_drain.clear();
+		m_drain_position = 0;
+	}
+
+	m_delivery_scheduled = false;
+
+	if (m_drain.empty()) {
+		m_drain.swap(m_inbox);
+	} else {
+		m_drain.insert(m_drain.end(), m_inbox.begin(), m_inbox.end());
+		m_inbox.clear();
+	}
+
+	if (m_inbox_closed) {
+		m_inbox_closed = false;
+		m_peer_closed = true;
+	}
+
+	clock_t::time_point now = clock_t::now();
+	while (!m_delayed_inbox.empty() && (m_delayed_inbox.front().ready_at <= now)) {
+		delayed_chunk& chunk = m_delayed_inbox.front();
+		m_drain.insert(m_drain.end(), chunk.data.begin(), chunk.data.end());
+		if (chunk.end_of_stream) {
+			m_peer_closed = true;
+		}
+
+		m_delayed_inbox.pop_front();
+	}
+
+	if (!m_delayed_inbox.empty() && !m_delivery_timer_armed) {
+		m_delivery_timer_armed = true;
+		m_delivery_timer.expires_at(m_delayed_inbox.front().ready_at);
+		m_delivery_timer.async_wait(boost::asio::bind_executor(m_strand,
+		                                                       std::bind(&memory_jet_connection::delivery_timer_expired,
+		                                                                 this,
+		                                                                 std::placeholders::_1)));
+	}
+}
+
+void memory_jet_connection::delivery_timer_expired(const boost::system::error_code& ec) noexcept
+{
+	m_delivery_timer_armed = false;
+	if (ec) {
+		return;
+	}
+
+	deliver();
+}
+
+void memory_jet_connection::feed_receive_buffer(void) noexcept
+{
+	const memory_link_options& options = m_link->options;
+
+	while (m_receiving) {
+		if (m_drain_position == m_drain.size()) {
+			if (m_peer_closed) {
+				m_peer_closed = false;
+				m_receiving = false;
+				m_receive_buffer.clear();
+				abort_fragments(SCRAMJET_CONNECTION_CLOSED);
+				m_message_received_callback(SCRAMJET_CONNECTION_CLOSED, nullptr, 0);
+			}
+
+			return;
+		}
+
+		std::size_t length = m_drain.size() - m_drain_position;
+		if (options.max_fragment_size > 0) {
+			std::uniform_int_distribution<std::size_t> fragment_size(std::max<std::size_t>(options.min_fragment_size, 1), options.max_fragment_size);
+			length = std::min(length, fragment_size(m_random));
+		}
+
+		std::size_t bytes_missing = is_receiving_fragments() ? 0 : m_receive_buffer.bytes_missing();
+		std::size_t min_space = std::max(bytes_missing, static_cast<std::size_t>(receive_buffer::MIN_READ_SIZE));
+		uint8_t* buffer = m_receive_buffer.prepare(min_space);
+		length = std::min(length, m_receive_buffer.space());
+		std::memcpy(buffer, m_drain.data() + m_drain_position, length);
+		m_receive_buffer.commit(length);
+		m_drain_position += length;
+		counter_add(m_counters.reads, 1);
+		counter_add(m_counters.bytes_received, length);
+
+		handle_messages();
+	}
+}
+
+void memory_jet_connection::handle_messages(void) noexcept
+{
+	const uint8_t* message;
+	std::size_t message_length;
+
+	m_dispatching = true;
+	while (m_receiving) {
+		enum frame_action action = next_frame_action(m_receive_buffer);
+		if (action == FRAME_FRAGMENTED) {
+			continue;
+		}
+
+		if (action == FRAME_TOO_LARGE) {
+			m_receiving = false;
+			m_receive_buffer.clear();
+			disconnect();
+			m_message_received_callback(SCRAMJET_FRAME_TOO_LARGE, nullptr, 0);
+			break;
+		}
+
+		if ((action == FRAME_INCOMPLETE) || !m_receive_buffer.next_message(message, message_length)) {
+			break;
+		}
+
+		counter_add(m_counters.frames_received, 1);
+		m_message_received_callback(SCRAMJET_OK, message, message_length);
+		m_receive_buffer.consume_message();
+
+		if (m_pending_message_received_callback != nullptr) {
+			m_message_received_callback = std::move(m_pending_message_received_callback);
+			m_pending_message_received_callback = nullptr;
+		}
+	}
+
+	m_dispatching = false;
+}
+
+boost::asio::io_context& memory_jet_connection::get_io_context(void) noexcept
+{
+	return m_io_context;
+}
+
+strand_t& memory_jet_connection::get_strand(void) noexcept
+{
+	return m_strand;
+}
+
+void memory_jet_connection::send_message(const uint8_t* message, size_t message_length, const message_sent_callback_t& callback) noexcept
+{
+	if (!m_strand.running_in_this_thread()) {
+		boost::asio::post(m_strand, std::bind(&memory_jet_connection::send_message, this, message, message_length, callback));
+		return;
+	}
+
+	const memory_link_options& options = m_link->options;
+	uint32_t header = boost::endian::native_to_little(static_cast<uint32_t>(message_length));
+	const uint8_t* header_bytes = reinterpret_cast<const uint8_t*>(&header);
+
+	send_completion completion;
+	completion.done_at = clock_t::time_point::min();
+	completion.length = sizeof(header) + message_length;
+	completion.result = SCRAMJET_CONNECTION_CLOSED;
+	completion.callback = callback;
+
+	memory_jet_connection* other = peer();
+	if (m_connected && (other != nullptr) && !other->m_closed) {
+		completion.result = SCRAMJET_OK;
+		counter_add(m_counters.writes, 1);
+		counter_add(m_counters.frames_sent, 1);
+		counter_add(m_counters.bytes_sent, sizeof(header) + message_length);
+		if (is_immediate()) {
+			other->m_inbox.insert(other->m_inbox.end(), header_bytes, header_bytes + sizeof(header));
+			other->m_inbox.insert(other->m_inbox.end(), message, message + message_length);
+		} else {
+			clock_t::time_point now = clock_t::now();
+			clock_t::time_point start = std::max(now, m_link_free_at);
+			if (options.bandwidth > 0) {
+				uint64_t bytes = sizeof(header) + message_length;
+				m_link_free_at = start + std::chrono::nanoseconds(bytes * 1000000000 / options.bandwidth);
+			} else {
+				m_link_free_at = start;
+			}
+
+			completion.done_at = m_link_free_at;
+			clock_t::time_point ready_at = m_link_free_at + options.latency;
+			if (other->m_delayed_inbox.empty() || (other->m_delayed_inbox.back().ready_at != ready_at)) {
+				delayed_chunk chunk;
+				chunk.ready_at = ready_at;
+				chunk.end_of_stream = false;
+				other->m_delayed_inbox.push_back(std::move(chunk));
+			}
+
+			std::vector<uint8_t>& data = other->m_delayed_inbox.back().data;
+			data.insert(data.end(), header_bytes, header_bytes + sizeof(header));
+			data.insert(data.end(), message, message + message_length);
+		}
+
+		other->schedule_delivery();
+	}
+
+	m_completions.push_back(std::move(completion));
+	bytes_queued(sizeof(header) + message_length);
+	schedule_completions();
+}
+
+void memory_jet_connection::schedule_completions(void) noexcept
+{
+	if (m_completion_scheduled || (m_completion_position == m_completions.size())) {
+		return;
+	}
+
+	clock_t::time_point done_at = m_completions[m_completion_position].done_at;
+	if (done_at <= clock_t::now()) {
+		m_completion_scheduled = true;
+		boost::asio::post(m_strand, make_alloc_handler(m_completion_handler_memory, std::bind(&memory_jet_connection::complete_sends, this)));
+	} else if (!m_completion_timer_armed) {
+		m_completion_timer_armed = true;
+		m_completion_timer.expires_at(done_at);
+		m_completion_timer.async_wait(boost::asio::bind_executor(m_strand,
+		                                                         std::bind(&memory_jet_connection::completion_timer_expired,
+		                                                                   this,
+		                                                                   std::placeholders::_1)));
+	}
+}
+
+void memory_jet_connection::completion_timer_expired(const boost::system::error_code& ec) noexcept
+{
+	m_completion_timer_armed = false;
+	if (ec) {
+		return;
+	}
+
+	complete_sends();
+}
+
+void memory_jet_connection::complete_sends(void) noexcept
+{
+	m_completion_scheduled = false;
+
+	clock_t::time_point now = clock_t::now();
+	while ((m_completion_position < m_completions.size()) && (m_completions[m_completion_position].done_at <= now)) {
+		send_completion& completion = m_completions[m_completion_position++];
+		enum error_code result = completion.result;
+		message_sent_callback_t callback = std::move(completion.callback);
+		bytes_drained(completion.length);
+		if (callback != nullptr) {
+			callback(result);
+		}
+	}
+
+	if (m_completion_position == m_completions.size()) {
+		m_completions.clear();
+		m_completion_position = 0;
+	}
+
+	schedule_completions();
+}
+
+} // namespace scramjet
@@ -0,0 +1,147 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCRAMJET__MEMORY_JET_CONNECTION_HPP
+#define SCRAMJET__MEMORY_JET_CONNECTION_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "scramjet/handler_allocator.hpp"
+#include "scramjet/jet_connection.hpp"
+#include "scramjet/receive_buffer.hpp"
+
+namespace scramjet {
+
+struct memory_link_options {
+	// One way delay added to every frame.
+	std::chrono::microseconds latency = std::chrono::microseconds(0);
+	// Link capacity in bytes per second, 0 means unlimited.
+	uint64_t bandwidth = 0;
+	// Received bytes are handed to the framing code in chunks of a random
+	// size between min and max, 0 delivers everything that is available.
+	std::size_t min_fragment_size = 0;
+	std::size_t max_fragment_size = 0;
+	uint32_t seed = 1;
+};
+
+struct memory_link;
+
+class memory_jet_connection final : public jet_connection {
+public:
+	typedef std::pair<std::unique_ptr<memory_jet_connection>, std::unique_ptr<memory_jet_connection>> pair_t;
+
+	static pair_t create_pair(boost::asio::io_context& ioc, const memory_link_options& options = memory_link_options());
+
+	virtual void connect(const connected_callback_t& connect_callback, std::chrono::milliseconds timeout) noexcept override;
+	virtual void disconnect(void) noexcept override;
+	virtual void receive_message(const message_received_callback_t& callback) noexcept override;
+	virtual message_ref retain_message(void) noexcept override;
+	virtual boost::asio::io_context& get_io_context(void) noexcept override;
+	virtual strand_t& get_strand(void) noexcept override;
+	virtual void send_message(const uint8_t* message, size_t message_length, const message_sent_callback_t& callback) noexcept override;
+
+	virtual ~memory_jet_connection() noexcept;
+
+private:
+	typedef std::chrono::steady_clock clock_t;
+
+	struct delayed_chunk {
+		clock_t::time_point ready_at;
+		std::vector<uint8_t> data;
+		bool end_of_stream;
+	};
+
+	struct send_completion {
+		clock_t::time_point done_at;
+		std::size_t length;
+		enum error_code result;
+		message_sent_callback_t callback;
+	};
+
+	memory_jet_connection(boost::asio::io_context& ioc, const std::shared_ptr<memory_link>& link, unsigned int side) noexcept;
+
+	boost::asio::io_context& m_io_context;
+	strand_t m_strand;
+	std::shared_ptr<memory_link> m_link;
+	const unsigned int m_side;
+	std::minstd_rand m_random;
+
+	std::vector<uint8_t> m_inbox;
+	std::deque<delayed_chunk> m_delayed_inbox;
+	bool m_inbox_closed = false;
+	bool m_delivery_scheduled = false;
+	bool m_closed = false;
+	clock_t::time_point m_link_free_at;
+
+	receive_buffer m_receive_buffer;
+	std::vector<uint8_t> m_drain;
+	std::size_t m_drain_position = 0;
+	boost::asio::steady_timer m_delivery_timer;
+	bool m_delivery_timer_armed = false;
+	bool m_peer_closed = false;
+	bool m_connected = false;
+
+	bool m_receiving = false;
+	bool m_dispatching = false;
+	message_received_callback_t m_pending_message_received_callback = nullptr;
+
+	std::vector<send_completion> m_completions;
+	std::size_t m_completion_position = 0;
+	boost::asio::steady_timer m_completion_timer;
+	bool m_completion_timer_armed = false;
+	bool m_completion_scheduled = false;
+
+	handler_memory m_delivery_handler_memory;
+	handler_memory m_completion_handler_memory;
+
+	memory_jet_connection* peer(void) const noexcept;
+	bool is_immediate(void) const noexcept;
+	void schedule_delivery(void) noexcept;
+	void close_inbox(void) noexcept;
+
+	void deliver(void) noexcept;
+	void take_inbox(void) noexcept;
+	void feed_receive_buffer(void) noexcept;
+	void handle_messages(void) noexcept;
+	void delivery_timer_expired(const boost::system::error_code& ec) noexcept;
+
+	void schedule_completions(void) noexcept;
+	void complete_sends(void) noexcept;
+	void completion_timer_expired(const boost::system::error_code& ec) noexcept;
+};
+} // namespace scramjet
+
+#endif
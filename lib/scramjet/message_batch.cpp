@@ -0,0 +1,116 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "scramjet/frame_codec.hpp"
+#include "scramjet/message_batch.hpp"
+#include "scramjet/message_frames.hpp"
+#include "scramjet/message_type.hpp"
+
+namespace scramjet {
+
+batch_writer::batch_writer(std::vector<uint8_t>& buffer) noexcept
+        : m_buffer(buffer)
+        , m_count(0)
+{
+}
+
+void batch_writer::clear(void)
+{
+	m_count = 0;
+	m_buffer.resize(batch_frame_t::size());
+	batch_frame_t::encode(m_buffer.data(), m_buffer.size(), message_type::MESSAGE_BATCH, 0);
+}
+
+void batch_writer::append(const uint8_t* message, size_t message_length)
+{
+	size_t position = m_buffer.size();
+	m_buffer.resize(position + sizeof(uint32_t) + message_length);
+	store_little(&m_buffer[position], static_cast<uint32_t>(message_length));
+	if (message_length > 0) {
+		std::memcpy(&m_buffer[position + sizeof(uint32_t)], message, message_length);
+	}
+
+	m_count++;
+	store_little(&m_buffer[batch_frame_t::offset<1>()], m_count);
+}
+
+uint32_t batch_writer::count(void) const noexcept
+{
+	return m_count;
+}
+
+size_t batch_writer::size(void) const noexcept
+{
+	return m_buffer.size();
+}
+
+batch_reader::batch_reader(const uint8_t* message, size_t message_length) noexcept
+        : m_position(nullptr)
+        , m_end(nullptr)
+        , m_remaining(0)
+        , m_is_batch(false)
+{
+	batch_frame_t::view frame;
+	if (batch_frame_t::decode(message, message_length, frame) && (frame.get<0>() == message_type::MESSAGE_BATCH)) {
+		m_position = frame.payload();
+		m_end = frame.payload() + frame.payload_length();
+		m_remaining = frame.get<1>();
+		m_is_batch = true;
+	}
+}
+
+bool batch_reader::is_batch(void) const noexcept
+{
+	return m_is_batch;
+}
+
+bool batch_reader::next(const uint8_t*& entry, size_t& entry_length) noexcept
+{
+	if ((m_remaining == 0) || (static_cast<size_t>(m_end - m_position) < sizeof(uint32_t))) {
+		return false;
+	}
+
+	size_t length = load_little<uint32_t>(m_position);
+	if (static_cast<size_t>(m_end - m_position) - sizeof(uint32_t) < length) {
+		m_remaining = 0;
+		return false;
+	}
+
+	entry = m_position + sizeof(uint32_t);
+	entry_length = length;
+	m_position += sizeof(uint32_t) + length;
+	m_remaining--;
+	return true;
+}
+
+} // namespace scramjet
@@ -0,0 +1,71 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCRAMJET__MESSAGE_BATCH_HPP
+#define SCRAMJET__MESSAGE_BATCH_HPP
+
+#include <cstdbool>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace scramjet {
+
+class batch_writer final {
+public:
+	explicit batch_writer(std::vector<uint8_t>& buffer) noexcept;
+
+	void clear(void);
+	void append(const uint8_t* message, size_t message_length);
+	uint32_t count(void) const noexcept;
+	size_t size(void) const noexcept;
+
+private:
+	std::vector<uint8_t>& m_buffer;
+	uint32_t m_count;
+};
+
+// Walks the entries of a MESSAGE_BATCH frame. Stops at the first entry
+// running past the end of the frame.
+class batch_reader final {
+public:
+	batch_reader(const uint8_t* message, size_t message_length) noexcept;
+
+	bool is_batch(void) const noexcept;
+	bool next(const uint8_t*& entry, size_t& entry_length) noexcept;
+
+private:
+	const uint8_t* m_position;
+	const uint8_t* m_end;
+	uint32_t m_remaining;
+	bool m_is_batch;
+};
+
+} // namespace scramjet
+
+#endif
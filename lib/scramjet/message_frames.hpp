@@ -0,0 +1,56 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCRAMJET__MESSAGE_FRAMES_HPP
+#define SCRAMJET__MESSAGE_FRAMES_HPP
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "scramjet/frame_codec.hpp"
+#include "scramjet/message_type.hpp"
+
+namespace scramjet {
+
+// Largest frame, without its length prefix, that connections and the
+// protocol core accept unless configured otherwise.
+static const std::size_t DEFAULT_MAX_FRAME_SIZE = 64 * 1024 * 1024;
+
+typedef frame<uint32_t, uint32_t, uint32_t> protocol_version_frame_t;
+typedef frame<message_type, uint32_t, uint32_t, uint32_t> api_version_frame_t;
+typedef frame<message_type, uint32_t> request_frame_t;
+typedef frame<message_type, uint32_t> response_frame_t;
+// Followed by the given number of entries, each a little endian uint32_t
+// length and a complete request or response frame.
+typedef frame<message_type, uint32_t> batch_frame_t;
+// Type and uncompressed length, followed by the raw deflate stream.
+typedef frame<message_type, uint32_t> compressed_frame_t;
+
+} // namespace scramjet
+
+#endif
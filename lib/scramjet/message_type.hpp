@@ -35,7 +35,15 @@ namespace scramjet {
 enum message_type : uint8_t {
 	MESSAGE_API_VERSION = 1,
 	MESSAGE_REQUEST = 2,
-	MESSAGE_RESPONSE = 3
+	MESSAGE_RESPONSE = 3,
+	MESSAGE_BATCH = 4,
+	MESSAGE_COMPRESSED = 5
+};
+
+// Flags in the optional uint32_t payload of a MESSAGE_API_VERSION frame.
+// The daemon offers them, the peer answers with those it is going to use.
+enum protocol_capability : uint32_t {
+	CAPABILITY_COMPRESSION = 1
 };
 
 } // namespace scramjet
@@ -28,29 +28,18 @@
 
 #include <cstdint>
 #include <cstdlib>
-#include <cstring>
 #include <iostream>
 
-#include <boost/endian/conversion.hpp>
-
-#include "protocol_version.hpp"
+#include "scramjet/frame_codec.hpp"
+#include "scramjet/message_frames.hpp"
+#include "scramjet/protocol_version.hpp"
 
 namespace scramjet {
 protocol_version::protocol_version(const uint8_t* buffer) noexcept
-        : m_major(0)
-        , m_minor(0)
-        , m_patch(0)
+        : m_major(load_little<uint32_t>(buffer + protocol_version_frame_t::offset<0>()))
+        , m_minor(load_little<uint32_t>(buffer + protocol_version_frame_t::offset<1>()))
+        , m_patch(load_little<uint32_t>(buffer + protocol_version_frame_t::offset<2>()))
 {
-	std::memcpy(&m_major, buffer, sizeof(m_major));
-	buffer += sizeof(m_major);
-	boost::endian::little_to_native_inplace(m_major);
-
-	std::memcpy(&m_minor, buffer, sizeof(m_minor));
-	buffer += sizeof(m_minor);
-	boost::endian::little_to_native_inplace(m_minor);
-
-	std::memcpy(&m_patch, buffer, sizeof(m_patch));
-	boost::endian::little_to_native_inplace(m_patch);
 }
 
 protocol_version::protocol_version(uint32_t major, uint32_t minor, uint32_t patch) noexcept
@@ -88,6 +77,11 @@ bool protocol_version::is_compatible(const protocol_version& v) const noexcept
 
 size_t protocol_version::get_version_size(void) noexcept
 {
-	return sizeof(protocol_version::m_major) + sizeof(protocol_version::m_minor) + sizeof(protocol_version::m_patch);
+	return protocol_version_frame_t::size();
+}
+
+size_t protocol_version::encode(uint8_t* buffer, size_t buffer_length) const noexcept
+{
+	return protocol_version_frame_t::encode(buffer, buffer_length, m_major, m_minor, m_patch);
 }
 } // namespace scramjet
@@ -26,12 +26,13 @@
  * SOFTWARE.
  */
 
+#ifndef SCRAMJET__PROTOCOL_VERSION_HPP
+#define SCRAMJET__PROTOCOL_VERSION_HPP
+
 #include <cstdbool>
 #include <cstdint>
 #include <cstdlib>
 
-#include <boost/asio/streambuf.hpp>
-
 namespace scramjet {
 class protocol_version {
 public:
@@ -40,6 +41,7 @@ public:
 
 	void print() const noexcept;
 	static size_t get_version_size(void) noexcept;
+	size_t encode(uint8_t* buffer, size_t buffer_length) const noexcept;
 	bool is_compatible(const protocol_version& v) const noexcept;
 
 private:
@@ -48,3 +50,5 @@ private:
 	uint32_t m_patch;
 };
 } // namespace scramjet
+
+#endif
@@ -0,0 +1,407 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#include <boost/endian/conversion.hpp>
+
+#include "scramjet/receive_buffer.hpp"
+
+namespace scramjet {
+
+static void release_block(receive_buffer_block* block) noexcept
+{
+	if (block->ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		block->pool->put_block(block);
+	}
+}
+
+static void delete_block(receive_buffer_block* block) noexcept
+{
+	block->~receive_buffer_block();
+	::operator delete(static_cast<void*>(block));
+}
+
+receive_buffer_pool::receive_buffer_pool(std::size_t block_size) noexcept
+        : m_block_size(block_size)
+        , m_ref_count(1)
+        , m_free_blocks(nullptr)
+{
+}
+
+receive_buffer_pool::~receive_buffer_pool() noexcept
+{
+	while (m_free_blocks != nullptr) {
+		receive_buffer_block* block = m_free_blocks;
+		m_free_blocks = block->next;
+		delete_block(block);
+	}
+}
+
+receive_buffer_block* receive_buffer_pool::get_block(std::size_t capacity)
+{
+	receive_buffer_block* block = try_get_block(capacity);
+	if (block == nullptr) {
+		throw std::bad_alloc();
+	}
+
+	return block;
+}
+
+receive_buffer_block* receive_buffer_pool::try_get_block(std::size_t capacity) noexcept
+{
+	receive_buffer_block* block = nullptr;
+	if (capacity <= m_block_size) {
+		capacity = m_block_size;
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_free_blocks != nullptr) {
+			block = m_free_blocks;
+			m_free_blocks = block->next;
+		}
+	}
+
+	if (block == nullptr) {
+		void* memory = ::operator new(sizeof(receive_buffer_block) + capacity, std::nothrow);
+		if (memory == nullptr) {
+			return nullptr;
+		}
+
+		block = new (memory) receive_buffer_block;
+		block->pool = this;
+		block->capacity = capacity;
+	}
+
+	block->next = nullptr;
+	block->ref_count.store(1, std::memory_order_relaxed);
+	retain();
+	return block;
+}
+
+void receive_buffer_pool::put_block(receive_buffer_block* block) noexcept
+{
+	if (block->capacity == m_block_size) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		block->next = m_free_blocks;
+		m_free_blocks = block;
+	} else {
+		delete_block(block);
+	}
+
+	release();
+}
+
+void receive_buffer_pool::retain(void) noexcept
+{
+	m_ref_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void receive_buffer_pool::release(void) noexcept
+{
+	if (m_ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		delete this;
+	}
+}
+
+message_ref::message_ref() noexcept
+        : m_block(nullptr)
+        , m_message(nullptr)
+        , m_message_length(0)
+{
+}
+
+message_ref::message_ref(receive_buffer_block* block, const uint8_t* message, std::size_t message_length) noexcept
+        : m_block(block)
+        , m_message(message)
+        , m_message_length(message_length)
+{
+}
+
+message_ref::message_ref(const message_ref& other) noexcept
+        : m_block(other.m_block)
+        , m_message(other.m_message)
+        , m_message_length(other.m_message_length)
+{
+	if (m_block != nullptr) {
+		m_block->ref_count.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+message_ref::message_ref(message_ref&& other) noexcept
+        : m_block(other.m_block)
+        , m_message(other.m_message)
+        , m_message_length(other.m_message_length)
+{
+	other.m_block = nullptr;
+	other.m_message = nullptr;
+	other.m_message_length = 0;
+}
+
+message_ref::~message_ref() noexcept
+{
+	reset();
+}
+
+message_ref& message_ref::operator=(const message_ref& other) noexcept
+{
+	if (this != &other) {
+		message_ref tmp(other);
+		*this = std::move(tmp);
+	}
+
+	return *this;
+}
+
+message_ref& message_ref::operator=(message_ref&& other) noexcept
+{
+	if (this != &other) {
+		reset();
+		m_block = other.m_block;
+		m_message = other.m_message;
+		m_message_length = other.m_message_length;
+		other.m_block = nullptr;
+		other.m_message = nullptr;
+		other.m_message_length = 0;
+	}
+
+	return *this;
+}
+
+void message_ref::reset(void) noexcept
+{
+	if (m_block != nullptr) {
+		release_block(m_block);
+	}
+
+	m_block = nullptr;
+	m_message = nullptr;
+	m_message_length = 0;
+}
+
+receive_buffer::receive_buffer(std::size_t block_size)
+        : m_pool(new receive_buffer_pool(block_size))
+        , m_block(nullptr)
+        , m_read_offset(0)
+        , m_write_offset(0)
+        , m_message(nullptr)
+        , m_message_length(0)
+        , m_decoded_block(nullptr)
+        , m_decoded_length(0)
+{
+}
+
+receive_buffer::~receive_buffer() noexcept
+{
+	release_decoded();
+	if (m_block != nullptr) {
+		release_block(m_block);
+	}
+
+	m_pool->release();
+}
+
+uint8_t* receive_buffer::prepare(std::size_t min_space)
+{
+	if ((m_block != nullptr) && (space() >= min_space)) {
+		return m_block->data() + m_write_offset;
+	}
+
+	std::size_t pending = m_write_offset - m_read_offset;
+	if ((m_block != nullptr) && (pending == 0) && (m_block->capacity >= min_space) &&
+	    (m_block->ref_count.load(std::memory_order_acquire) == 1)) {
+		m_read_offset = 0;
+		m_write_offset = 0;
+		return m_block->data();
+	}
+
+	receive_buffer_block* block = m_pool->get_block(pending + min_space);
+	if (m_block != nullptr) {
+		std::memcpy(block->data(), m_block->data() + m_read_offset, pending);
+		release_block(m_block);
+	}
+
+	m_block = block;
+	m_read_offset = 0;
+	m_write_offset = pending;
+	m_message = nullptr;
+	m_message_length = 0;
+	return m_block->data() + m_write_offset;
+}
+
+std::size_t receive_buffer::space(void) const noexcept
+{
+	if (m_block == nullptr) {
+		return 0;
+	}
+
+	return m_block->capacity - m_write_offset;
+}
+
+void receive_buffer::commit(std::size_t length) noexcept
+{
+	m_write_offset += length;
+}
+
+bool receive_buffer::next_message(const uint8_t*& message, std::size_t& message_length) noexcept
+{
+	uint32_t length;
+	std::size_t pending = m_write_offset - m_read_offset;
+	if (pending < sizeof(length)) {
+		return false;
+	}
+
+	const uint8_t* data = m_block->data() + m_read_offset;
+	std::memcpy(&length, data, sizeof(length));
+	boost::endian::little_to_native_inplace(length);
+	if (pending - sizeof(length) < static_cast<std::size_t>(length)) {
+		return false;
+	}
+
+	m_message = data + sizeof(length);
+	m_message_length = static_cast<std::size_t>(length);
+	message = m_message;
+	message_length = m_message_length;
+	return true;
+}
+
+void receive_buffer::consume_message(void) noexcept
+{
+	m_read_offset += sizeof(uint32_t) + m_message_length;
+	m_message = nullptr;
+	m_message_length = 0;
+	release_decoded();
+
+	if ((m_read_offset == m_write_offset) && (m_block->ref_count.load(std::memory_order_acquire) == 1)) {
+		m_read_offset = 0;
+		m_write_offset = 0;
+	}
+}
+
+message_ref receive_buffer::retain_message(void) const noexcept
+{
+	if (m_message == nullptr) {
+		return message_ref();
+	}
+
+	if (m_decoded_block != nullptr) {
+		m_decoded_block->ref_count.fetch_add(1, std::memory_order_relaxed);
+		return message_ref(m_decoded_block, m_decoded_block->data(), m_decoded_length);
+	}
+
+	m_block->ref_count.fetch_add(1, std::memory_order_relaxed);
+	return message_ref(m_block, m_message, m_message_length);
+}
+
+uint8_t* receive_buffer::prepare_decoded(std::size_t length) noexcept
+{
+	release_decoded();
+	m_decoded_block = m_pool->try_get_block(length);
+	if (m_decoded_block == nullptr) {
+		return nullptr;
+	}
+
+	m_decoded_length = length;
+	return m_decoded_block->data();
+}
+
+void receive_buffer::release_decoded(void) noexcept
+{
+	if (m_decoded_block != nullptr) {
+		release_block(m_decoded_block);
+		m_decoded_block = nullptr;
+		m_decoded_length = 0;
+	}
+}
+
+std::size_t receive_buffer::bytes_missing(void) const noexcept
+{
+	uint32_t length;
+	std::size_t pending = m_write_offset - m_read_offset;
+	if (pending < sizeof(length)) {
+		return sizeof(length) - pending;
+	}
+
+	std::memcpy(&length, m_block->data() + m_read_offset, sizeof(length));
+	boost::endian::little_to_native_inplace(length);
+	std::size_t frame_length = sizeof(length) + static_cast<std::size_t>(length);
+	if (pending >= frame_length) {
+		return 0;
+	}
+
+	return frame_length - pending;
+}
+
+bool receive_buffer::frame_length(std::size_t& length) const noexcept
+{
+	uint32_t prefix;
+	if (m_write_offset - m_read_offset < sizeof(prefix)) {
+		return false;
+	}
+
+	std::memcpy(&prefix, m_block->data() + m_read_offset, sizeof(prefix));
+	boost::endian::little_to_native_inplace(prefix);
+	length = static_cast<std::size_t>(prefix);
+	return true;
+}
+
+std::size_t receive_buffer::peek(const uint8_t*& data) const noexcept
+{
+	std::size_t pending = m_write_offset - m_read_offset;
+	data = (pending > 0) ? (m_block->data() + m_read_offset) : nullptr;
+	return pending;
+}
+
+void receive_buffer::consume(std::size_t length) noexcept
+{
+	m_read_offset += length;
+	if ((m_read_offset == m_write_offset) && (m_block->ref_count.load(std::memory_order_acquire) == 1)) {
+		m_read_offset = 0;
+		m_write_offset = 0;
+	}
+}
+
+void receive_buffer::clear(void) noexcept
+{
+	m_read_offset = 0;
+	m_write_offset = 0;
+	m_message = nullptr;
+	m_message_length = 0;
+	release_decoded();
+
+	if ((m_block != nullptr) && (m_block->ref_count.load(std::memory_order_acquire) != 1)) {
+		release_block(m_block);
+		m_block = nullptr;
+	}
+}
+
+} // namespace scramjet
@@ -0,0 +1,161 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCRAMJET__RECEIVE_BUFFER_HPP
+#define SCRAMJET__RECEIVE_BUFFER_HPP
+
+#include <atomic>
+#include <cstdbool>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+
+namespace scramjet {
+
+class receive_buffer_pool;
+
+struct receive_buffer_block {
+	receive_buffer_pool* pool;
+	receive_buffer_block* next;
+	std::atomic<std::size_t> ref_count;
+	std::size_t capacity;
+
+	uint8_t* data(void) noexcept
+	{
+		return reinterpret_cast<uint8_t*>(this + 1);
+	}
+};
+
+class receive_buffer_pool {
+public:
+	explicit receive_buffer_pool(std::size_t block_size) noexcept;
+
+	receive_buffer_block* get_block(std::size_t capacity);
+	// Returns nullptr instead of throwing when memory runs out.
+	receive_buffer_block* try_get_block(std::size_t capacity) noexcept;
+	void put_block(receive_buffer_block* block) noexcept;
+
+	void retain(void) noexcept;
+	void release(void) noexcept;
+
+private:
+	~receive_buffer_pool() noexcept;
+
+	std::size_t m_block_size;
+	std::atomic<std::size_t> m_ref_count;
+	std::mutex m_mutex;
+	receive_buffer_block* m_free_blocks;
+};
+
+class message_ref final {
+public:
+	message_ref() noexcept;
+	message_ref(const message_ref& other) noexcept;
+	message_ref(message_ref&& other) noexcept;
+	~message_ref() noexcept;
+
+	message_ref& operator=(const message_ref& other) noexcept;
+	message_ref& operator=(message_ref&& other) noexcept;
+
+	const uint8_t* data(void) const noexcept
+	{
+		return m_message;
+	}
+
+	std::size_t size(void) const noexcept
+	{
+		return m_message_length;
+	}
+
+	explicit operator bool() const noexcept
+	{
+		return m_block != nullptr;
+	}
+
+	void reset(void) noexcept;
+
+private:
+	friend class receive_buffer;
+	message_ref(receive_buffer_block* block, const uint8_t* message, std::size_t message_length) noexcept;
+
+	receive_buffer_block* m_block;
+	const uint8_t* m_message;
+	std::size_t m_message_length;
+};
+
+class receive_buffer final {
+public:
+	explicit receive_buffer(std::size_t block_size = DEFAULT_BLOCK_SIZE);
+	~receive_buffer() noexcept;
+
+	receive_buffer(const receive_buffer&) = delete;
+	receive_buffer& operator=(const receive_buffer&) = delete;
+
+	uint8_t* prepare(std::size_t min_space);
+	std::size_t space(void) const noexcept;
+	void commit(std::size_t length) noexcept;
+
+	bool next_message(const uint8_t*& message, std::size_t& message_length) noexcept;
+	void consume_message(void) noexcept;
+	message_ref retain_message(void) const noexcept;
+
+	// Room in a separate block of the pool for a decoded form of the
+	// current message, e.g. an inflated frame. It stands in for the
+	// message in retain_message() until consume_message(). Returns nullptr
+	// if no block of that length can be allocated.
+	uint8_t* prepare_decoded(std::size_t length) noexcept;
+
+	std::size_t bytes_missing(void) const noexcept;
+	void clear(void) noexcept;
+
+	// Raw access for frames delivered in fragments.
+	bool frame_length(std::size_t& length) const noexcept;
+	std::size_t peek(const uint8_t*& data) const noexcept;
+	void consume(std::size_t length) noexcept;
+
+	static const std::size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+	static const std::size_t MIN_READ_SIZE = 4 * 1024;
+
+private:
+	receive_buffer_pool* m_pool;
+	receive_buffer_block* m_block;
+	std::size_t m_read_offset;
+	std::size_t m_write_offset;
+
+	const uint8_t* m_message;
+	std::size_t m_message_length;
+
+	receive_buffer_block* m_decoded_block;
+	std::size_t m_decoded_length;
+
+	void release_decoded(void) noexcept;
+};
+
+} // namespace scramjet
+
+#endif
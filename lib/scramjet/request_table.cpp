@@ -0,0 +1,188 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include "scramjet/request_table.hpp"
+
+namespace scramjet {
+
+request_table::request_table()
+        : m_index(INITIAL_INDEX_SIZE, index_entry{0, NO_SLOT})
+        , m_free_slot(NO_SLOT)
+        , m_size(0)
+        , m_shift(32 - 8)
+{
+}
+
+size_t request_table::bucket_of(uint32_t id) const noexcept
+{
+	return static_cast<size_t>(static_cast<uint32_t>(id * UINT32_C(2654435769)) >> m_shift);
+}
+
+request_slot& request_table::insert(uint32_t id)
+{
+	if ((m_size + 1) * 2 > m_index.size()) {
+		grow();
+	}
+
+	uint32_t slot_index = m_free_slot;
+	if (slot_index != NO_SLOT) {
+		m_free_slot = m_slots[slot_index].next_free;
+	} else {
+		slot_index = static_cast<uint32_t>(m_slots.size());
+		m_slots.emplace_back();
+		m_slots.back().index = slot_index;
+	}
+
+	request_slot& slot = m_slots[slot_index];
+	slot.id = id;
+	slot.next_free = NO_SLOT;
+	slot.pending = true;
+	slot.sending = false;
+
+	size_t mask = m_index.size() - 1;
+	size_t bucket = bucket_of(id);
+	while (m_index[bucket].slot_index != NO_SLOT) {
+		bucket = (bucket + 1) & mask;
+	}
+
+	m_index[bucket].id = id;
+	m_index[bucket].slot_index = slot_index;
+	m_size++;
+	return slot;
+}
+
+request_slot* request_table::find(uint32_t id) noexcept
+{
+	size_t mask = m_index.size() - 1;
+	size_t bucket = bucket_of(id);
+	while (m_index[bucket].slot_index != NO_SLOT) {
+		if (m_index[bucket].id == id) {
+			return &m_slots[m_index[bucket].slot_index];
+		}
+
+		bucket = (bucket + 1) & mask;
+	}
+
+	return nullptr;
+}
+
+void request_table::erase(request_slot& slot) noexcept
+{
+	size_t mask = m_index.size() - 1;
+	size_t hole = bucket_of(slot.id);
+	while (m_index[hole].slot_index != slot.index) {
+		if (m_index[hole].slot_index == NO_SLOT) {
+			return;
+		}
+
+		hole = (hole + 1) & mask;
+	}
+
+	size_t next = hole;
+	for (;;) {
+		next = (next + 1) & mask;
+		if (m_index[next].slot_index == NO_SLOT) {
+			break;
+		}
+
+		size_t home = bucket_of(m_index[next].id);
+		bool stays = (hole <= next) ? ((hole < home) && (home <= next)) : ((hole < home) || (home <= next));
+		if (!stays) {
+			m_index[hole] = m_index[next];
+			hole = next;
+		}
+	}
+
+	m_index[hole].slot_index = NO_SLOT;
+	m_size--;
+
+	slot.pending = false;
+	slot.timeout.cancel();
+	slot.callback = nullptr;
+	if (!slot.sending) {
+		put_free_slot(slot.index);
+	}
+}
+
+void request_table::sent(uint32_t slot_index) noexcept
+{
+	request_slot& slot = m_slots[slot_index];
+	slot.sending = false;
+	if (!slot.pending) {
+		put_free_slot(slot_index);
+	}
+}
+
+request_slot& request_table::at(uint32_t slot_index) noexcept
+{
+	return m_slots[slot_index];
+}
+
+size_t request_table::slot_count(void) const noexcept
+{
+	return m_slots.size();
+}
+
+size_t request_table::size(void) const noexcept
+{
+	return m_size;
+}
+
+void request_table::put_free_slot(uint32_t slot_index) noexcept
+{
+	m_slots[slot_index].next_free = m_free_slot;
+	m_free_slot = slot_index;
+}
+
+void request_table::grow(void)
+{
+	std::vector<index_entry> old_index(m_index.size() * 2, index_entry{0, NO_SLOT});
+	old_index.swap(m_index);
+	m_shift--;
+
+	size_t mask = m_index.size() - 1;
+	for (const index_entry& entry : old_index) {
+		if (entry.slot_index == NO_SLOT) {
+			continue;
+		}
+
+		size_t bucket = bucket_of(entry.id);
+		while (m_index[bucket].slot_index != NO_SLOT) {
+			bucket = (bucket + 1) & mask;
+		}
+
+		m_index[bucket] = entry;
+	}
+}
+
+} // namespace scramjet
@@ -0,0 +1,94 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCRAMJET__REQUEST_TABLE_HPP
+#define SCRAMJET__REQUEST_TABLE_HPP
+
+#include <chrono>
+#include <cstdbool>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+
+#include "scramjet/error_code.hpp"
+#include "scramjet/small_function.hpp"
+#include "scramjet/timer_wheel.hpp"
+
+namespace scramjet {
+
+typedef small_function<void(enum error_code ec, const uint8_t* response, size_t response_length)> response_callback_t;
+
+struct request_slot {
+	uint32_t id;
+	uint32_t index;
+	uint32_t next_free;
+	bool pending;
+	bool sending;
+	wheel_timer timeout;
+	std::chrono::steady_clock::time_point started;
+	response_callback_t callback;
+	std::vector<uint8_t> frame;
+};
+
+class request_table final {
+public:
+	request_table();
+
+	request_slot& insert(uint32_t id);
+	request_slot* find(uint32_t id) noexcept;
+	void erase(request_slot& slot) noexcept;
+	void sent(uint32_t slot_index) noexcept;
+
+	request_slot& at(uint32_t slot_index) noexcept;
+	size_t slot_count(void) const noexcept;
+	size_t size(void) const noexcept;
+
+private:
+	struct index_entry {
+		uint32_t id;
+		uint32_t slot_index;
+	};
+
+	std::vector<index_entry> m_index;
+	std::deque<request_slot> m_slots;
+	uint32_t m_free_slot;
+	size_t m_size;
+	unsigned int m_shift;
+
+	static const uint32_t NO_SLOT = UINT32_MAX;
+	static const size_t INITIAL_INDEX_SIZE = 256;
+
+	size_t bucket_of(uint32_t id) const noexcept;
+	void grow(void);
+	void put_free_slot(uint32_t slot_index) noexcept;
+};
+
+} // namespace scramjet
+
+#endif
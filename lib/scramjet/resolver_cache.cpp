@@ -0,0 +1,164 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include "scramjet/resolver_cache.hpp"
+
+namespace scramjet {
+
+boost::asio::io_context::id resolver_cache::id;
+
+const std::chrono::milliseconds resolver_cache::DEFAULT_TTL(30000);
+
+resolver_cache::resolver_cache(boost::asio::io_context& ioc)
+        : boost::asio::io_context::service(ioc)
+        , m_ttl(DEFAULT_TTL)
+{
+}
+
+resolver_cache::~resolver_cache() noexcept
+{
+	shutdown();
+}
+
+void resolver_cache::shutdown()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto& entry : m_entries) {
+		if (entry.second.resolver) {
+			entry.second.resolver->cancel();
+		}
+	}
+}
+
+std::string resolver_cache::key_of(const std::string& host, uint16_t port)
+{
+	return host + ':' + std::to_string(static_cast<unsigned>(port));
+}
+
+void resolver_cache::set_ttl(std::chrono::milliseconds ttl) noexcept
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_ttl = ttl;
+}
+
+std::chrono::milliseconds resolver_cache::get_ttl(void) const noexcept
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_ttl;
+}
+
+void resolver_cache::resolve(const std::string& host, uint16_t port, const resolve_callback_t& callback)
+{
+	std::string key = key_of(host, port);
+	std::unique_lock<std::mutex> lock(m_mutex);
+	cache_entry& entry = m_entries[key];
+	if (!entry.endpoints.empty() && (std::chrono::steady_clock::now() < entry.expires)) {
+		std::vector<boost::asio::ip::tcp::endpoint> endpoints = entry.endpoints;
+		lock.unlock();
+		callback(boost::system::error_code(), endpoints);
+		return;
+	}
+
+	entry.waiters.push_back(callback);
+	if (entry.resolver) {
+		return;
+	}
+
+	entry.resolver.reset(new boost::asio::ip::tcp::resolver(get_io_context()));
+	entry.resolver->async_resolve(host, std::to_string(static_cast<unsigned>(port)),
+	                              [this, key](const boost::system::error_code& ec, boost::asio::ip::tcp::resolver::results_type results) {
+		                              resolved(key, ec, std::move(results));
+	                              });
+}
+
+void resolver_cache::resolved(const std::string& key, const boost::system::error_code& ec, boost::asio::ip::tcp::resolver::results_type results)
+{
+	std::vector<resolve_callback_t> waiters;
+	std::vector<boost::asio::ip::tcp::endpoint> endpoints;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_entries.find(key);
+		if (it == m_entries.end()) {
+			return;
+		}
+
+		cache_entry& entry = it->second;
+		for (const auto& result : results) {
+			endpoints.push_back(result.endpoint());
+		}
+
+		if (!ec && !endpoints.empty()) {
+			entry.endpoints = endpoints;
+			entry.expires = std::chrono::steady_clock::now() + m_ttl;
+		}
+
+		waiters.swap(entry.waiters);
+		entry.resolver.reset();
+		if (entry.endpoints.empty()) {
+			m_entries.erase(it);
+		}
+	}
+
+	boost::system::error_code result = ec;
+	if (!result && endpoints.empty()) {
+		result = boost::asio::error::host_not_found;
+	}
+
+	for (resolve_callback_t& waiter : waiters) {
+		waiter(result, endpoints);
+	}
+}
+
+void resolver_cache::invalidate(const std::string& host, uint16_t port) noexcept
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_entries.find(key_of(host, port));
+	if (it == m_entries.end()) {
+		return;
+	}
+
+	if (it->second.resolver) {
+		it->second.endpoints.clear();
+	} else {
+		m_entries.erase(it);
+	}
+}
+
+} // namespace scramjet
@@ -0,0 +1,87 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCRAMJET__RESOLVER_CACHE_HPP
+#define SCRAMJET__RESOLVER_CACHE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include "scramjet/small_function.hpp"
+
+namespace scramjet {
+
+typedef small_function<void(const boost::system::error_code& ec, const std::vector<boost::asio::ip::tcp::endpoint>& endpoints)> resolve_callback_t;
+
+// Caches name resolution for all connections of an io_context. Concurrent
+// lookups of the same name share one resolver query. Callbacks are invoked
+// synchronously on a cache hit and from the io_context otherwise.
+class resolver_cache final : public boost::asio::io_context::service {
+public:
+	static boost::asio::io_context::id id;
+
+	explicit resolver_cache(boost::asio::io_context& ioc);
+	virtual ~resolver_cache() noexcept;
+
+	void resolve(const std::string& host, uint16_t port, const resolve_callback_t& callback);
+	void invalidate(const std::string& host, uint16_t port) noexcept;
+
+	void set_ttl(std::chrono::milliseconds ttl) noexcept;
+	std::chrono::milliseconds get_ttl(void) const noexcept;
+
+	static const std::chrono::milliseconds DEFAULT_TTL;
+
+private:
+	struct cache_entry {
+		std::vector<boost::asio::ip::tcp::endpoint> endpoints;
+		std::chrono::steady_clock::time_point expires;
+		std::unique_ptr<boost::asio::ip::tcp::resolver> resolver;
+		std::vector<resolve_callback_t> waiters;
+	};
+
+	mutable std::mutex m_mutex;
+	std::chrono::milliseconds m_ttl;
+	std::map<std::string, cache_entry> m_entries;
+
+	virtual void shutdown() override;
+
+	static std::string key_of(const std::string& host, uint16_t port);
+	void resolved(const std::string& key, const boost::system::error_code& ec, boost::asio::ip::tcp::resolver::results_type results);
+};
+
+} // namespace scramjet
+
+#endif
@@ -0,0 +1,572 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/asio.hpp>
+#include <boost/endian/conversion.hpp>
+
+#include "scramjet/handler_allocator.hpp"
+#include "scramjet/jet_connection.hpp"
+#include "scramjet/receive_buffer.hpp"
+#include "scramjet/shm_jet_connection.hpp"
+#include "scramjet/shm_ring.hpp"
+#include "scramjet/statistics.hpp"
+#include "scramjet/timer_wheel.hpp"
+
+namespace scramjet {
+
+static void signal_event(boost::asio::posix::stream_descriptor& event) noexcept
+{
+	uint64_t value = 1;
+	ssize_t ret = ::write(event.native_handle(), &value, sizeof(value));
+	(void)ret;
+}
+
+static void drain_event(boost::asio::posix::stream_descriptor& event) noexcept
+{
+	uint64_t value;
+	ssize_t ret = ::read(event.native_handle(), &value, sizeof(value));
+	(void)ret;
+}
+
+static void close_descriptor(boost::asio::posix::stream_descriptor& descriptor) noexcept
+{
+	boost::system::error_code ec;
+	descriptor.close(ec);
+}
+
+shm_jet_connection::shm_jet_connection(boost::asio::io_context& ioc, const std::string& path) noexcept
+        : m_io_context(ioc)
+        , m_strand(boost::asio::make_strand(ioc))
+        , m_path(path)
+        , m_control_socket(ioc)
+        , m_rx_data_event(ioc)
+        , m_rx_space_event(ioc)
+        , m_tx_data_event(ioc)
+        , m_tx_space_event(ioc)
+        , m_timer_wheel(boost::asio::use_service<timer_wheel>(ioc))
+{
+}
+
+shm_jet_connection::~shm_jet_connection() noexcept
+{
+	release_segment();
+}
+
+void shm_jet_connection::connect(const connected_callback_t& connect_callback, std::chrono::milliseconds timeout) noexcept
+{
+	if (!m_strand.running_in_this_thread()) {
+		boost::asio::post(m_strand, std::bind(&shm_jet_connection::connect, this, connect_callback, timeout));
+		return;
+	}
+
+	m_connected_callback = connect_callback;
+	m_connect_timeout = timeout;
+
+	std::string path = m_path;
+	if (!path.empty() && (path[0] == '@')) {
+		path[0] = '\0';
+	}
+
+	boost::asio::local::stream_protocol::endpoint ep(path);
+
+	using namespace std::placeholders;
+	m_control_socket.async_connect(ep, boost::asio::bind_executor(m_strand, std::bind(&shm_jet_connection::control_connected, this, _1)));
+	uint64_t generation = ++m_connect_generation;
+	m_timer_wheel.schedule(m_connect_timer, timeout, [this, generation]() {
+		boost::asio::post(m_strand, std::bind(&shm_jet_connection::connect_timeout_handler, this, generation));
+	});
+}
+
+void shm_jet_connection::stop_connect_timeout(void) noexcept
+{
+	m_connect_timer.cancel();
+	m_connect_generation++;
+}
+
+void shm_jet_connection::connect_timeout_handler(uint64_t generation) noexcept
+{
+	if (generation != m_connect_generation) {
+		return;
+	}
+
+	boost::system::error_code ec;
+	m_control_socket.cancel(ec);
+	m_control_socket.close(ec);
+}
+
+void shm_jet_connection::control_connected(const boost::system::error_code& ec) noexcept
+{
+	if (ec) {
+		stop_connect_timeout();
+		if (ec == boost::asio::error::operation_aborted) {
+			m_connected_callback(SCRAMJET_OPERATION_ABORTED);
+			return;
+		}
+
+		m_connected_callback(SCRAMJET_CONNECTION_REFUSED);
+		return;
+	}
+
+	using namespace std::placeholders;
+	m_control_socket.async_wait(boost::asio::socket_base::wait_read, boost::asio::bind_executor(m_strand, std::bind(&shm_jet_connection::segment_received, this, _1)));
+}
+
+void shm_jet_connection::segment_received(const boost::system::error_code& ec) noexcept
+{
+	stop_connect_timeout();
+	if (ec) {
+		if (ec == boost::asio::error::operation_aborted) {
+			m_connected_callback(SCRAMJET_OPERATION_ABORTED);
+			return;
+		}
+
+		m_connected_callback(SCRAMJET_CONNECTION_REFUSED);
+		return;
+	}
+
+	if (!map_segment()) {
+		release_segment();
+		m_connected_callback(SCRAMJET_WRONG_MESSAGE_FORMAT);
+		return;
+	}
+
+	using namespace std::placeholders;
+	m_control_socket.async_wait(boost::asio::socket_base::wait_read, boost::asio::bind_executor(m_strand, std::bind(&shm_jet_connection::control_readable, this, _1)));
+	m_connected_callback(SCRAMJET_OK);
+}
+
+bool shm_jet_connection::map_segment(void) noexcept
+{
+	int fds[SHM_DESCRIPTOR_COUNT];
+	uint8_t byte;
+	struct iovec iov;
+	iov.iov_base = &byte;
+	iov.iov_len = sizeof(byte);
+
+	union {
+		struct cmsghdr header;
+		uint8_t buffer[CMSG_SPACE(sizeof(fds))];
+	} control;
+	std::memset(&control, 0, sizeof(control));
+
+	struct msghdr msg;
+	std::memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buffer;
+	msg.msg_controllen = sizeof(control.buffer);
+
+	ssize_t ret = ::recvmsg(m_control_socket.native_handle(), &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+	struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+	if ((ret <= 0) || (cmsg == nullptr) || (cmsg->cmsg_level != SOL_SOCKET) || (cmsg->cmsg_type != SCM_RIGHTS)) {
+		return false;
+	}
+
+	std::size_t fd_count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+	std::memcpy(fds, CMSG_DATA(cmsg), std::min(fd_count, static_cast<std::size_t>(SHM_DESCRIPTOR_COUNT)) * sizeof(int));
+	if (fd_count != SHM_DESCRIPTOR_COUNT) {
+		for (std::size_t i = 0; i < std::min(fd_count, static_cast<std::size_t>(SHM_DESCRIPTOR_COUNT)); i++) {
+			::close(fds[i]);
+		}
+
+		return false;
+	}
+
+	m_rx_data_event.assign(fds[SHM_RX_DATA_EVENT]);
+	m_rx_space_event.assign(fds[SHM_RX_SPACE_EVENT]);
+	m_tx_data_event.assign(fds[SHM_TX_DATA_EVENT]);
+	m_tx_space_event.assign(fds[SHM_TX_SPACE_EVENT]);
+
+	struct stat st;
+	if (::fstat(fds[SHM_SEGMENT], &st) < 0) {
+		::close(fds[SHM_SEGMENT]);
+		return false;
+	}
+
+	std::size_t size = static_cast<std::size_t>(st.st_size);
+	void* segment = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fds[SHM_SEGMENT], 0);
+	::close(fds[SHM_SEGMENT]);
+	if (segment == MAP_FAILED) {
+		return false;
+	}
+
+	m_segment = segment;
+	m_segment_size = size;
+	if (size < shm_ring::HEADER_SIZE) {
+		return false;
+	}
+
+	uint64_t rx_capacity = static_cast<shm_ring_header*>(segment)->capacity;
+	if ((rx_capacity == 0) || ((rx_capacity & (rx_capacity - 1)) != 0) || (size < shm_ring::get_segment_size(rx_capacity) + shm_ring::HEADER_SIZE)) {
+		return false;
+	}
+
+	uint8_t* tx_memory = static_cast<uint8_t*>(segment) + shm_ring::get_segment_size(rx_capacity);
+	uint64_t tx_capacity = reinterpret_cast<shm_ring_header*>(tx_memory)->capacity;
+	if ((tx_capacity == 0) || ((tx_capacity & (tx_capacity - 1)) != 0) || (size < shm_ring::get_segment_size(rx_capacity) + shm_ring::get_segment_size(tx_capacity))) {
+		return false;
+	}
+
+	m_rx.attach(segment, rx_capacity);
+	m_tx.attach(tx_memory, tx_capacity);
+	return true;
+}
+
+void shm_jet_connection::release_segment(void) noexcept
+{
+	boost::system::error_code ec;
+	m_control_socket.cancel(ec);
+	m_control_socket.close(ec);
+	close_descriptor(m_rx_data_event);
+	close_descriptor(m_rx_space_event);
+	close_descriptor(m_tx_data_event);
+	close_descriptor(m_tx_space_event);
+
+	m_rx.detach();
+	m_tx.detach();
+	if (m_segment != nullptr) {
+		::munmap(m_segment, m_segment_size);
+		m_segment = nullptr;
+		m_segment_size = 0;
+	}
+
+	m_message = nullptr;
+	m_message_length = 0;
+	m_waiting_for_space = false;
+}
+
+void shm_jet_connection::control_readable(const boost::system::error_code& ec) noexcept
+{
+	if (ec == boost::asio::error::operation_aborted) {
+		return;
+	}
+
+	if (!ec) {
+		uint8_t byte;
+		ssize_t ret = ::recv(m_control_socket.native_handle(), &byte, sizeof(byte), MSG_DONTWAIT);
+		if ((ret > 0) || ((ret < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))) {
+			using namespace std::placeholders;
+			m_control_socket.async_wait(boost::asio::socket_base::wait_read, boost::asio::bind_executor(m_strand, std::bind(&shm_jet_connection::control_readable, this, _1)));
+			return;
+		}
+	}
+
+	fail_send_queue(SCRAMJET_CONNECTION_CLOSED);
+	if (m_receiving) {
+		m_receiving = false;
+		m_message_received_callback(SCRAMJET_CONNECTION_CLOSED, nullptr, 0);
+	}
+}
+
+void shm_jet_connection::disconnect(void) noexcept
+{
+	if (!m_strand.running_in_this_thread()) {
+		boost::asio::post(m_strand, std::bind(&shm_jet_connection::disconnect, this));
+		return;
+	}
+
+	m_receiving = false;
+	stop_connect_timeout();
+	release_segment();
+	fail_send_queue(SCRAMJET_OPERATION_ABORTED);
+}
+
+void shm_jet_connection::receive_message(const message_received_callback_t& callback) noexcept
+{
+	if (!m_strand.running_in_this_thread()) {
+		boost::asio::post(m_strand, std::bind(&shm_jet_connection::receive_message, this, callback));
+		return;
+	}
+
+	if (m_dispatching) {
+		m_pending_message_received_callback = callback;
+		return;
+	}
+
+	m_message_received_callback = callback;
+	if (!m_receiving) {
+		m_receiving = true;
+		read_messages();
+	}
+}
+
+message_ref shm_jet_connection::retain_message(void) noexcept
+{
+	if (m_message == nullptr) {
+		return message_ref();
+	}
+
+	uint32_t length = boost::endian::native_to_little(static_cast<uint32_t>(m_message_length));
+	uint8_t* buffer = m_retain_buffer.prepare(sizeof(length) + m_message_length);
+	std::memcpy(buffer, &length, sizeof(length));
+	std::memcpy(buffer + sizeof(length), m_message, m_message_length);
+	m_retain_buffer.commit(sizeof(length) + m_message_length);
+
+	const uint8_t* message;
+	std::size_t message_length;
+	m_retain_buffer.next_message(message, message_length);
+	message_ref ref = m_retain_buffer.retain_message();
+	m_retain_buffer.consume_message();
+	return ref;
+}
+
+boost::asio::io_context& shm_jet_connection::get_io_context(void) noexcept
+{
+	return m_io_context;
+}
+
+strand_t& shm_jet_connection::get_strand(void) noexcept
+{
+	return m_strand;
+}
+
+void shm_jet_connection::read_messages(void) noexcept
+{
+	m_read_scheduled = false;
+	if (!m_receiving || !m_rx.is_attached()) {
+		return;
+	}
+
+	unsigned int count = 0;
+	enum error_code ec = SCRAMJET_OK;
+	m_dispatching = true;
+	while (m_receiving && (count < MAX_READ_BATCH) && m_rx.read(m_message, m_message_length, get_max_frame_size(), m_scratch, ec)) {
+		counter_add(m_counters.frames_received, 1);
+		counter_add(m_counters.bytes_received, sizeof(uint32_t) + m_message_length);
+		m_message_received_callback(SCRAMJET_OK, m_message, m_message_length);
+		m_message = nullptr;
+		if (!m_rx.is_attached()) {
+			break;
+		}
+
+		m_rx.consume();
+		count++;
+
+		if (m_pending_message_received_callback != nullptr) {
+			m_message_received_callback = std::move(m_pending_message_received_callback);
+			m_pending_message_received_callback = nullptr;
+		}
+	}
+
+	m_dispatching = false;
+	if (count > 0) {
+		counter_add(m_counters.reads, 1);
+	}
+
+	if (ec != SCRAMJET_OK) {
+		fail_receive(ec);
+		return;
+	}
+
+	if (!m_rx.is_attached()) {
+		return;
+	}
+
+	if ((count > 0) && m_rx.producer_needs_wakeup()) {
+		signal_event(m_rx_space_event);
+	}
+
+	if (!m_receiving) {
+		return;
+	}
+
+	if (!m_rx.prepare_consumer_wait()) {
+		m_read_scheduled = true;
+		boost::asio::post(m_strand, make_alloc_handler(m_read_handler_memory, std::bind(&shm_jet_connection::read_messages, this)));
+		return;
+	}
+
+	using namespace std::placeholders;
+	m_rx_data_event.async_wait(boost::asio::posix::descriptor_base::wait_read, boost::asio::bind_executor(m_strand, make_alloc_handler(m_read_handler_memory, std::bind(&shm_jet_connection::rx_data_signalled, this, _1))));
+}
+
+void shm_jet_connection::fail_receive(enum error_code ec) noexcept
+{
+	m_receiving = false;
+	stop_connect_timeout();
+	release_segment();
+	fail_send_queue(SCRAMJET_CONNECTION_CLOSED);
+	m_message_received_callback(ec, nullptr, 0);
+}
+
+void shm_jet_connection::rx_data_signalled(const boost::system::error_code& ec) noexcept
+{
+	if (ec || !m_rx.is_attached()) {
+		return;
+	}
+
+	drain_event(m_rx_data_event);
+	if (!m_read_scheduled) {
+		read_messages();
+	}
+}
+
+void shm_jet_connection::send_message(const uint8_t* message, size_t message_length, const message_sent_callback_t& callback) noexcept
+{
+	if (!m_strand.running_in_this_thread()) {
+		boost::asio::post(m_strand, std::bind(&shm_jet_connection::send_message, this, message, message_length, callback));
+		return;
+	}
+
+	send_request request;
+	request.message = message;
+	request.message_length = message_length;
+	request.result = SCRAMJET_OK;
+	request.callback = callback;
+	m_send_queue.push_back(std::move(request));
+	bytes_queued(sizeof(uint32_t) + message_length);
+	schedule_flush();
+}
+
+void shm_jet_connection::schedule_flush(void) noexcept
+{
+	if (m_flush_scheduled || m_waiting_for_space) {
+		return;
+	}
+
+	m_flush_scheduled = true;
+	boost::asio::post(m_strand, make_alloc_handler(m_flush_handler_memory, std::bind(&shm_jet_connection::flush_send_queue, this)));
+}
+
+void shm_jet_connection::flush_send_queue(void) noexcept
+{
+	m_flush_scheduled = false;
+	if (!m_tx.is_attached()) {
+		fail_send_queue(SCRAMJET_CONNECTION_CLOSED);
+		return;
+	}
+
+	std::size_t position = m_send_position;
+	bool published = false;
+	while (position < m_send_queue.size()) {
+		send_request& request = m_send_queue[position];
+		if ((request.message_length > get_max_frame_size()) || (sizeof(uint32_t) + request.message_length > m_tx.get_capacity())) {
+			request.result = SCRAMJET_FRAME_TOO_LARGE;
+		} else if (m_tx.write(request.message, request.message_length)) {
+			published = true;
+			counter_add(m_counters.frames_sent, 1);
+			counter_add(m_counters.bytes_sent, sizeof(uint32_t) + request.message_length);
+		} else {
+			break;
+		}
+
+		position++;
+	}
+
+	if (published) {
+		counter_add(m_counters.writes, 1);
+		if (m_tx.consumer_needs_wakeup()) {
+			signal_event(m_tx_data_event);
+		}
+	}
+
+	for (std::size_t i = m_send_position; i < position; i++) {
+		m_completed.push_back(std::move(m_send_queue[i]));
+	}
+
+	if (position == m_send_queue.size()) {
+		m_send_queue.clear();
+		m_send_position = 0;
+	} else if (position * 2 > m_send_queue.size()) {
+		m_send_queue.erase(m_send_queue.begin(), m_send_queue.begin() + static_cast<std::ptrdiff_t>(position));
+		m_send_position = 0;
+	} else {
+		m_send_position = position;
+	}
+
+	if (m_send_position < m_send_queue.size()) {
+		if (m_tx.prepare_producer_wait(m_send_queue[m_send_position].message_length)) {
+			m_waiting_for_space = true;
+			using namespace std::placeholders;
+			m_tx_space_event.async_wait(boost::asio::posix::descriptor_base::wait_read, boost::asio::bind_executor(m_strand, make_alloc_handler(m_write_handler_memory, std::bind(&shm_jet_connection::tx_space_signalled, this, _1))));
+		} else {
+			schedule_flush();
+		}
+	}
+
+	std::size_t drained = 0;
+	for (const send_request& request : m_completed) {
+		drained += sizeof(uint32_t) + request.message_length;
+	}
+
+	bytes_drained(drained);
+	for (send_request& request : m_completed) {
+		if (request.callback != nullptr) {
+			request.callback(request.result);
+		}
+	}
+
+	m_completed.clear();
+}
+
+void shm_jet_connection::tx_space_signalled(const boost::system::error_code& ec) noexcept
+{
+	m_waiting_for_space = false;
+	if (ec || !m_tx.is_attached()) {
+		return;
+	}
+
+	drain_event(m_tx_space_event);
+	flush_send_queue();
+}
+
+void shm_jet_connection::fail_send_queue(enum error_code ec) noexcept
+{
+	std::vector<send_request> failed;
+	failed.swap(m_send_queue);
+	failed.erase(failed.begin(), failed.begin() + static_cast<std::ptrdiff_t>(m_send_position));
+	m_send_position = 0;
+
+	std::size_t drained = 0;
+	for (const send_request& request : failed) {
+		drained += sizeof(uint32_t) + request.message_length;
+	}
+
+	bytes_drained(drained);
+	for (send_request& request : failed) {
+		if (request.callback != nullptr) {
+			request.callback(ec);
+		}
+	}
+}
+
+} // namespace scramjet
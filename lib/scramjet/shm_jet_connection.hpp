@@ -0,0 +1,134 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCRAMJET__SHM_JET_CONNECTION_HPP
+#define SCRAMJET__SHM_JET_CONNECTION_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "scramjet/handler_allocator.hpp"
+#include "scramjet/jet_connection.hpp"
+#include "scramjet/receive_buffer.hpp"
+#include "scramjet/shm_ring.hpp"
+#include "scramjet/timer_wheel.hpp"
+
+namespace scramjet {
+
+class shm_jet_connection final : public jet_connection {
+public:
+	virtual void connect(const connected_callback_t& connect_callback, std::chrono::milliseconds timeout) noexcept override;
+	virtual void disconnect(void) noexcept override;
+	virtual void receive_message(const message_received_callback_t& callback) noexcept override;
+	virtual message_ref retain_message(void) noexcept override;
+	virtual boost::asio::io_context& get_io_context(void) noexcept override;
+	virtual strand_t& get_strand(void) noexcept override;
+	virtual void send_message(const uint8_t* message, size_t message_length, const message_sent_callback_t& callback) noexcept override;
+
+	shm_jet_connection(boost::asio::io_context& ioc, const std::string& path) noexcept;
+	virtual ~shm_jet_connection() noexcept;
+
+	enum shm_descriptor {
+		SHM_SEGMENT = 0,
+		SHM_RX_DATA_EVENT,
+		SHM_RX_SPACE_EVENT,
+		SHM_TX_DATA_EVENT,
+		SHM_TX_SPACE_EVENT,
+		SHM_DESCRIPTOR_COUNT
+	};
+
+private:
+	struct send_request {
+		const uint8_t* message;
+		size_t message_length;
+		enum error_code result;
+		message_sent_callback_t callback;
+	};
+
+	boost::asio::io_context& m_io_context;
+	strand_t m_strand;
+	const std::string m_path;
+	boost::asio::local::stream_protocol::socket m_control_socket;
+	boost::asio::posix::stream_descriptor m_rx_data_event;
+	boost::asio::posix::stream_descriptor m_rx_space_event;
+	boost::asio::posix::stream_descriptor m_tx_data_event;
+	boost::asio::posix::stream_descriptor m_tx_space_event;
+	timer_wheel& m_timer_wheel;
+	wheel_timer m_connect_timer;
+	uint64_t m_connect_generation = 0;
+
+	void* m_segment = nullptr;
+	std::size_t m_segment_size = 0;
+	shm_ring m_rx;
+	shm_ring m_tx;
+	std::vector<uint8_t> m_scratch;
+	receive_buffer m_retain_buffer;
+	const uint8_t* m_message = nullptr;
+	std::size_t m_message_length = 0;
+
+	handler_memory m_read_handler_memory;
+	handler_memory m_write_handler_memory;
+	handler_memory m_flush_handler_memory;
+
+	bool m_receiving = false;
+	bool m_dispatching = false;
+	bool m_read_scheduled = false;
+	message_received_callback_t m_pending_message_received_callback = nullptr;
+
+	std::vector<send_request> m_send_queue;
+	std::vector<send_request> m_completed;
+	std::size_t m_send_position = 0;
+	bool m_flush_scheduled = false;
+	bool m_waiting_for_space = false;
+
+	static const unsigned int MAX_READ_BATCH = 256;
+
+	void control_connected(const boost::system::error_code& ec) noexcept;
+	void segment_received(const boost::system::error_code& ec) noexcept;
+	void control_readable(const boost::system::error_code& ec) noexcept;
+	void connect_timeout_handler(uint64_t generation) noexcept;
+	void stop_connect_timeout(void) noexcept;
+	bool map_segment(void) noexcept;
+	void release_segment(void) noexcept;
+
+	void read_messages(void) noexcept;
+	void fail_receive(enum error_code ec) noexcept;
+	void rx_data_signalled(const boost::system::error_code& ec) noexcept;
+
+	void schedule_flush(void) noexcept;
+	void flush_send_queue(void) noexcept;
+	void tx_space_signalled(const boost::system::error_code& ec) noexcept;
+	void fail_send_queue(enum error_code ec) noexcept;
+};
+} // namespace scramjet
+
+#endif
@@ -0,0 +1,224 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include <boost/endian/conversion.hpp>
+
+#include "scramjet/shm_ring.hpp"
+
+namespace scramjet {
+
+static_assert(sizeof(shm_ring_header) <= shm_ring::HEADER_SIZE, "shm_ring_header does not fit into HEADER_SIZE");
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shm_ring requires lock-free 64 bit atomics");
+
+shm_ring::shm_ring() noexcept
+        : m_header(nullptr)
+        , m_data(nullptr)
+        , m_capacity(0)
+        , m_mask(0)
+        , m_read_length(0)
+{
+}
+
+std::size_t shm_ring::get_segment_size(std::size_t capacity) noexcept
+{
+	return HEADER_SIZE + capacity;
+}
+
+void shm_ring::init(void* memory, std::size_t capacity) noexcept
+{
+	shm_ring_header* header = new (memory) shm_ring_header;
+	header->head.store(0, std::memory_order_relaxed);
+	header->tail.store(0, std::memory_order_relaxed);
+	header->consumer_waiting.store(0, std::memory_order_relaxed);
+	header->producer_waiting.store(0, std::memory_order_relaxed);
+	header->capacity = capacity;
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+void shm_ring::attach(void* memory, uint64_t capacity) noexcept
+{
+	m_header = static_cast<shm_ring_header*>(memory);
+	m_data = static_cast<uint8_t*>(memory) + HEADER_SIZE;
+	m_capacity = capacity;
+	m_mask = m_capacity - 1;
+	m_read_length = 0;
+}
+
+void shm_ring::detach(void) noexcept
+{
+	m_header = nullptr;
+	m_data = nullptr;
+	m_capacity = 0;
+	m_mask = 0;
+	m_read_length = 0;
+}
+
+bool shm_ring::is_attached(void) const noexcept
+{
+	return m_header != nullptr;
+}
+
+std::size_t shm_ring::get_capacity(void) const noexcept
+{
+	return static_cast<std::size_t>(m_capacity);
+}
+
+void shm_ring::copy_in(uint64_t position, const uint8_t* data, std::size_t length) noexcept
+{
+	std::size_t offset = static_cast<std::size_t>(position & m_mask);
+	std::size_t first = std::min(length, get_capacity() - offset);
+	std::memcpy(m_data + offset, data, first);
+	std::memcpy(m_data, data + first, length - first);
+}
+
+void shm_ring::copy_out(uint64_t position, uint8_t* data, std::size_t length) const noexcept
+{
+	std::size_t offset = static_cast<std::size_t>(position & m_mask);
+	std::size_t first = std::min(length, get_capacity() - offset);
+	std::memcpy(data, m_data + offset, first);
+	std::memcpy(data + first, m_data, length - first);
+}
+
+bool shm_ring::write(const uint8_t* message, std::size_t message_length) noexcept
+{
+	uint64_t head = m_header->head.load(std::memory_order_relaxed);
+	uint64_t tail = m_header->tail.load(std::memory_order_acquire);
+	uint64_t frame_length = sizeof(uint32_t) + message_length;
+	if (m_capacity - (head - tail) < frame_length) {
+		return false;
+	}
+
+	uint32_t length = boost::endian::native_to_little(static_cast<uint32_t>(message_length));
+	copy_in(head, reinterpret_cast<const uint8_t*>(&length), sizeof(length));
+	copy_in(head + sizeof(length), message, message_length);
+	m_header->head.store(head + frame_length, std::memory_order_release);
+	return true;
+}
+
+bool shm_ring::prepare_producer_wait(std::size_t message_length) noexcept
+{
+	m_header->producer_waiting.store(1, std::memory_order_seq_cst);
+	uint64_t head = m_header->head.load(std::memory_order_relaxed);
+	uint64_t tail = m_header->tail.load(std::memory_order_seq_cst);
+	if (m_capacity - (head - tail) >= sizeof(uint32_t) + message_length) {
+		m_header->producer_waiting.store(0, std::memory_order_relaxed);
+		return false;
+	}
+
+	return true;
+}
+
+bool shm_ring::consumer_needs_wakeup(void) noexcept
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_header->consumer_waiting.load(std::memory_order_seq_cst) == 0) {
+		return false;
+	}
+
+	m_header->consumer_waiting.store(0, std::memory_order_relaxed);
+	return true;
+}
+
+bool shm_ring::read(const uint8_t*& message, std::size_t& message_length, std::size_t max_message_length, std::vector<uint8_t>& scratch, enum error_code& ec)
+{
+	ec = SCRAMJET_OK;
+	uint64_t tail = m_header->tail.load(std::memory_order_relaxed);
+	uint64_t head = m_header->head.load(std::memory_order_acquire);
+	uint64_t available = head - tail;
+	uint32_t length;
+	if (available < sizeof(length)) {
+		return false;
+	}
+
+	// Both indices and the prefix are written by the other process.
+	copy_out(tail, reinterpret_cast<uint8_t*>(&length), sizeof(length));
+	boost::endian::little_to_native_inplace(length);
+	if ((available > m_capacity) || (length > available - sizeof(length))) {
+		ec = SCRAMJET_WRONG_MESSAGE_FORMAT;
+		return false;
+	}
+
+	if (length > max_message_length) {
+		ec = SCRAMJET_FRAME_TOO_LARGE;
+		return false;
+	}
+
+	uint64_t start = tail + sizeof(length);
+	std::size_t offset = static_cast<std::size_t>(start & m_mask);
+	if (offset + length <= get_capacity()) {
+		message = m_data + offset;
+	} else {
+		scratch.resize(length);
+		copy_out(start, scratch.data(), length);
+		message = scratch.data();
+	}
+
+	message_length = static_cast<std::size_t>(length);
+	m_read_length = sizeof(length) + static_cast<uint64_t>(length);
+	return true;
+}
+
+void shm_ring::consume(void) noexcept
+{
+	uint64_t tail = m_header->tail.load(std::memory_order_relaxed);
+	m_header->tail.store(tail + m_read_length, std::memory_order_release);
+	m_read_length = 0;
+}
+
+bool shm_ring::prepare_consumer_wait(void) noexcept
+{
+	m_header->consumer_waiting.store(1, std::memory_order_seq_cst);
+	uint64_t tail = m_header->tail.load(std::memory_order_relaxed);
+	if (m_header->head.load(std::memory_order_seq_cst) != tail) {
+		m_header->consumer_waiting.store(0, std::memory_order_relaxed);
+		return false;
+	}
+
+	return true;
+}
+
+bool shm_ring::producer_needs_wakeup(void) noexcept
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_header->producer_waiting.load(std::memory_order_seq_cst) == 0) {
+		return false;
+	}
+
+	m_header->producer_waiting.store(0, std::memory_order_relaxed);
+	return true;
+}
+
+} // namespace scramjet
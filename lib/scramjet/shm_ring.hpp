@@ -0,0 +1,92 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCRAMJET__SHM_RING_HPP
+#define SCRAMJET__SHM_RING_HPP
+
+#include <atomic>
+#include <cstdbool>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "scramjet/error_code.hpp"
+
+namespace scramjet {
+
+struct shm_ring_header {
+	alignas(64) std::atomic<uint64_t> head;
+	alignas(64) std::atomic<uint64_t> tail;
+	alignas(64) std::atomic<uint32_t> consumer_waiting;
+	std::atomic<uint32_t> producer_waiting;
+	uint64_t capacity;
+};
+
+class shm_ring final {
+public:
+	shm_ring() noexcept;
+
+	static std::size_t get_segment_size(std::size_t capacity) noexcept;
+	static void init(void* memory, std::size_t capacity) noexcept;
+	// capacity is the one the ring was initialised with, validated by the
+	// caller; the copy in the shared header is not trusted after that.
+	void attach(void* memory, uint64_t capacity) noexcept;
+	void detach(void) noexcept;
+	bool is_attached(void) const noexcept;
+	std::size_t get_capacity(void) const noexcept;
+
+	bool write(const uint8_t* message, std::size_t message_length) noexcept;
+	bool prepare_producer_wait(std::size_t message_length) noexcept;
+	bool consumer_needs_wakeup(void) noexcept;
+
+	// Returns false with ec SCRAMJET_OK if the ring is empty. A length
+	// prefix that does not fit what the producer published fails with
+	// SCRAMJET_WRONG_MESSAGE_FORMAT, one above max_message_length with
+	// SCRAMJET_FRAME_TOO_LARGE. Both leave the ring and scratch untouched.
+	bool read(const uint8_t*& message, std::size_t& message_length, std::size_t max_message_length, std::vector<uint8_t>& scratch, enum error_code& ec);
+	void consume(void) noexcept;
+	bool prepare_consumer_wait(void) noexcept;
+	bool producer_needs_wakeup(void) noexcept;
+
+	static const std::size_t HEADER_SIZE = 256;
+	static const std::size_t DEFAULT_CAPACITY = 1024 * 1024;
+
+private:
+	shm_ring_header* m_header;
+	uint8_t* m_data;
+	uint64_t m_capacity;
+	uint64_t m_mask;
+	uint64_t m_read_length;
+
+	void copy_in(uint64_t position, const uint8_t* data, std::size_t length) noexcept;
+	void copy_out(uint64_t position, uint8_t* data, std::size_t length) const noexcept;
+};
+
+} // namespace scramjet
+
+#endif
@@ -0,0 +1,305 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCRAMJET__SMALL_FUNCTION_HPP
+#define SCRAMJET__SMALL_FUNCTION_HPP
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace scramjet {
+
+static const std::size_t SMALL_FUNCTION_CAPACITY = 4 * sizeof(void*);
+
+template <typename Signature, std::size_t Capacity = SMALL_FUNCTION_CAPACITY>
+class small_function;
+
+template <typename R, typename... Args, std::size_t Capacity>
+class small_function<R(Args...), Capacity> final {
+public:
+	small_function() noexcept
+	{
+	}
+
+	small_function(std::nullptr_t) noexcept
+	{
+	}
+
+	template <typename F,
+	          typename Functor = typename std::decay<F>::type,
+	          typename = typename std::enable_if<!std::is_same<Functor, small_function>::value>::type,
+	          typename = decltype(static_cast<R>(std::declval<Functor&>()(std::declval<Args>()...)))>
+	small_function(F&& f)
+	{
+		if (is_null(f)) {
+			return;
+		}
+
+		construct<Functor>(&m_storage, std::forward<F>(f), is_inline<Functor>());
+		m_invoke = &invoke<Functor>;
+		m_manage = &manage<Functor>;
+	}
+
+	small_function(const small_function& other)
+	{
+		if (other.m_manage != nullptr) {
+			other.m_manage(OPERATION_COPY, &m_storage, const_cast<storage_t*>(&other.m_storage));
+			m_invoke = other.m_invoke;
+			m_manage = other.m_manage;
+		}
+	}
+
+	small_function(small_function&& other) noexcept
+	{
+		take(other);
+	}
+
+	~small_function() noexcept
+	{
+		reset();
+	}
+
+	small_function& operator=(const small_function& other)
+	{
+		if (this != &other) {
+			small_function copy(other);
+			reset();
+			take(copy);
+		}
+
+		return *this;
+	}
+
+	small_function& operator=(small_function&& other) noexcept
+	{
+		if (this != &other) {
+			reset();
+			take(other);
+		}
+
+		return *this;
+	}
+
+	small_function& operator=(std::nullptr_t) noexcept
+	{
+		reset();
+		return *this;
+	}
+
+	template <typename F,
+	          typename Functor = typename std::decay<F>::type,
+	          typename = typename std::enable_if<!std::is_same<Functor, small_function>::value>::type,
+	          typename = decltype(static_cast<R>(std::declval<Functor&>()(std::declval<Args>()...)))>
+	small_function& operator=(F&& f)
+	{
+		small_function function(std::forward<F>(f));
+		reset();
+		take(function);
+		return *this;
+	}
+
+	R operator()(Args... args) const
+	{
+		if (m_invoke == nullptr) {
+			throw std::bad_function_call();
+		}
+
+		return m_invoke(const_cast<storage_t*>(&m_storage), std::forward<Args>(args)...);
+	}
+
+	explicit operator bool() const noexcept
+	{
+		return m_invoke != nullptr;
+	}
+
+	friend bool operator==(const small_function& f, std::nullptr_t) noexcept
+	{
+		return !f;
+	}
+
+	friend bool operator==(std::nullptr_t, const small_function& f) noexcept
+	{
+		return !f;
+	}
+
+	friend bool operator!=(const small_function& f, std::nullptr_t) noexcept
+	{
+		return static_cast<bool>(f);
+	}
+
+	friend bool operator!=(std::nullptr_t, const small_function& f) noexcept
+	{
+		return static_cast<bool>(f);
+	}
+
+private:
+	enum operation {
+		OPERATION_COPY,
+		OPERATION_MOVE,
+		OPERATION_DESTROY
+	};
+
+	typedef typename std::aligned_storage<Capacity, alignof(std::max_align_t)>::type storage_t;
+	typedef R (*invoke_t)(storage_t* storage, Args&&... args);
+	typedef void (*manage_t)(enum operation op, storage_t* destination, storage_t* source);
+
+	storage_t m_storage;
+	invoke_t m_invoke = nullptr;
+	manage_t m_manage = nullptr;
+
+	template <typename Functor>
+	using is_inline = std::integral_constant<bool,
+	                                         (sizeof(Functor) <= Capacity) &&
+	                                                 (alignof(Functor) <= alignof(storage_t)) &&
+	                                                 std::is_nothrow_move_constructible<Functor>::value>;
+
+	template <typename Functor, typename F>
+	static void construct(storage_t* storage, F&& f, std::true_type)
+	{
+		::new (static_cast<void*>(storage)) Functor(std::forward<F>(f));
+	}
+
+	template <typename Functor, typename F>
+	static void construct(storage_t* storage, F&& f, std::false_type)
+	{
+		::new (static_cast<void*>(storage)) Functor*(new Functor(std::forward<F>(f)));
+	}
+
+	template <typename Functor>
+	static Functor* get(storage_t* storage, std::true_type) noexcept
+	{
+		return reinterpret_cast<Functor*>(storage);
+	}
+
+	template <typename Functor>
+	static Functor* get(storage_t* storage, std::false_type) noexcept
+	{
+		return *reinterpret_cast<Functor**>(storage);
+	}
+
+	template <typename Functor>
+	static void relocate(storage_t* destination, Functor* functor, std::true_type) noexcept
+	{
+		::new (static_cast<void*>(destination)) Functor(std::move(*functor));
+		functor->~Functor();
+	}
+
+	template <typename Functor>
+	static void relocate(storage_t* destination, Functor* functor, std::false_type) noexcept
+	{
+		::new (static_cast<void*>(destination)) Functor*(functor);
+	}
+
+	template <typename Functor>
+	static void destroy(Functor* functor, std::true_type) noexcept
+	{
+		functor->~Functor();
+	}
+
+	template <typename Functor>
+	static void destroy(Functor* functor, std::false_type) noexcept
+	{
+		delete functor;
+	}
+
+	template <typename Functor>
+	static R invoke(storage_t* storage, Args&&... args)
+	{
+		return (*get<Functor>(storage, is_inline<Functor>()))(std::forward<Args>(args)...);
+	}
+
+	template <typename Functor>
+	static void manage(enum operation op, storage_t* destination, storage_t* source)
+	{
+		Functor* functor = get<Functor>(source, is_inline<Functor>());
+		switch (op) {
+		case OPERATION_COPY:
+			construct<Functor>(destination, static_cast<const Functor&>(*functor), is_inline<Functor>());
+			break;
+
+		case OPERATION_MOVE:
+			relocate<Functor>(destination, functor, is_inline<Functor>());
+			break;
+
+		case OPERATION_DESTROY:
+			destroy<Functor>(functor, is_inline<Functor>());
+			break;
+		}
+	}
+
+	template <typename T>
+	static bool is_null(const T&) noexcept
+	{
+		return false;
+	}
+
+	template <typename T>
+	static bool is_null(T* pointer) noexcept
+	{
+		return pointer == nullptr;
+	}
+
+	template <typename T, typename C>
+	static bool is_null(T C::*pointer) noexcept
+	{
+		return pointer == nullptr;
+	}
+
+	template <typename Signature>
+	static bool is_null(const std::function<Signature>& function) noexcept
+	{
+		return !function;
+	}
+
+	void take(small_function& other) noexcept
+	{
+		if (other.m_manage != nullptr) {
+			other.m_manage(OPERATION_MOVE, &m_storage, &other.m_storage);
+			m_invoke = other.m_invoke;
+			m_manage = other.m_manage;
+			other.m_invoke = nullptr;
+			other.m_manage = nullptr;
+		}
+	}
+
+	void reset(void) noexcept
+	{
+		if (m_manage != nullptr) {
+			m_manage(OPERATION_DESTROY, nullptr, &m_storage);
+			m_invoke = nullptr;
+			m_manage = nullptr;
+		}
+	}
+};
+
+} // namespace scramjet
+
+#endif
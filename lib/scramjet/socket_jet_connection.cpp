@@ -31,21 +31,25 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <boost/asio.hpp>
-#include <boost/endian/conversion.hpp>
 
 #include "scramjet/jet_connection.hpp"
+#include "scramjet/resolver_cache.hpp"
 #include "scramjet/socket_jet_connection.hpp"
+#include "scramjet/stream_jet_connection.hpp"
+#include "scramjet/timer_wheel.hpp"
 
 namespace scramjet {
+
+const std::chrono::milliseconds socket_jet_connection::CONNECTION_ATTEMPT_DELAY(250);
+
 socket_jet_connection::socket_jet_connection(boost::asio::io_context& ioc, const std::string& h, uint16_t p) noexcept
-        : m_host(h)
+        : stream_jet_connection(ioc)
+        , m_host(h)
         , m_port(p)
-        , m_tcp_resolver(ioc)
-        , m_tcp_socket(ioc)
-        , m_receive_buffer(DEFAULT_RECEIVE_BUFFER_SIZE)
-        , m_deadline(ioc)
+        , m_resolver_cache(boost::asio::use_service<resolver_cache>(ioc))
 {
 }
 
@@ -55,134 +59,161 @@ socket_jet_connection::~socket_jet_connection() noexcept
 
 void socket_jet_connection::connect(const connected_callback_t& connect_callback, std::chrono::milliseconds timeout) noexcept
 {
-	using namespace std::placeholders;
+	if (!m_strand.running_in_this_thread()) {
+		boost::asio::post(m_strand, std::bind(&socket_jet_connection::connect, this, connect_callback, timeout));
+		return;
+	}
+
 	m_connected_callback = connect_callback;
 	m_connect_timeout = timeout;
-
-	m_tcp_resolver.async_resolve(m_host, std::to_string(static_cast<unsigned>(m_port)),
-	                             std::bind(&socket_jet_connection::resolve_handler,
-	                                       this,
-	                                       _1,
-	                                       _2));
-	m_deadline.expires_from_now(timeout);
-	m_deadline.async_wait(std::bind(&socket_jet_connection::resolve_timeout_handler, this, _1));
+	m_connecting = true;
+
+	uint64_t generation = ++m_attempt_generation;
+	start_connect_timeout(timeout, std::bind(&socket_jet_connection::connect_timed_out, this));
+	m_resolver_cache.resolve(m_host, m_port, [this, generation](const boost::system::error_code& ec, const std::vector<boost::asio::ip::tcp::endpoint>& endpoints) {
+		boost::asio::dispatch(m_strand, [this, generation, ec, endpoints]() {
+			resolve_handler(generation, ec, endpoints);
+		});
+	});
 }
 
 void socket_jet_connection::disconnect(void) noexcept
 {
-	m_tcp_socket.cancel();
-	m_tcp_socket.close();
-}
-
-void socket_jet_connection::resolve_handler(const boost::system::error_code& ec, boost::asio::ip::tcp::resolver::results_type results) noexcept
-{
-	m_deadline.cancel();
-	if (ec) {
-		if (ec == boost::asio::error::operation_aborted) {
-			m_connected_callback(SCRAMJET_OPERATION_ABORTED);
-			return;
-		}
-
-		m_connected_callback(SCRAMJET_HOST_NOT_FOUND);
+	if (!m_strand.running_in_this_thread()) {
+		boost::asio::post(m_strand, std::bind(&socket_jet_connection::disconnect, this));
 		return;
 	}
 
-	using namespace std::placeholders;
-	boost::asio::async_connect(m_tcp_socket, results, std::bind(&socket_jet_connection::connect_handler, this, _1, _2));
-	m_deadline.expires_from_now(m_connect_timeout);
-	m_deadline.async_wait(std::bind(&socket_jet_connection::connect_timeout_handler, this, _1));
-}
-
-void socket_jet_connection::resolve_timeout_handler(const boost::system::error_code& ec) noexcept
-{
-	if (ec && (ec == boost::asio::error::operation_aborted)) {
-		return;
+	if (m_connecting) {
+		finish_connect(SCRAMJET_OPERATION_ABORTED);
 	}
 
-	m_tcp_resolver.cancel();
+	stream_jet_connection::disconnect();
 }
 
-void socket_jet_connection::connect_handler(const boost::system::error_code& ec, const boost::asio::ip::tcp::endpoint& ep) noexcept
+void socket_jet_connection::resolve_handler(uint64_t generation, const boost::system::error_code& ec, const std::vector<boost::asio::ip::tcp::endpoint>& endpoints) noexcept
 {
-	(void)ep;
+	if (generation != m_attempt_generation) {
+		return;
+	}
 
-	m_deadline.cancel();
 	if (ec) {
 		if (ec == boost::asio::error::operation_aborted) {
-			m_connected_callback(SCRAMJET_OPERATION_ABORTED);
+			finish_connect(SCRAMJET_OPERATION_ABORTED);
 			return;
 		}
 
-		m_connected_callback(SCRAMJET_CONNECTION_REFUSED);
+		finish_connect(SCRAMJET_HOST_NOT_FOUND);
 		return;
 	}
 
-	m_connected_callback(SCRAMJET_OK);
+	order_endpoints(endpoints);
+	m_next_endpoint = 0;
+	m_failed_attempts = 0;
+	start_next_attempt();
 }
 
-void socket_jet_connection::connect_timeout_handler(const boost::system::error_code& ec) noexcept
+void socket_jet_connection::order_endpoints(const std::vector<boost::asio::ip::tcp::endpoint>& endpoints)
 {
-	if (ec && (ec == boost::asio::error::operation_aborted)) {
-		return;
+	// Alternate between address families, starting with the family the
+	// resolver preferred, so a dead IPv6 route cannot stall IPv4.
+	std::vector<const boost::asio::ip::tcp::endpoint*> preferred;
+	std::vector<const boost::asio::ip::tcp::endpoint*> other;
+	for (const boost::asio::ip::tcp::endpoint& ep : endpoints) {
+		if (ep.protocol() == endpoints.front().protocol()) {
+			preferred.push_back(&ep);
+		} else {
+			other.push_back(&ep);
+		}
 	}
 
-	m_tcp_socket.cancel();
-	m_tcp_socket.close();
-}
+	m_endpoints.clear();
+	for (std::size_t i = 0; (i < preferred.size()) || (i < other.size()); i++) {
+		if (i < preferred.size()) {
+			m_endpoints.emplace_back(*preferred[i]);
+		}
 
-void socket_jet_connection::receive_message(const message_received_callback_t callback) noexcept
-{
-	m_message_received_callback = callback;
-
-	boost::asio::async_read(m_tcp_socket,
-	                        m_receive_buffer,
-	                        boost::asio::transfer_at_least(4),
-	                        std::bind(&socket_jet_connection::message_length_read,
-	                                  this,
-	                                  std::placeholders::_1));
+		if (i < other.size()) {
+			m_endpoints.emplace_back(*other[i]);
+		}
+	}
 }
 
-void socket_jet_connection::message_length_read(const boost::system::error_code& ec) noexcept
+void socket_jet_connection::start_next_attempt(void) noexcept
 {
-	if (ec) {
-		m_connected_callback(SCRAMJET_WRONG_MESSAGE_FORMAT);
+	m_attempt_timer.cancel();
+	if (m_next_endpoint >= m_endpoints.size()) {
 		return;
 	}
 
-	std::memcpy(&m_message_length, boost::asio::buffer_cast<const void*>(m_receive_buffer.data()), sizeof(m_message_length));
-	m_receive_buffer.consume(sizeof(m_message_length));
-	boost::endian::little_to_native_inplace(m_message_length);
-
-	std::size_t bytes_in_buffer = m_receive_buffer.size();
-	if (bytes_in_buffer < static_cast<size_t>(m_message_length)) {
-		std::size_t bytes_to_read = m_message_length - bytes_in_buffer;
-		boost::asio::async_read(m_tcp_socket,
-		                        m_receive_buffer,
-		                        boost::asio::transfer_at_least(bytes_to_read),
-		                        std::bind(&socket_jet_connection::message_read,
-		                                  this,
-		                                  std::placeholders::_1));
-	} else {
-		handle_message();
+	std::size_t index = m_next_endpoint++;
+	m_attempts.emplace_back(new connect_attempt(m_io_context));
+
+	using namespace std::placeholders;
+	m_attempts.back()->socket.async_connect(m_endpoints[index],
+	                                        boost::asio::bind_executor(m_strand,
+	                                                                   std::bind(&socket_jet_connection::attempt_handler,
+	                                                                             this,
+	                                                                             m_attempt_generation,
+	                                                                             index,
+	                                                                             _1)));
+
+	if (m_next_endpoint < m_endpoints.size()) {
+		uint64_t generation = m_attempt_generation;
+		std::size_t next = m_next_endpoint;
+		m_timer_wheel.schedule(m_attempt_timer, CONNECTION_ATTEMPT_DELAY, [this, generation, next]() {
+			boost::asio::post(m_strand, [this, generation, next]() {
+				if ((generation == m_attempt_generation) && (next == m_next_endpoint)) {
+					start_next_attempt();
+				}
+			});
+		});
 	}
 }
 
-void socket_jet_connection::message_read(const boost::system::error_code& ec) noexcept
+void socket_jet_connection::attempt_handler(uint64_t generation, std::size_t index, const boost::system::error_code& ec) noexcept
 {
+	if (generation != m_attempt_generation) {
+		return;
+	}
+
 	if (ec) {
-		disconnect();
+		m_failed_attempts++;
+		if (m_failed_attempts == m_endpoints.size()) {
+			m_resolver_cache.invalidate(m_host, m_port);
+			finish_connect(SCRAMJET_CONNECTION_REFUSED);
+			return;
+		}
+
+		start_next_attempt();
 		return;
 	}
 
-	handle_message();
+	m_socket = std::move(m_attempts[index]->socket);
+	finish_connect(SCRAMJET_OK);
 }
 
-void socket_jet_connection::handle_message(void)
+void socket_jet_connection::connect_timed_out(void) noexcept
 {
-	m_message_received_callback(SCRAMJET_OK,
-	                            boost::asio::buffer_cast<const uint8_t*>(m_receive_buffer.data()),
-	                            static_cast<size_t>(m_message_length));
-	m_receive_buffer.consume(m_message_length);
+	if (m_connecting) {
+		finish_connect(SCRAMJET_OPERATION_ABORTED);
+	}
+}
+
+void socket_jet_connection::finish_connect(enum error_code result) noexcept
+{
+	m_connecting = false;
+	m_attempt_generation++;
+	m_attempt_timer.cancel();
+	stop_connect_timeout();
+
+	boost::system::error_code ec;
+	for (std::unique_ptr<connect_attempt>& attempt : m_attempts) {
+		attempt->socket.close(ec);
+	}
+
+	m_attempts.clear();
+	m_connected_callback(result);
 }
 
 } // namespace scramjet
@@ -31,45 +31,60 @@
 
 #include <chrono>
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include <boost/asio.hpp>
-#include <boost/asio/high_resolution_timer.hpp>
 
 #include "scramjet/jet_connection.hpp"
+#include "scramjet/resolver_cache.hpp"
+#include "scramjet/stream_jet_connection.hpp"
+#include "scramjet/timer_wheel.hpp"
 
 namespace scramjet {
 
-class socket_jet_connection final : public jet_connection {
+class socket_jet_connection final : public stream_jet_connection {
 public:
 	virtual void connect(const connected_callback_t& connect_callback, std::chrono::milliseconds timeout) noexcept override;
 	virtual void disconnect(void) noexcept override;
-	virtual void receive_message(const message_received_callback_t callback) noexcept override;
 
 	socket_jet_connection(boost::asio::io_context& ioc, const std::string& host, uint16_t port = DEFAULT_SOCKET_JET_PORT) noexcept;
 	virtual ~socket_jet_connection() noexcept;
 
+	// Delay before racing the next resolved address against the ones
+	// already in flight (RFC 8305).
+	static const std::chrono::milliseconds CONNECTION_ATTEMPT_DELAY;
+
 private:
+	struct connect_attempt {
+		explicit connect_attempt(boost::asio::io_context& ioc)
+		        : socket(ioc)
+		{
+		}
+
+		boost::asio::generic::stream_protocol::socket socket;
+	};
+
 	const std::string m_host;
 	uint16_t m_port;
-	boost::asio::ip::tcp::resolver m_tcp_resolver;
-	boost::asio::ip::tcp::socket m_tcp_socket;
-	boost::asio::streambuf m_receive_buffer;
-	boost::asio::high_resolution_timer m_deadline;
-	uint32_t m_message_length = 0;
+	resolver_cache& m_resolver_cache;
+	std::vector<boost::asio::generic::stream_protocol::endpoint> m_endpoints;
+	std::vector<std::unique_ptr<connect_attempt>> m_attempts;
+	std::size_t m_next_endpoint = 0;
+	std::size_t m_failed_attempts = 0;
+	uint64_t m_attempt_generation = 0;
+	bool m_connecting = false;
+	wheel_timer m_attempt_timer;
 
 	static const std::uint16_t DEFAULT_SOCKET_JET_PORT = UINT16_C(12345);
-	static const std::size_t DEFAULT_RECEIVE_BUFFER_SIZE = 1024;
-
-	void resolve_handler(const boost::system::error_code& ec, boost::asio::ip::tcp::resolver::results_type results) noexcept;
-	void resolve_timeout_handler(const boost::system::error_code& ec) noexcept;
-	void connect_handler(const boost::system::error_code& ec, const boost::asio::ip::tcp::endpoint& ep) noexcept;
-	void connect_timeout_handler(const boost::system::error_code& ec) noexcept;
-
-	void message_length_read(const boost::system::error_code& ec) noexcept;
-	void message_read(const boost::system::error_code& ec) noexcept;
 
-	void handle_message(void);
+	void resolve_handler(uint64_t generation, const boost::system::error_code& ec, const std::vector<boost::asio::ip::tcp::endpoint>& endpoints) noexcept;
+	void start_next_attempt(void) noexcept;
+	void attempt_handler(uint64_t generation, std::size_t index, const boost::system::error_code& ec) noexcept;
+	void connect_timed_out(void) noexcept;
+	void finish_connect(enum error_code result) noexcept;
+	void order_endpoints(const std::vector<boost::asio::ip::tcp::endpoint>& endpoints);
 };
 } // namespace scramjet
 
@@ -0,0 +1,189 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "scramjet/statistics.hpp"
+
+namespace scramjet {
+
+static unsigned int highest_set_bit(uint64_t value) noexcept
+{
+#if defined(__GNUC__)
+	return 63 - static_cast<unsigned int>(__builtin_clzll(value));
+#else
+	unsigned int bit = 0;
+	while ((value >>= 1) != 0) {
+		bit++;
+	}
+
+	return bit;
+#endif
+}
+
+connection_counters_snapshot connection_counters::snapshot(void) const noexcept
+{
+	connection_counters_snapshot s;
+	s.bytes_sent = bytes_sent.load(std::memory_order_relaxed);
+	s.bytes_received = bytes_received.load(std::memory_order_relaxed);
+	s.frames_sent = frames_sent.load(std::memory_order_relaxed);
+	s.frames_received = frames_received.load(std::memory_order_relaxed);
+	s.reads = reads.load(std::memory_order_relaxed);
+	s.writes = writes.load(std::memory_order_relaxed);
+	return s;
+}
+
+uint64_t histogram_snapshot::min(void) const noexcept
+{
+	for (std::size_t i = 0; i < counts.size(); i++) {
+		if (counts[i] > 0) {
+			return latency_histogram::bucket_lower_bound(i);
+		}
+	}
+
+	return 0;
+}
+
+uint64_t histogram_snapshot::max(void) const noexcept
+{
+	for (std::size_t i = counts.size(); i > 0; i--) {
+		if (counts[i - 1] > 0) {
+			return latency_histogram::bucket_upper_bound(i - 1);
+		}
+	}
+
+	return 0;
+}
+
+double histogram_snapshot::mean(void) const noexcept
+{
+	if (count == 0) {
+		return 0.0;
+	}
+
+	return static_cast<double>(sum) / static_cast<double>(count);
+}
+
+uint64_t histogram_snapshot::value_at_percentile(double percentile) const noexcept
+{
+	if (count == 0) {
+		return 0;
+	}
+
+	percentile = std::min(std::max(percentile, 0.0), 100.0);
+	uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(count) + 0.5);
+	rank = std::max<uint64_t>(rank, 1);
+
+	uint64_t seen = 0;
+	for (std::size_t i = 0; i < counts.size(); i++) {
+		seen += counts[i];
+		if (seen >= rank) {
+			return latency_histogram::bucket_upper_bound(i);
+		}
+	}
+
+	return max();
+}
+
+latency_histogram::latency_histogram() noexcept
+        : m_sum(0)
+{
+	for (std::atomic<uint64_t>& bucket : m_counts) {
+		bucket.store(0, std::memory_order_relaxed);
+	}
+}
+
+std::size_t latency_histogram::bucket_of(uint64_t value) noexcept
+{
+	if (value < SUB_BUCKET_COUNT) {
+		return static_cast<std::size_t>(value);
+	}
+
+	if (value > MAX_VALUE) {
+		value = MAX_VALUE;
+	}
+
+	unsigned int exponent = highest_set_bit(value);
+	unsigned int shift = exponent - SUB_BUCKET_BITS + 1;
+	return SUB_BUCKET_COUNT + (exponent - SUB_BUCKET_BITS) * SUB_BUCKET_HALF + static_cast<std::size_t>((value >> shift) - SUB_BUCKET_HALF);
+}
+
+uint64_t latency_histogram::bucket_lower_bound(std::size_t bucket) noexcept
+{
+	if (bucket < SUB_BUCKET_COUNT) {
+		return bucket;
+	}
+
+	std::size_t offset = bucket - SUB_BUCKET_COUNT;
+	unsigned int shift = static_cast<unsigned int>(offset / SUB_BUCKET_HALF) + 1;
+	uint64_t mantissa = SUB_BUCKET_HALF + offset % SUB_BUCKET_HALF;
+	return mantissa << shift;
+}
+
+uint64_t latency_histogram::bucket_upper_bound(std::size_t bucket) noexcept
+{
+	if (bucket < SUB_BUCKET_COUNT) {
+		return bucket;
+	}
+
+	std::size_t offset = bucket - SUB_BUCKET_COUNT;
+	unsigned int shift = static_cast<unsigned int>(offset / SUB_BUCKET_HALF) + 1;
+	uint64_t mantissa = SUB_BUCKET_HALF + offset % SUB_BUCKET_HALF;
+	return ((mantissa + 1) << shift) - 1;
+}
+
+void latency_histogram::record(uint64_t value) noexcept
+{
+	counter_add(m_counts[bucket_of(value)], 1);
+	counter_add(m_sum, value);
+}
+
+void latency_histogram::record(std::chrono::nanoseconds value) noexcept
+{
+	record(static_cast<uint64_t>(std::max<std::chrono::nanoseconds::rep>(value.count(), 0)));
+}
+
+histogram_snapshot latency_histogram::snapshot(void) const
+{
+	histogram_snapshot s;
+	s.counts.resize(BUCKET_COUNT);
+	for (std::size_t i = 0; i < BUCKET_COUNT; i++) {
+		s.counts[i] = m_counts[i].load(std::memory_order_relaxed);
+		s.count += s.counts[i];
+	}
+
+	s.sum = m_sum.load(std::memory_order_relaxed);
+	return s;
+}
+
+} // namespace scramjet
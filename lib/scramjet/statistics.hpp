@@ -0,0 +1,110 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCRAMJET__STATISTICS_HPP
+#define SCRAMJET__STATISTICS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace scramjet {
+
+// Every counter and histogram has exactly one writer, the strand of the
+// connection or peer owning it, so an update is a relaxed load and store
+// instead of a locked read-modify-write. Readers may run on any thread.
+inline void counter_add(std::atomic<uint64_t>& counter, uint64_t value) noexcept
+{
+	counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+struct connection_counters_snapshot {
+	uint64_t bytes_sent = 0;
+	uint64_t bytes_received = 0;
+	uint64_t frames_sent = 0;
+	uint64_t frames_received = 0;
+	uint64_t reads = 0;
+	uint64_t writes = 0;
+};
+
+struct connection_counters {
+	std::atomic<uint64_t> bytes_sent{0};
+	std::atomic<uint64_t> bytes_received{0};
+	std::atomic<uint64_t> frames_sent{0};
+	std::atomic<uint64_t> frames_received{0};
+	std::atomic<uint64_t> reads{0};
+	std::atomic<uint64_t> writes{0};
+
+	connection_counters_snapshot snapshot(void) const noexcept;
+};
+
+struct histogram_snapshot {
+	uint64_t count = 0;
+	uint64_t sum = 0;
+	std::vector<uint64_t> counts;
+
+	uint64_t min(void) const noexcept;
+	uint64_t max(void) const noexcept;
+	double mean(void) const noexcept;
+	uint64_t value_at_percentile(double percentile) const noexcept;
+};
+
+// Log-linear histogram in the style of HdrHistogram: every power of two is
+// split into 32 linear sub-buckets, giving about 3% relative error from
+// 1ns up to MAX_VALUE. Larger values are clamped.
+class latency_histogram final {
+public:
+	latency_histogram() noexcept;
+
+	latency_histogram(const latency_histogram&) = delete;
+	latency_histogram& operator=(const latency_histogram&) = delete;
+
+	void record(uint64_t value) noexcept;
+	void record(std::chrono::nanoseconds value) noexcept;
+	histogram_snapshot snapshot(void) const;
+
+	static std::size_t bucket_of(uint64_t value) noexcept;
+	static uint64_t bucket_lower_bound(std::size_t bucket) noexcept;
+	static uint64_t bucket_upper_bound(std::size_t bucket) noexcept;
+
+	static const unsigned int SUB_BUCKET_BITS = 6;
+	static const unsigned int MAX_VALUE_BITS = 40;
+	static const uint64_t MAX_VALUE = (UINT64_C(1) << MAX_VALUE_BITS) - 1;
+	static const std::size_t SUB_BUCKET_COUNT = std::size_t(1) << SUB_BUCKET_BITS;
+	static const std::size_t SUB_BUCKET_HALF = SUB_BUCKET_COUNT / 2;
+	static const std::size_t BUCKET_COUNT = SUB_BUCKET_COUNT + (MAX_VALUE_BITS - SUB_BUCKET_BITS) * SUB_BUCKET_HALF;
+
+private:
+	std::atomic<uint64_t> m_counts[BUCKET_COUNT];
+	std::atomic<uint64_t> m_sum;
+};
+} // namespace scramjet
+
+#endif
@@ -0,0 +1,428 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/endian/conversion.hpp>
+
+#include "scramjet/frame_codec.hpp"
+#include "scramjet/frame_compressor.hpp"
+#include "scramjet/handler_allocator.hpp"
+#include "scramjet/jet_connection.hpp"
+#include "scramjet/message_frames.hpp"
+#include "scramjet/message_type.hpp"
+#include "scramjet/receive_buffer.hpp"
+#include "scramjet/statistics.hpp"
+#include "scramjet/stream_jet_connection.hpp"
+#include "scramjet/timer_wheel.hpp"
+#include "scramjet/uring_engine.hpp"
+
+namespace scramjet {
+stream_jet_connection::stream_jet_connection(boost::asio::io_context& ioc) noexcept
+        : m_io_context(ioc)
+        , m_strand(boost::asio::make_strand(ioc))
+        , m_socket(ioc)
+        , m_timer_wheel(boost::asio::use_service<timer_wheel>(ioc))
+        , m_write_handler_memory(WRITE_HANDLER_MEMORY_SIZE)
+{
+}
+
+stream_jet_connection::~stream_jet_connection() noexcept
+{
+}
+
+void stream_jet_connection::disconnect(void) noexcept
+{
+	if (!m_strand.running_in_this_thread()) {
+		boost::asio::post(m_strand, std::bind(&stream_jet_connection::disconnect, this));
+		return;
+	}
+
+	m_receiving = false;
+	stop_connect_timeout();
+	close_socket();
+}
+
+void stream_jet_connection::close_socket(void) noexcept
+{
+	if (m_uring != nullptr) {
+		m_uring->detach();
+	}
+
+	boost::system::error_code ec;
+	m_socket.cancel(ec);
+	m_socket.close(ec);
+}
+
+bool stream_jet_connection::enable_io_uring(const uring_options& options) noexcept
+{
+	if (m_uring != nullptr) {
+		return true;
+	}
+
+	std::unique_ptr<uring_engine> engine(new (std::nothrow) uring_engine(m_io_context, m_strand));
+	if ((engine == nullptr) || !engine->open(options)) {
+		return false;
+	}
+
+	m_uring = std::move(engine);
+	return true;
+}
+
+bool stream_jet_connection::uring_ready(void) noexcept
+{
+	if ((m_uring == nullptr) || !m_socket.is_open()) {
+		return false;
+	}
+
+	if (!m_uring->is_attached()) {
+		m_uring->attach(m_socket.native_handle());
+	}
+
+	return true;
+}
+
+void stream_jet_connection::start_connect_timeout(std::chrono::milliseconds timeout, const timeout_callback_t& handler)
+{
+	uint64_t generation = ++m_connect_generation;
+	m_timer_wheel.schedule(m_connect_timer, timeout, [this, generation, handler]() {
+		boost::asio::post(m_strand, [this, generation, handler]() {
+			if (generation == m_connect_generation) {
+				handler();
+			}
+		});
+	});
+}
+
+void stream_jet_connection::stop_connect_timeout(void) noexcept
+{
+	m_connect_timer.cancel();
+	m_connect_generation++;
+}
+
+void stream_jet_connection::connect_handler(const boost::system::error_code& ec) noexcept
+{
+	stop_connect_timeout();
+	if (ec) {
+		if (ec == boost::asio::error::operation_aborted) {
+			m_connected_callback(SCRAMJET_OPERATION_ABORTED);
+			return;
+		}
+
+		m_connected_callback(SCRAMJET_CONNECTION_REFUSED);
+		return;
+	}
+
+	m_connected_callback(SCRAMJET_OK);
+}
+
+void stream_jet_connection::connect_timeout_handler(void) noexcept
+{
+	close_socket();
+}
+
+void stream_jet_connection::receive_message(const message_received_callback_t& callback) noexcept
+{
+	if (!m_strand.running_in_this_thread()) {
+		boost::asio::post(m_strand, std::bind(&stream_jet_connection::receive_message, this, callback));
+		return;
+	}
+
+	if (m_dispatching) {
+		m_pending_message_received_callback = callback;
+		return;
+	}
+
+	m_message_received_callback = callback;
+	if (!m_receiving) {
+		m_receiving = true;
+		read_data();
+	}
+}
+
+message_ref stream_jet_connection::retain_message(void) noexcept
+{
+	return m_receive_buffer.retain_message();
+}
+
+void stream_jet_connection::read_data(void) noexcept
+{
+	std::size_t bytes_missing = handle_messages();
+	if (!m_receiving) {
+		return;
+	}
+
+	if (uring_ready()) {
+		if (!m_uring->is_receiving()) {
+			using namespace std::placeholders;
+			m_uring->start_receive(std::bind(&stream_jet_connection::uring_data_read, this, _1, _2, _3));
+		}
+		return;
+	}
+
+	std::size_t min_space = std::max(bytes_missing, static_cast<std::size_t>(receive_buffer::MIN_READ_SIZE));
+	uint8_t* buffer = m_receive_buffer.prepare(min_space);
+	m_socket.async_read_some(boost::asio::buffer(buffer, m_receive_buffer.space()),
+	                         boost::asio::bind_executor(m_strand,
+	                                                    make_alloc_handler(m_read_handler_memory,
+	                                                                       std::bind(&stream_jet_connection::data_read,
+	                                                                                 this,
+	                                                                                 std::placeholders::_1,
+	                                                                                 std::placeholders::_2))));
+}
+
+void stream_jet_connection::data_read(const boost::system::error_code& ec, std::size_t bytes_transferred) noexcept
+{
+	if (ec) {
+		m_receiving = false;
+		m_receive_buffer.clear();
+		enum error_code result = (ec == boost::asio::error::operation_aborted) ? SCRAMJET_OPERATION_ABORTED : SCRAMJET_CONNECTION_CLOSED;
+		abort_fragments(result);
+		m_message_received_callback(result, nullptr, 0);
+		return;
+	}
+
+	counter_add(m_counters.reads, 1);
+	counter_add(m_counters.bytes_received, bytes_transferred);
+	m_receive_buffer.commit(bytes_transferred);
+	read_data();
+}
+
+void stream_jet_connection::uring_data_read(const boost::system::error_code& ec, const uint8_t* data, std::size_t length) noexcept
+{
+	if (ec) {
+		data_read(ec, 0);
+		return;
+	}
+
+	if (m_receiving) {
+		std::memcpy(m_receive_buffer.prepare(length), data, length);
+		data_read(ec, length);
+	}
+}
+
+std::size_t stream_jet_connection::handle_messages(void) noexcept
+{
+	const uint8_t* message;
+	std::size_t message_length;
+
+	m_dispatching = true;
+	while (m_receiving) {
+		enum frame_action action = next_frame_action(m_receive_buffer);
+		if (action == FRAME_FRAGMENTED) {
+			continue;
+		}
+
+		if (action == FRAME_TOO_LARGE) {
+			fail_receive(SCRAMJET_FRAME_TOO_LARGE);
+			break;
+		}
+
+		if ((action == FRAME_INCOMPLETE) || !m_receive_buffer.next_message(message, message_length)) {
+			break;
+		}
+
+		enum error_code ec;
+		if (!inflate_message(message, message_length, ec)) {
+			fail_receive(ec);
+			break;
+		}
+
+		counter_add(m_counters.frames_received, 1);
+		m_message_received_callback(SCRAMJET_OK, message, message_length);
+		m_receive_buffer.consume_message();
+
+		if (m_pending_message_received_callback != nullptr) {
+			m_message_received_callback = std::move(m_pending_message_received_callback);
+			m_pending_message_received_callback = nullptr;
+		}
+	}
+
+	m_dispatching = false;
+	if (!m_receiving || is_receiving_fragments()) {
+		return 0;
+	}
+
+	return m_receive_buffer.bytes_missing();
+}
+
+bool stream_jet_connection::inflate_message(const uint8_t*& message, std::size_t& message_length, enum error_code& ec) noexcept
+{
+	compressed_frame_t::view frame;
+	if ((message_length == 0) || (message[0] != message_type::MESSAGE_COMPRESSED) ||
+	    !compressed_frame_t::decode(message, message_length, frame)) {
+		return true;
+	}
+
+	std::size_t length = frame.get<1>();
+	if (length > get_max_frame_size()) {
+		ec = SCRAMJET_FRAME_TOO_LARGE;
+		return false;
+	}
+
+	uint8_t* inflated = m_receive_buffer.prepare_decoded(length);
+	if (inflated == nullptr) {
+		ec = SCRAMJET_FRAME_TOO_LARGE;
+		return false;
+	}
+
+	if (!m_compressor.decompress(frame.payload(), frame.payload_length(), inflated, length)) {
+		ec = SCRAMJET_WRONG_MESSAGE_FORMAT;
+		return false;
+	}
+
+	message = inflated;
+	message_length = length;
+	return true;
+}
+
+void stream_jet_connection::fail_receive(enum error_code result) noexcept
+{
+	m_receiving = false;
+	m_receive_buffer.clear();
+	close_socket();
+	m_message_received_callback(result, nullptr, 0);
+}
+
+bool stream_jet_connection::supports_compression(void) const noexcept
+{
+	return frame_compressor::is_available();
+}
+
+boost::asio::io_context& stream_jet_connection::get_io_context(void) noexcept
+{
+	return m_io_context;
+}
+
+strand_t& stream_jet_connection::get_strand(void) noexcept
+{
+	return m_strand;
+}
+
+void stream_jet_connection::send_message(const uint8_t* message, size_t message_length, const message_sent_callback_t& callback) noexcept
+{
+	if (!m_strand.running_in_this_thread()) {
+		boost::asio::post(m_strand, std::bind(&stream_jet_connection::send_message, this, message, message_length, callback));
+		return;
+	}
+
+	send_request request;
+	request.header = boost::endian::native_to_little(static_cast<uint32_t>(message_length));
+	request.message = message;
+	request.message_length = message_length;
+	request.callback = callback;
+	if ((m_compression_threshold > 0) && (message_length > m_compression_threshold) &&
+	    m_compressor.compress(message, message_length, request.compressed)) {
+		request.header = boost::endian::native_to_little(static_cast<uint32_t>(request.compressed.size()));
+		request.message = request.compressed.data();
+		request.message_length = request.compressed.size();
+	}
+
+	std::size_t frame_length = sizeof(request.header) + request.message_length;
+	m_send_queue.push_back(std::move(request));
+	bytes_queued(frame_length);
+
+	if (!m_writing && !m_flush_scheduled) {
+		m_flush_scheduled = true;
+		boost::asio::post(m_strand, make_alloc_handler(m_flush_handler_memory, std::bind(&stream_jet_connection::flush_send_queue, this)));
+	}
+}
+
+void stream_jet_connection::flush_send_queue(void) noexcept
+{
+	m_flush_scheduled = false;
+	if (m_writing || m_send_queue.empty()) {
+		return;
+	}
+
+	m_sending.swap(m_send_queue);
+	m_send_buffers.clear();
+	for (const send_request& request : m_sending) {
+		m_send_buffers.push_back(boost::asio::buffer(&request.header, sizeof(request.header)));
+		m_send_buffers.push_back(boost::asio::buffer(request.message, request.message_length));
+	}
+
+	m_writing = true;
+	if (uring_ready()) {
+		using namespace std::placeholders;
+		m_uring->write(m_send_buffers.data(), m_send_buffers.size(), std::bind(&stream_jet_connection::data_written, this, _1, _2));
+		return;
+	}
+
+	boost::asio::async_write(m_socket,
+	                         send_buffer_sequence(m_send_buffers),
+	                         boost::asio::bind_executor(m_strand,
+	                                                    make_alloc_handler(m_write_handler_memory,
+	                                                                       std::bind(&stream_jet_connection::data_written,
+	                                                                                 this,
+	                                                                                 std::placeholders::_1,
+	                                                                                 std::placeholders::_2))));
+}
+
+void stream_jet_connection::data_written(const boost::system::error_code& ec, std::size_t bytes_transferred) noexcept
+{
+	m_writing = false;
+	counter_add(m_counters.writes, 1);
+	counter_add(m_counters.bytes_sent, bytes_transferred);
+	if (!ec) {
+		counter_add(m_counters.frames_sent, m_sending.size());
+	}
+
+	enum error_code result = SCRAMJET_OK;
+	if (ec) {
+		if (ec == boost::asio::error::operation_aborted) {
+			result = SCRAMJET_OPERATION_ABORTED;
+		} else {
+			result = SCRAMJET_CONNECTION_CLOSED;
+		}
+	}
+
+	std::size_t drained = 0;
+	for (const send_request& request : m_sending) {
+		drained += sizeof(request.header) + request.message_length;
+	}
+
+	bytes_drained(drained);
+	for (send_request& request : m_sending) {
+		if (request.callback != nullptr) {
+			request.callback(result);
+		}
+	}
+
+	m_sending.clear();
+	flush_send_queue();
+}
+
+} // namespace scramjet
@@ -0,0 +1,148 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCRAMJET__STREAM_JET_CONNECTION_HPP
+#define SCRAMJET__STREAM_JET_CONNECTION_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "scramjet/frame_compressor.hpp"
+#include "scramjet/handler_allocator.hpp"
+#include "scramjet/jet_connection.hpp"
+#include "scramjet/receive_buffer.hpp"
+#include "scramjet/timer_wheel.hpp"
+#include "scramjet/uring_engine.hpp"
+
+namespace scramjet {
+
+class stream_jet_connection : public jet_connection {
+public:
+	virtual void disconnect(void) noexcept override;
+	virtual void receive_message(const message_received_callback_t& callback) noexcept override;
+	virtual message_ref retain_message(void) noexcept override;
+	virtual boost::asio::io_context& get_io_context(void) noexcept override;
+	virtual strand_t& get_strand(void) noexcept override;
+	virtual void send_message(const uint8_t* message, size_t message_length, const message_sent_callback_t& callback) noexcept override;
+	virtual bool supports_compression(void) const noexcept override;
+
+	// Moves reads and writes of the connected socket to an io_uring, with
+	// the same framing and callbacks. Configure before connecting. Returns
+	// false if the kernel or the build lacks the required io_uring features.
+	bool enable_io_uring(const uring_options& options = uring_options()) noexcept;
+
+	virtual ~stream_jet_connection() noexcept;
+
+protected:
+	stream_jet_connection(boost::asio::io_context& ioc) noexcept;
+
+	boost::asio::io_context& m_io_context;
+	strand_t m_strand;
+	boost::asio::generic::stream_protocol::socket m_socket;
+	timer_wheel& m_timer_wheel;
+	wheel_timer m_connect_timer;
+	uint64_t m_connect_generation = 0;
+
+	void start_connect_timeout(std::chrono::milliseconds timeout, const timeout_callback_t& handler);
+	void stop_connect_timeout(void) noexcept;
+	void connect_handler(const boost::system::error_code& ec) noexcept;
+	void connect_timeout_handler(void) noexcept;
+	void close_socket(void) noexcept;
+
+private:
+	struct send_request {
+		uint32_t header;
+		const uint8_t* message;
+		size_t message_length;
+		message_sent_callback_t callback;
+		std::vector<uint8_t> compressed;
+	};
+
+	class send_buffer_sequence {
+	public:
+		typedef boost::asio::const_buffer value_type;
+		typedef const boost::asio::const_buffer* const_iterator;
+
+		explicit send_buffer_sequence(const std::vector<boost::asio::const_buffer>& buffers) noexcept
+		        : m_begin(buffers.data())
+		        , m_end(buffers.data() + buffers.size())
+		{
+		}
+
+		const_iterator begin(void) const noexcept
+		{
+			return m_begin;
+		}
+
+		const_iterator end(void) const noexcept
+		{
+			return m_end;
+		}
+
+	private:
+		const_iterator m_begin;
+		const_iterator m_end;
+	};
+
+	static const std::size_t WRITE_HANDLER_MEMORY_SIZE = 1024;
+
+	receive_buffer m_receive_buffer;
+	handler_memory m_read_handler_memory;
+	handler_memory m_write_handler_memory;
+	handler_memory m_flush_handler_memory;
+	bool m_receiving = false;
+	bool m_dispatching = false;
+	message_received_callback_t m_pending_message_received_callback = nullptr;
+	std::vector<send_request> m_send_queue;
+	std::vector<send_request> m_sending;
+	std::vector<boost::asio::const_buffer> m_send_buffers;
+	bool m_flush_scheduled = false;
+	bool m_writing = false;
+	frame_compressor m_compressor;
+	std::unique_ptr<uring_engine> m_uring;
+
+	void read_data(void) noexcept;
+	void data_read(const boost::system::error_code& ec, std::size_t bytes_transferred) noexcept;
+	bool uring_ready(void) noexcept;
+	void uring_data_read(const boost::system::error_code& ec, const uint8_t* data, std::size_t length) noexcept;
+
+	std::size_t handle_messages(void) noexcept;
+	bool inflate_message(const uint8_t*& message, std::size_t& message_length, enum error_code& ec) noexcept;
+	void fail_receive(enum error_code ec) noexcept;
+
+	void flush_send_queue(void) noexcept;
+	void data_written(const boost::system::error_code& ec, std::size_t bytes_transferred) noexcept;
+};
+} // namespace scramjet
+
+#endif
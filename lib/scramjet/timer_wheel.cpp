@@ -0,0 +1,310 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include "scramjet/timer_wheel.hpp"
+
+namespace scramjet {
+
+static const uint64_t MAX_TIMEOUT_TICKS = (UINT64_C(1) << 32) - (UINT64_C(1) << 24) - 1;
+
+static unsigned int count_trailing_zeros(uint64_t value) noexcept
+{
+#if defined(__GNUC__)
+	return static_cast<unsigned int>(__builtin_ctzll(value));
+#else
+	unsigned int count = 0;
+	while ((value & 1) == 0) {
+		value >>= 1;
+		count++;
+	}
+
+	return count;
+#endif
+}
+
+wheel_timer::wheel_timer() noexcept
+        : m_prev(nullptr)
+        , m_next(nullptr)
+        , m_wheel(nullptr)
+        , m_linked(false)
+        , m_expiry(0)
+        , m_callback(nullptr)
+{
+}
+
+wheel_timer::~wheel_timer() noexcept
+{
+	cancel();
+}
+
+void wheel_timer::cancel(void) noexcept
+{
+	if (!m_linked.load(std::memory_order_acquire)) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_wheel->m_mutex);
+	if (!m_linked.load(std::memory_order_relaxed)) {
+		return;
+	}
+
+	unlink();
+	m_wheel->m_count--;
+}
+
+bool wheel_timer::is_scheduled(void) const noexcept
+{
+	return m_linked.load(std::memory_order_acquire);
+}
+
+void wheel_timer::unlink(void) noexcept
+{
+	m_prev->m_next = m_next;
+	m_next->m_prev = m_prev;
+	m_prev = nullptr;
+	m_next = nullptr;
+	m_linked.store(false, std::memory_order_release);
+}
+
+boost::asio::io_context::id timer_wheel::id;
+
+timer_wheel::timer_wheel(boost::asio::io_context& ioc)
+        : boost::asio::io_context::service(ioc)
+        , m_tick_timer(ioc)
+        , m_start(std::chrono::steady_clock::now())
+        , m_current_tick(0)
+        , m_armed_tick(0)
+        , m_armed(false)
+        , m_count(0)
+{
+	for (auto& level : m_levels) {
+		for (slot_list& slot : level) {
+			slot.head.m_prev = &slot.head;
+			slot.head.m_next = &slot.head;
+		}
+	}
+
+	m_level0_bitmap.fill(0);
+}
+
+timer_wheel::~timer_wheel() noexcept
+{
+	shutdown();
+}
+
+void timer_wheel::shutdown()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto& level : m_levels) {
+		for (slot_list& slot : level) {
+			while (slot.head.m_next != &slot.head) {
+				wheel_timer* timer = slot.head.m_next;
+				timer->unlink();
+			}
+		}
+	}
+
+	m_count = 0;
+	boost::system::error_code ec;
+	m_tick_timer.cancel(ec);
+}
+
+void timer_wheel::schedule(wheel_timer& timer, std::chrono::milliseconds timeout, const timeout_callback_t& callback)
+{
+	timer.cancel();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	timer.m_callback = callback;
+
+	uint64_t now = now_tick();
+	if ((m_count == 0) && (now > m_current_tick)) {
+		m_current_tick = now;
+	}
+
+	uint64_t ticks = static_cast<uint64_t>(std::max(timeout.count(), static_cast<std::chrono::milliseconds::rep>(0)));
+	uint64_t expiry = now + std::min(ticks, MAX_TIMEOUT_TICKS);
+	timer.m_expiry = std::max(expiry, m_current_tick + 1);
+	timer.m_wheel = this;
+	insert(timer);
+	timer.m_linked.store(true, std::memory_order_release);
+	m_count++;
+
+	arm();
+}
+
+uint64_t timer_wheel::now_tick(void) const noexcept
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_start).count());
+}
+
+uint64_t timer_wheel::next_event_tick(void) const noexcept
+{
+	uint64_t position = m_current_tick & SLOT_MASK;
+	uint64_t base = m_current_tick - position;
+
+	uint64_t index = position + 1;
+	while (index < SLOTS) {
+		uint64_t bits = m_level0_bitmap[index / 64] >> (index % 64);
+		if (bits != 0) {
+			return base + index + count_trailing_zeros(bits);
+		}
+
+		index = (index / 64 + 1) * 64;
+	}
+
+	return base + SLOTS;
+}
+
+void timer_wheel::insert(wheel_timer& timer) noexcept
+{
+	uint64_t delta = timer.m_expiry - m_current_tick;
+	unsigned int level = 0;
+	while ((level < LEVELS - 1) && (delta >= (UINT64_C(1) << ((level + 1) * SLOT_BITS)))) {
+		level++;
+	}
+
+	std::size_t index = static_cast<std::size_t>((timer.m_expiry >> (level * SLOT_BITS)) & SLOT_MASK);
+	wheel_timer& head = m_levels[level][index].head;
+	timer.m_next = &head;
+	timer.m_prev = head.m_prev;
+	head.m_prev->m_next = &timer;
+	head.m_prev = &timer;
+
+	if (level == 0) {
+		m_level0_bitmap[index / 64] |= UINT64_C(1) << (index % 64);
+	}
+}
+
+void timer_wheel::cascade(unsigned int level) noexcept
+{
+	std::size_t index = static_cast<std::size_t>((m_current_tick >> (level * SLOT_BITS)) & SLOT_MASK);
+	wheel_timer& head = m_levels[level][index].head;
+	while (head.m_next != &head) {
+		wheel_timer* timer = head.m_next;
+		timer->unlink();
+		insert(*timer);
+	}
+
+	if ((index == 0) && (level + 1 < LEVELS)) {
+		cascade(level + 1);
+	}
+}
+
+void timer_wheel::fire_slot(std::size_t index, std::unique_lock<std::mutex>& lock)
+{
+	m_level0_bitmap[index / 64] &= ~(UINT64_C(1) << (index % 64));
+
+	wheel_timer expired;
+	wheel_timer& head = m_levels[0][index].head;
+	if (head.m_next == &head) {
+		return;
+	}
+
+	expired.m_next = head.m_next;
+	expired.m_prev = head.m_prev;
+	expired.m_next->m_prev = &expired;
+	expired.m_prev->m_next = &expired;
+	head.m_next = &head;
+	head.m_prev = &head;
+
+	while (expired.m_next != &expired) {
+		wheel_timer* timer = expired.m_next;
+		timer->unlink();
+		m_count--;
+
+		timeout_callback_t callback = std::move(timer->m_callback);
+		timer->m_callback = nullptr;
+		if (callback != nullptr) {
+			lock.unlock();
+			callback();
+			lock.lock();
+		}
+	}
+}
+
+void timer_wheel::advance(uint64_t tick, std::unique_lock<std::mutex>& lock)
+{
+	while (m_current_tick < tick) {
+		uint64_t next = next_event_tick();
+		if (next > tick) {
+			m_current_tick = tick;
+			break;
+		}
+
+		m_current_tick = next;
+		if ((m_current_tick & SLOT_MASK) == 0) {
+			cascade(1);
+		}
+
+		fire_slot(static_cast<std::size_t>(m_current_tick & SLOT_MASK), lock);
+	}
+}
+
+void timer_wheel::arm(void)
+{
+	if (m_count == 0) {
+		return;
+	}
+
+	uint64_t next = next_event_tick();
+	if (m_armed && (m_armed_tick <= next)) {
+		return;
+	}
+
+	m_armed = true;
+	m_armed_tick = next;
+	m_tick_timer.expires_at(m_start + std::chrono::milliseconds(next));
+
+	using namespace std::placeholders;
+	m_tick_timer.async_wait(std::bind(&timer_wheel::tick_timer_expired, this, _1));
+}
+
+void timer_wheel::tick_timer_expired(const boost::system::error_code& ec)
+{
+	if (ec && (ec == boost::asio::error::operation_aborted)) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_armed = false;
+	advance(now_tick(), lock);
+	arm();
+}
+
+} // namespace scramjet
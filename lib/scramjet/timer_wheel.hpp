@@ -0,0 +1,120 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCRAMJET__TIMER_WHEEL_HPP
+#define SCRAMJET__TIMER_WHEEL_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdbool>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include "scramjet/small_function.hpp"
+
+namespace scramjet {
+
+typedef small_function<void(void)> timeout_callback_t;
+
+class timer_wheel;
+
+class wheel_timer final {
+public:
+	wheel_timer() noexcept;
+	~wheel_timer() noexcept;
+
+	wheel_timer(const wheel_timer&) = delete;
+	wheel_timer& operator=(const wheel_timer&) = delete;
+
+	void cancel(void) noexcept;
+	bool is_scheduled(void) const noexcept;
+
+private:
+	friend class timer_wheel;
+
+	wheel_timer* m_prev;
+	wheel_timer* m_next;
+	timer_wheel* m_wheel;
+	std::atomic<bool> m_linked;
+	uint64_t m_expiry;
+	timeout_callback_t m_callback;
+
+	void unlink(void) noexcept;
+};
+
+class timer_wheel final : public boost::asio::io_context::service {
+public:
+	static boost::asio::io_context::id id;
+
+	explicit timer_wheel(boost::asio::io_context& ioc);
+	virtual ~timer_wheel() noexcept;
+
+	void schedule(wheel_timer& timer, std::chrono::milliseconds timeout, const timeout_callback_t& callback);
+
+private:
+	friend class wheel_timer;
+
+	static const unsigned int LEVELS = 4;
+	static const unsigned int SLOT_BITS = 8;
+	static const unsigned int SLOTS = 1U << SLOT_BITS;
+	static const uint64_t SLOT_MASK = SLOTS - 1;
+
+	struct slot_list {
+		wheel_timer head;
+	};
+
+	std::mutex m_mutex;
+	boost::asio::steady_timer m_tick_timer;
+	std::chrono::steady_clock::time_point m_start;
+	uint64_t m_current_tick;
+	uint64_t m_armed_tick;
+	bool m_armed;
+	std::size_t m_count;
+	std::array<std::array<slot_list, SLOTS>, LEVELS> m_levels;
+	std::array<uint64_t, SLOTS / 64> m_level0_bitmap;
+
+	virtual void shutdown() override;
+
+	uint64_t now_tick(void) const noexcept;
+	uint64_t next_event_tick(void) const noexcept;
+	void insert(wheel_timer& timer) noexcept;
+	void cascade(unsigned int level) noexcept;
+	void fire_slot(std::size_t index, std::unique_lock<std::mutex>& lock);
+	void advance(uint64_t tick, std::unique_lock<std::mutex>& lock);
+	void arm(void);
+	void tick_timer_expired(const boost::system::error_code& ec);
+};
+
+} // namespace scramjet
+
+#endif
@@ -0,0 +1,72 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <chrono>
+#include <functional>
+#include <string>
+
+#include <boost/asio.hpp>
+
+#include "scramjet/jet_connection.hpp"
+#include "scramjet/stream_jet_connection.hpp"
+#include "scramjet/unix_jet_connection.hpp"
+
+namespace scramjet {
+unix_jet_connection::unix_jet_connection(boost::asio::io_context& ioc, const std::string& path) noexcept
+        : stream_jet_connection(ioc)
+        , m_path(path)
+{
+}
+
+unix_jet_connection::~unix_jet_connection() noexcept
+{
+}
+
+void unix_jet_connection::connect(const connected_callback_t& connect_callback, std::chrono::milliseconds timeout) noexcept
+{
+	if (!m_strand.running_in_this_thread()) {
+		boost::asio::post(m_strand, std::bind(&unix_jet_connection::connect, this, connect_callback, timeout));
+		return;
+	}
+
+	m_connected_callback = connect_callback;
+	m_connect_timeout = timeout;
+
+	std::string path = m_path;
+	if (!path.empty() && (path[0] == '@')) {
+		path[0] = '\0';
+	}
+
+	boost::asio::local::stream_protocol::endpoint ep(path);
+
+	using namespace std::placeholders;
+	m_socket.async_connect(ep, boost::asio::bind_executor(m_strand, std::bind(&unix_jet_connection::connect_handler, this, _1)));
+	start_connect_timeout(timeout, std::bind(&unix_jet_connection::connect_timeout_handler, this));
+}
+
+} // namespace scramjet
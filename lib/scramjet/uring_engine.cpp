@@ -0,0 +1,712 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#if defined(SCRAMJET_HAS_IO_URING)
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include "scramjet/handler_allocator.hpp"
+#include "scramjet/jet_connection.hpp"
+#include "scramjet/uring_engine.hpp"
+
+namespace scramjet {
+
+#if defined(SCRAMJET_HAS_IO_URING)
+
+static const uint16_t BUFFER_GROUP = 0;
+
+static uint64_t make_user_data(uint64_t generation, uint8_t operation) noexcept
+{
+	return (generation << 8) | operation;
+}
+
+// Compiled as C++, the empty struct in front of the bufs flexible array of
+// io_uring_buf_ring takes a byte and moves the array off the ring start.
+static struct io_uring_buf* ring_entry(struct io_uring_buf_ring* ring, unsigned int index) noexcept
+{
+	return reinterpret_cast<struct io_uring_buf*>(ring) + index;
+}
+
+static boost::system::error_code make_error(int32_t result) noexcept
+{
+	return boost::system::error_code(-result, boost::system::system_category());
+}
+
+uring_engine::uring_engine(boost::asio::io_context& ioc, strand_t& strand) noexcept
+        : m_strand(strand)
+        , m_event(ioc)
+{
+	std::memset(&m_message, 0, sizeof(m_message));
+}
+
+uring_engine::~uring_engine() noexcept
+{
+	detach();
+
+	// The kernel may still write into the provided buffers until every
+	// operation completed.
+	while ((m_ring_fd >= 0) && (m_in_flight > 0)) {
+		if ((enter(0, 1, IORING_ENTER_GETEVENTS) < 0) && (errno != EINTR)) {
+			break;
+		}
+		reap(false);
+	}
+
+	close();
+}
+
+static bool supports_operations(int ring_fd) noexcept
+{
+	static const unsigned int PROBE_OPS = 256;
+	uint64_t storage[(sizeof(struct io_uring_probe) + PROBE_OPS * sizeof(struct io_uring_probe_op)) / sizeof(uint64_t)];
+	std::memset(storage, 0, sizeof(storage));
+	struct io_uring_probe* probe = reinterpret_cast<struct io_uring_probe*>(storage);
+	if (::syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe, PROBE_OPS) < 0) {
+		return false;
+	}
+
+	// Multishot receive cannot be probed for, zero copy send came with
+	// the same kernel release.
+	for (uint8_t op : {IORING_OP_RECV, IORING_OP_SENDMSG, IORING_OP_ASYNC_CANCEL, IORING_OP_SEND_ZC}) {
+		if ((op > probe->last_op) || ((probe->ops[op].flags & IO_URING_OP_SUPPORTED) == 0)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool probe_kernel(void) noexcept
+{
+	struct io_uring_params params;
+	std::memset(&params, 0, sizeof(params));
+	int ring_fd = static_cast<int>(::syscall(__NR_io_uring_setup, 2, &params));
+	if (ring_fd < 0) {
+		return false;
+	}
+
+	bool supported = supports_operations(ring_fd);
+	::close(ring_fd);
+	return supported;
+}
+
+bool uring_engine::is_available(void) noexcept
+{
+	static const bool available = probe_kernel();
+	return available;
+}
+
+bool uring_engine::open(const uring_options& options) noexcept
+{
+	if (m_ring_fd >= 0) {
+		return true;
+	}
+
+	if (!setup_rings(options) || !supports_operations(m_ring_fd) || !setup_buffers(options)) {
+		close();
+		return false;
+	}
+
+	int event_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (event_fd < 0) {
+		close();
+		return false;
+	}
+
+	if (::syscall(__NR_io_uring_register, m_ring_fd, IORING_REGISTER_EVENTFD, &event_fd, 1) < 0) {
+		::close(event_fd);
+		close();
+		return false;
+	}
+
+	boost::system::error_code ec;
+	m_event.assign(event_fd, ec);
+	if (ec) {
+		::close(event_fd);
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+bool uring_engine::setup_rings(const uring_options& options) noexcept
+{
+	struct io_uring_params params;
+	std::memset(&params, 0, sizeof(params));
+	if (options.sqpoll) {
+		params.flags |= IORING_SETUP_SQPOLL;
+		params.sq_thread_idle = static_cast<uint32_t>(options.sq_idle.count());
+	}
+
+	m_ring_fd = static_cast<int>(::syscall(__NR_io_uring_setup, std::max(options.queue_depth, 2U), &params));
+	if (m_ring_fd < 0) {
+		return false;
+	}
+
+	m_sqpoll = options.sqpoll;
+	m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+	m_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+		m_sq_ring_size = std::max(m_sq_ring_size, m_cq_ring_size);
+		m_cq_ring_size = m_sq_ring_size;
+	}
+
+	void* sq_ring = ::mmap(nullptr, m_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQ_RING);
+	if (sq_ring == MAP_FAILED) {
+		return false;
+	}
+	m_sq_ring = sq_ring;
+
+	if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+		m_cq_ring = m_sq_ring;
+	} else {
+		void* cq_ring = ::mmap(nullptr, m_cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_CQ_RING);
+		if (cq_ring == MAP_FAILED) {
+			return false;
+		}
+		m_cq_ring = cq_ring;
+	}
+
+	m_sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	void* sqes = ::mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED) {
+		return false;
+	}
+	m_sqes = static_cast<struct io_uring_sqe*>(sqes);
+
+	uint8_t* sq = static_cast<uint8_t*>(m_sq_ring);
+	m_sq_head = reinterpret_cast<unsigned int*>(sq + params.sq_off.head);
+	m_sq_tail = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+	m_sq_flags = reinterpret_cast<unsigned int*>(sq + params.sq_off.flags);
+	m_sq_array = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+	m_sq_mask = *reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+	m_sq_entries = params.sq_entries;
+	m_sq_local_tail = *m_sq_tail;
+
+	uint8_t* cq = static_cast<uint8_t*>(m_cq_ring);
+	m_cq_head = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+	m_cq_tail = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+	m_cq_mask = *reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+	m_cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+	return true;
+}
+
+bool uring_engine::setup_buffers(const uring_options& options) noexcept
+{
+	unsigned int count = 1;
+	while ((count < options.buffer_count) && (count < 32768)) {
+		count <<= 1;
+	}
+
+	m_buffer_count = count;
+	m_buffer_size = std::max(options.buffer_size, static_cast<std::size_t>(1024));
+	m_buffers.reset(new (std::nothrow) uint8_t[m_buffer_count * m_buffer_size]);
+	if (m_buffers == nullptr) {
+		return false;
+	}
+
+	m_buffer_ring_size = m_buffer_count * sizeof(struct io_uring_buf);
+	void* ring = ::mmap(nullptr, m_buffer_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ring == MAP_FAILED) {
+		return false;
+	}
+	m_buffer_ring = static_cast<struct io_uring_buf_ring*>(ring);
+
+	struct io_uring_buf_reg registration;
+	std::memset(&registration, 0, sizeof(registration));
+	registration.ring_addr = reinterpret_cast<uint64_t>(m_buffer_ring);
+	registration.ring_entries = m_buffer_count;
+	registration.bgid = BUFFER_GROUP;
+	if (::syscall(__NR_io_uring_register, m_ring_fd, IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+		::munmap(m_buffer_ring, m_buffer_ring_size);
+		m_buffer_ring = nullptr;
+		return false;
+	}
+
+	m_buffer_tail = 0;
+	for (unsigned int i = 0; i < m_buffer_count; i++) {
+		struct io_uring_buf* buffer = ring_entry(m_buffer_ring, i);
+		buffer->addr = reinterpret_cast<uint64_t>(&m_buffers[i * m_buffer_size]);
+		buffer->len = static_cast<uint32_t>(m_buffer_size);
+		buffer->bid = static_cast<uint16_t>(i);
+	}
+
+	m_buffer_tail = static_cast<uint16_t>(m_buffer_count);
+	__atomic_store_n(&m_buffer_ring->tail, m_buffer_tail, __ATOMIC_RELEASE);
+	return true;
+}
+
+void uring_engine::close(void) noexcept
+{
+	boost::system::error_code ec;
+	m_event.close(ec);
+
+	if (m_buffer_ring != nullptr) {
+		struct io_uring_buf_reg registration;
+		std::memset(&registration, 0, sizeof(registration));
+		registration.bgid = BUFFER_GROUP;
+		::syscall(__NR_io_uring_register, m_ring_fd, IORING_UNREGISTER_PBUF_RING, &registration, 1);
+		::munmap(m_buffer_ring, m_buffer_ring_size);
+		m_buffer_ring = nullptr;
+	}
+
+	if (m_sqes != nullptr) {
+		::munmap(m_sqes, m_sqes_size);
+		m_sqes = nullptr;
+	}
+
+	if ((m_cq_ring != nullptr) && (m_cq_ring != m_sq_ring)) {
+		::munmap(m_cq_ring, m_cq_ring_size);
+	}
+	m_cq_ring = nullptr;
+
+	if (m_sq_ring != nullptr) {
+		::munmap(m_sq_ring, m_sq_ring_size);
+		m_sq_ring = nullptr;
+	}
+
+	if (m_ring_fd >= 0) {
+		::close(m_ring_fd);
+		m_ring_fd = -1;
+	}
+}
+
+void uring_engine::attach(int fd) noexcept
+{
+	m_fd = fd;
+	m_generation++;
+	m_receiving = false;
+	m_writing = false;
+}
+
+void uring_engine::detach(void) noexcept
+{
+	if (m_fd < 0) {
+		return;
+	}
+
+	::shutdown(m_fd, SHUT_RDWR);
+	struct io_uring_sqe* sqe = get_sqe();
+	if (sqe != nullptr) {
+		sqe->opcode = IORING_OP_ASYNC_CANCEL;
+		sqe->fd = m_fd;
+		sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+		sqe->user_data = make_user_data(m_generation, OPERATION_CANCEL);
+		m_in_flight++;
+		submit();
+	}
+
+	// Completions of the detached socket are stale from now on, the
+	// receive and write state only tracks the current generation.
+	m_fd = -1;
+	m_generation++;
+	m_receiving = false;
+	m_writing = false;
+}
+
+bool uring_engine::is_attached(void) const noexcept
+{
+	return m_fd >= 0;
+}
+
+bool uring_engine::is_receiving(void) const noexcept
+{
+	return m_receiving;
+}
+
+struct io_uring_sqe* uring_engine::get_sqe(void) noexcept
+{
+	unsigned int head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+	if (m_sq_local_tail - head >= m_sq_entries) {
+		submit();
+		head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+		if (m_sq_local_tail - head >= m_sq_entries) {
+			return nullptr;
+		}
+	}
+
+	unsigned int index = m_sq_local_tail & m_sq_mask;
+	struct io_uring_sqe* sqe = &m_sqes[index];
+	std::memset(sqe, 0, sizeof(*sqe));
+	m_sq_array[index] = index;
+	m_sq_local_tail++;
+	return sqe;
+}
+
+void uring_engine::submit(void) noexcept
+{
+	// The eventfd is only watched while operations are outstanding so an
+	// idle engine does not keep the io_context running.
+	if (!m_waiting && (m_in_flight > 0)) {
+		wait_event();
+	}
+
+	__atomic_store_n(m_sq_tail, m_sq_local_tail, __ATOMIC_RELEASE);
+	if (m_sqpoll) {
+		// Orders the tail store before reading whether the poller sleeps.
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		if ((__atomic_load_n(m_sq_flags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP) != 0) {
+			enter(0, 0, IORING_ENTER_SQ_WAKEUP);
+		}
+		return;
+	}
+
+	unsigned int pending = m_sq_local_tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+	while (pending > 0) {
+		int submitted = enter(pending, 0, 0);
+		if (submitted < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		pending = m_sq_local_tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+		if (submitted == 0) {
+			break;
+		}
+	}
+}
+
+int uring_engine::enter(unsigned int to_submit, unsigned int min_complete, unsigned int flags) noexcept
+{
+	return static_cast<int>(::syscall(__NR_io_uring_enter, m_ring_fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+void uring_engine::start_receive(const uring_receive_callback_t& callback) noexcept
+{
+	m_receive_callback = callback;
+	arm_receive();
+	if (!m_reaping) {
+		submit();
+	}
+}
+
+void uring_engine::arm_receive(void) noexcept
+{
+	if ((m_fd < 0) || m_receiving) {
+		return;
+	}
+
+	struct io_uring_sqe* sqe = get_sqe();
+	if (sqe == nullptr) {
+		return;
+	}
+
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = m_fd;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = BUFFER_GROUP;
+	sqe->user_data = make_user_data(m_generation, OPERATION_RECEIVE);
+	m_receiving = true;
+	m_in_flight++;
+}
+
+void uring_engine::write(const boost::asio::const_buffer* buffers, std::size_t count, const uring_write_callback_t& callback) noexcept
+{
+	m_iovecs.resize(count);
+	for (std::size_t i = 0; i < count; i++) {
+		m_iovecs[i].iov_base = const_cast<void*>(buffers[i].data());
+		m_iovecs[i].iov_len = buffers[i].size();
+	}
+
+	m_iovec_index = 0;
+	m_written = 0;
+	m_write_callback = callback;
+	m_writing = true;
+	submit_send();
+	if (!m_reaping) {
+		submit();
+	}
+}
+
+void uring_engine::submit_send(void) noexcept
+{
+	struct io_uring_sqe* sqe = (m_fd >= 0) ? get_sqe() : nullptr;
+	if (sqe == nullptr) {
+		boost::system::error_code ec = (m_fd >= 0) ? boost::asio::error::no_buffer_space : boost::asio::error::operation_aborted;
+		boost::asio::post(m_strand, [this, ec]() {
+			finish_write(ec, true);
+		});
+		return;
+	}
+
+	std::memset(&m_message, 0, sizeof(m_message));
+	m_message.msg_iov = &m_iovecs[m_iovec_index];
+	m_message.msg_iovlen = std::min(m_iovecs.size() - m_iovec_index, static_cast<std::size_t>(IOV_MAX));
+
+	sqe->opcode = IORING_OP_SENDMSG;
+	sqe->fd = m_fd;
+	sqe->addr = reinterpret_cast<uint64_t>(&m_message);
+	sqe->len = 1;
+	sqe->msg_flags = MSG_NOSIGNAL;
+	sqe->user_data = make_user_data(m_generation, OPERATION_SEND);
+	m_in_flight++;
+}
+
+void uring_engine::recycle_buffer(uint16_t buffer_id) noexcept
+{
+	struct io_uring_buf* buffer = ring_entry(m_buffer_ring, m_buffer_tail & (m_buffer_count - 1));
+	buffer->addr = reinterpret_cast<uint64_t>(&m_buffers[buffer_id * m_buffer_size]);
+	buffer->len = static_cast<uint32_t>(m_buffer_size);
+	buffer->bid = buffer_id;
+	m_buffer_tail++;
+	__atomic_store_n(&m_buffer_ring->tail, m_buffer_tail, __ATOMIC_RELEASE);
+}
+
+void uring_engine::wait_event(void) noexcept
+{
+	if (!m_event.is_open()) {
+		return;
+	}
+
+	m_waiting = true;
+	m_event.async_read_some(boost::asio::buffer(&m_event_value, sizeof(m_event_value)),
+	                        boost::asio::bind_executor(m_strand,
+	                                                   make_alloc_handler(m_event_handler_memory,
+	                                                                      std::bind(&uring_engine::event_signalled,
+	                                                                                this,
+	                                                                                std::placeholders::_1))));
+}
+
+void uring_engine::event_signalled(const boost::system::error_code& ec) noexcept
+{
+	m_waiting = false;
+	if (ec == boost::asio::error::operation_aborted) {
+		return;
+	}
+
+	reap(true);
+	if (!m_waiting && (m_in_flight > 0)) {
+		wait_event();
+	}
+}
+
+void uring_engine::reap(bool dispatch) noexcept
+{
+	m_reaping = true;
+	unsigned int head = *m_cq_head;
+	unsigned int tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+	while (head != tail) {
+		const struct io_uring_cqe& cqe = m_cqes[head & m_cq_mask];
+		uint64_t user_data = cqe.user_data;
+		int32_t result = cqe.res;
+		uint32_t flags = cqe.flags;
+		head++;
+		__atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+
+		complete(user_data, result, flags, dispatch);
+		if (head == tail) {
+			// Completions that did not fit into the ring are kept by the
+			// kernel until the next enter.
+			if ((__atomic_load_n(m_sq_flags, __ATOMIC_ACQUIRE) & IORING_SQ_CQ_OVERFLOW) != 0) {
+				enter(0, 0, IORING_ENTER_GETEVENTS);
+			}
+			tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+		}
+	}
+
+	m_reaping = false;
+	if (dispatch) {
+		submit();
+	}
+}
+
+void uring_engine::complete(uint64_t user_data, int32_t result, uint32_t flags, bool dispatch) noexcept
+{
+	switch (static_cast<uint8_t>(user_data & 0xff)) {
+	case OPERATION_RECEIVE:
+		receive_completed(user_data >> 8, result, flags, dispatch);
+		break;
+
+	case OPERATION_SEND:
+		m_in_flight--;
+		send_completed(user_data >> 8, result, dispatch);
+		break;
+
+	default:
+		m_in_flight--;
+		break;
+	}
+}
+
+void uring_engine::receive_completed(uint64_t generation, int32_t result, uint32_t flags, bool dispatch) noexcept
+{
+	bool current = (generation == m_generation);
+	if ((flags & IORING_CQE_F_BUFFER) != 0) {
+		uint16_t buffer_id = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+		if (dispatch && current && (result > 0) && (m_receive_callback != nullptr)) {
+			m_receive_callback(boost::system::error_code(), &m_buffers[buffer_id * m_buffer_size], static_cast<std::size_t>(result));
+		}
+		recycle_buffer(buffer_id);
+	}
+
+	if ((flags & IORING_CQE_F_MORE) != 0) {
+		return;
+	}
+
+	m_in_flight--;
+	if (!current) {
+		return;
+	}
+
+	m_receiving = false;
+	if ((result > 0) || (result == -ENOBUFS)) {
+		// The multishot receive ran out of buffers or was ended by the
+		// kernel, all buffers are back in the ring by now.
+		arm_receive();
+		return;
+	}
+
+	if (!dispatch || (m_receive_callback == nullptr)) {
+		return;
+	}
+
+	boost::system::error_code ec;
+	if (result == 0) {
+		ec = boost::asio::error::eof;
+	} else {
+		ec = make_error(result);
+	}
+
+	m_receive_callback(ec, nullptr, 0);
+}
+
+void uring_engine::send_completed(uint64_t generation, int32_t result, bool dispatch) noexcept
+{
+	if (generation != m_generation) {
+		// The rest of the write must not go to a socket attached since.
+		finish_write(boost::asio::error::operation_aborted, dispatch);
+		return;
+	}
+
+	if (result < 0) {
+		finish_write((result == -ECANCELED) ? boost::system::error_code(boost::asio::error::operation_aborted) : make_error(result), dispatch);
+		return;
+	}
+
+	std::size_t sent = static_cast<std::size_t>(result);
+	m_written += sent;
+	while ((m_iovec_index < m_iovecs.size()) && (sent >= m_iovecs[m_iovec_index].iov_len)) {
+		sent -= m_iovecs[m_iovec_index].iov_len;
+		m_iovec_index++;
+	}
+
+	if (m_iovec_index == m_iovecs.size()) {
+		finish_write(boost::system::error_code(), dispatch);
+		return;
+	}
+
+	m_iovecs[m_iovec_index].iov_base = static_cast<uint8_t*>(m_iovecs[m_iovec_index].iov_base) + sent;
+	m_iovecs[m_iovec_index].iov_len -= sent;
+	if (!dispatch) {
+		m_writing = false;
+		return;
+	}
+
+	submit_send();
+}
+
+void uring_engine::finish_write(const boost::system::error_code& ec, bool dispatch) noexcept
+{
+	m_writing = false;
+	uring_write_callback_t callback = std::move(m_write_callback);
+	m_write_callback = nullptr;
+	if (dispatch && (callback != nullptr)) {
+		callback(ec, m_written);
+	}
+}
+
+#else
+
+uring_engine::uring_engine(boost::asio::io_context&, strand_t&) noexcept
+{
+}
+
+uring_engine::~uring_engine() noexcept
+{
+}
+
+bool uring_engine::is_available(void) noexcept
+{
+	return false;
+}
+
+bool uring_engine::open(const uring_options&) noexcept
+{
+	return false;
+}
+
+void uring_engine::attach(int) noexcept
+{
+}
+
+void uring_engine::detach(void) noexcept
+{
+}
+
+bool uring_engine::is_attached(void) const noexcept
+{
+	return false;
+}
+
+bool uring_engine::is_receiving(void) const noexcept
+{
+	return false;
+}
+
+void uring_engine::start_receive(const uring_receive_callback_t&) noexcept
+{
+}
+
+void uring_engine::write(const boost::asio::const_buffer*, std::size_t, const uring_write_callback_t&) noexcept
+{
+}
+
+#endif
+
+} // namespace scramjet
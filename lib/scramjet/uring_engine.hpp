@@ -0,0 +1,179 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCRAMJET__URING_ENGINE_HPP
+#define SCRAMJET__URING_ENGINE_HPP
+
+#include <chrono>
+#include <cstdbool>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "scramjet/handler_allocator.hpp"
+#include "scramjet/jet_connection.hpp"
+#include "scramjet/small_function.hpp"
+
+#if defined(SCRAMJET_HAS_IO_URING)
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+struct io_uring_buf_ring;
+struct io_uring_cqe;
+struct io_uring_sqe;
+
+namespace scramjet {
+
+struct uring_options {
+	unsigned int queue_depth = 64;
+	// Provided buffers the kernel receives into, recycled as soon as their
+	// data is copied into the receive buffer. buffer_count is rounded up to
+	// a power of two.
+	unsigned int buffer_count = 64;
+	std::size_t buffer_size = 16 * 1024;
+	// A kernel thread polls the submission queue, so sends need no
+	// syscall while it is awake. It costs a CPU spinning for sq_idle.
+	bool sqpoll = false;
+	std::chrono::milliseconds sq_idle = std::chrono::milliseconds(100);
+};
+
+typedef small_function<void(const boost::system::error_code& ec, const uint8_t* data, std::size_t length)> uring_receive_callback_t;
+typedef small_function<void(const boost::system::error_code& ec, std::size_t bytes_transferred)> uring_write_callback_t;
+
+// Socket I/O of one connection through an io_uring, driven from the
+// connection's strand: a multishot receive into a ring of provided
+// buffers and a single sendmsg per gathered write. Completions are
+// signalled through an eventfd watched by the io_context.
+class uring_engine final {
+public:
+	uring_engine(boost::asio::io_context& ioc, strand_t& strand) noexcept;
+	~uring_engine() noexcept;
+
+	uring_engine(const uring_engine&) = delete;
+	uring_engine& operator=(const uring_engine&) = delete;
+
+	bool open(const uring_options& options) noexcept;
+
+	void attach(int fd) noexcept;
+	// Shuts the socket down. Receives still outstanding complete silently, a
+	// pending write completes with boost::asio::error::operation_aborted.
+	void detach(void) noexcept;
+	bool is_attached(void) const noexcept;
+	bool is_receiving(void) const noexcept;
+
+	// The callback gets the data of every receive and a final error when
+	// the peer closes or the receive fails.
+	void start_receive(const uring_receive_callback_t& callback) noexcept;
+	void write(const boost::asio::const_buffer* buffers, std::size_t count, const uring_write_callback_t& callback) noexcept;
+
+	static bool is_available(void) noexcept;
+
+private:
+#if defined(SCRAMJET_HAS_IO_URING)
+	enum operation : uint8_t {
+		OPERATION_RECEIVE = 1,
+		OPERATION_SEND,
+		OPERATION_CANCEL,
+	};
+
+	strand_t& m_strand;
+	boost::asio::posix::stream_descriptor m_event;
+	handler_memory m_event_handler_memory;
+	uint64_t m_event_value = 0;
+	bool m_waiting = false;
+
+	int m_ring_fd = -1;
+	bool m_sqpoll = false;
+	void* m_sq_ring = nullptr;
+	std::size_t m_sq_ring_size = 0;
+	void* m_cq_ring = nullptr;
+	std::size_t m_cq_ring_size = 0;
+	io_uring_sqe* m_sqes = nullptr;
+	std::size_t m_sqes_size = 0;
+	unsigned int* m_sq_head = nullptr;
+	unsigned int* m_sq_tail = nullptr;
+	unsigned int* m_sq_flags = nullptr;
+	unsigned int* m_sq_array = nullptr;
+	unsigned int m_sq_mask = 0;
+	unsigned int m_sq_entries = 0;
+	unsigned int m_sq_local_tail = 0;
+	unsigned int* m_cq_head = nullptr;
+	unsigned int* m_cq_tail = nullptr;
+	unsigned int m_cq_mask = 0;
+	io_uring_cqe* m_cqes = nullptr;
+	bool m_reaping = false;
+	std::size_t m_in_flight = 0;
+
+	io_uring_buf_ring* m_buffer_ring = nullptr;
+	std::size_t m_buffer_ring_size = 0;
+	std::unique_ptr<uint8_t[]> m_buffers;
+	std::size_t m_buffer_size = 0;
+	unsigned int m_buffer_count = 0;
+	uint16_t m_buffer_tail = 0;
+
+	int m_fd = -1;
+	uint64_t m_generation = 0;
+	bool m_receiving = false;
+	uring_receive_callback_t m_receive_callback = nullptr;
+
+	bool m_writing = false;
+	std::vector<struct iovec> m_iovecs;
+	std::size_t m_iovec_index = 0;
+	struct msghdr m_message;
+	std::size_t m_written = 0;
+	uring_write_callback_t m_write_callback = nullptr;
+
+	bool setup_rings(const uring_options& options) noexcept;
+	bool setup_buffers(const uring_options& options) noexcept;
+	void close(void) noexcept;
+
+	io_uring_sqe* get_sqe(void) noexcept;
+	void submit(void) noexcept;
+	int enter(unsigned int to_submit, unsigned int min_complete, unsigned int flags) noexcept;
+
+	void arm_receive(void) noexcept;
+	void submit_send(void) noexcept;
+	void recycle_buffer(uint16_t buffer_id) noexcept;
+
+	void wait_event(void) noexcept;
+	void event_signalled(const boost::system::error_code& ec) noexcept;
+	void reap(bool dispatch) noexcept;
+	void complete(uint64_t user_data, int32_t result, uint32_t flags, bool dispatch) noexcept;
+	void receive_completed(uint64_t generation, int32_t result, uint32_t flags, bool dispatch) noexcept;
+	void send_completed(uint64_t generation, int32_t result, bool dispatch) noexcept;
+	void finish_write(const boost::system::error_code& ec, bool dispatch) noexcept;
+#endif
+};
+
+} // namespace scramjet
+
+#endif
@@ -0,0 +1,138 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include <scramjet/error_code.hpp>
+#include <scramjet/jet_peer.hpp>
+#include <scramjet/memory_jet_connection.hpp>
+
+#include "loopback_server.hpp"
+
+namespace {
+
+const std::chrono::milliseconds TIMEOUT(10000);
+
+// Sizes around the 4 byte length prefix, the receive buffer's minimum read
+// and block size, and one frame much larger than a block.
+const std::size_t PAYLOAD_SIZES[] = {0, 1, 2, 3, 4, 5, 7, 8, 63, 64, 65, 4091, 4096, 4101, 65529, 65536, 65541, 300000};
+
+struct exchange {
+	scramjet::jet_peer* peer;
+	std::vector<std::vector<uint8_t>> payloads;
+	std::size_t completed;
+	std::size_t mismatches;
+	std::size_t failed;
+};
+
+bool run(const scramjet::memory_link_options& options)
+{
+	boost::asio::io_context ioc;
+	scramjet::memory_jet_connection::pair_t pair = scramjet::memory_jet_connection::create_pair(ioc, options);
+	scramjet::loopback_responder responder(*pair.second);
+	responder.start();
+
+	scramjet::jet_peer peer(std::move(pair.first));
+	exchange e = {&peer, {}, 0, 0, 0};
+	for (unsigned int round = 0; round < 3; round++) {
+		for (std::size_t size : PAYLOAD_SIZES) {
+			std::vector<uint8_t> payload(size);
+			for (std::size_t i = 0; i < size; i++) {
+				payload[i] = static_cast<uint8_t>((i * 31) + size + round);
+			}
+
+			e.payloads.push_back(std::move(payload));
+		}
+	}
+
+	peer.connect([&e](enum scramjet::error_code ec) {
+		if (ec != scramjet::SCRAMJET_OK) {
+			e.failed++;
+			return;
+		}
+
+		// All requests are in flight at once so frames share fragments.
+		for (const std::vector<uint8_t>& payload : e.payloads) {
+			const std::vector<uint8_t>* expected = &payload;
+			exchange* state = &e;
+			e.peer->request(payload.data(), payload.size(), [state, expected](enum scramjet::error_code response_ec, const uint8_t* response, size_t response_length) {
+				if (response_ec != scramjet::SCRAMJET_OK) {
+					state->failed++;
+				} else if ((response_length != expected->size()) ||
+				           ((response_length > 0) && (std::memcmp(response, expected->data(), response_length) != 0))) {
+					state->mismatches++;
+				}
+
+				if (++state->completed == state->payloads.size()) {
+					state->peer->disconnect();
+				}
+			},
+			                TIMEOUT);
+		}
+	},
+	             TIMEOUT);
+	ioc.run();
+
+	if ((e.completed != e.payloads.size()) || (e.mismatches > 0) || (e.failed > 0)) {
+		std::fprintf(stderr, "fragments %zu..%zu seed %u: %zu of %zu completed, %zu mismatched, %zu failed\n",
+		             options.min_fragment_size, options.max_fragment_size, options.seed,
+		             e.completed, e.payloads.size(), e.mismatches, e.failed);
+		return false;
+	}
+
+	return true;
+}
+
+} // namespace
+
+int main()
+{
+	const std::size_t fragment_ranges[][2] = {{1, 1}, {1, 7}, {3, 5}, {1, 4096}, {4095, 4097}};
+
+	bool ok = true;
+	for (const auto& range : fragment_ranges) {
+		for (uint32_t seed = 1; seed <= 3; seed++) {
+			scramjet::memory_link_options options;
+			options.min_fragment_size = range[0];
+			options.max_fragment_size = range[1];
+			options.seed = seed;
+			ok = run(options) && ok;
+		}
+	}
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
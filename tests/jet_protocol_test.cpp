@@ -0,0 +1,316 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <scramjet/error_code.hpp>
+#include <scramjet/frame_codec.hpp>
+#include <scramjet/jet_protocol.hpp>
+#include <scramjet/message_batch.hpp>
+#include <scramjet/message_frames.hpp>
+#include <scramjet/message_type.hpp>
+#include <scramjet/protocol_version.hpp>
+
+namespace {
+
+struct recorded_event {
+	enum scramjet::protocol_event_type type;
+	enum scramjet::error_code ec;
+	uint32_t request_id;
+	uint32_t capabilities;
+	std::string data;
+
+	bool operator==(const recorded_event& other) const
+	{
+		return (type == other.type) && (ec == other.ec) && (request_id == other.request_id) &&
+		       (capabilities == other.capabilities) && (data == other.data);
+	}
+};
+
+typedef std::vector<recorded_event> event_log;
+
+void append_frame(std::vector<uint8_t>& stream, const std::vector<uint8_t>& frame)
+{
+	uint8_t prefix[scramjet::jet_protocol::LENGTH_PREFIX_SIZE];
+	scramjet::store_little(prefix, static_cast<uint32_t>(frame.size()));
+	stream.insert(stream.end(), prefix, prefix + sizeof(prefix));
+	stream.insert(stream.end(), frame.begin(), frame.end());
+}
+
+std::vector<uint8_t> version_frame(uint32_t major, uint32_t capabilities)
+{
+	std::vector<uint8_t> frame(scramjet::jet_protocol::VERSION_FRAME_SIZE);
+	scramjet::jet_protocol::encode_version(frame.data(), frame.size(), capabilities);
+	scramjet::store_little(&frame[sizeof(scramjet::message_type)], major);
+	return frame;
+}
+
+std::vector<uint8_t> response(uint32_t id, const std::string& payload)
+{
+	std::vector<uint8_t> frame(scramjet::response_frame_t::size());
+	scramjet::response_frame_t::encode(frame.data(), frame.size(), scramjet::message_type::MESSAGE_RESPONSE, id);
+	frame.insert(frame.end(), payload.begin(), payload.end());
+	return frame;
+}
+
+std::vector<uint8_t> batch(const std::vector<std::vector<uint8_t>>& entries)
+{
+	std::vector<uint8_t> frame;
+	scramjet::batch_writer writer(frame);
+	writer.clear();
+	for (const std::vector<uint8_t>& entry : entries) {
+		writer.append(entry.data(), entry.size());
+	}
+
+	return frame;
+}
+
+recorded_event record(const scramjet::protocol_event& event)
+{
+	std::string data;
+	if ((event.type != scramjet::PROTOCOL_EVENT_ESTABLISHED) && (event.data != nullptr)) {
+		data.assign(reinterpret_cast<const char*>(event.data), event.length);
+	}
+
+	return recorded_event{event.type, event.ec, event.request_id, event.capabilities, data};
+}
+
+void drain(scramjet::jet_protocol& protocol, event_log& log)
+{
+	scramjet::protocol_event event;
+	while (protocol.poll(event)) {
+		log.push_back(record(event));
+	}
+}
+
+// Feeds stream in chunks of chunk_size bytes, overwriting each chunk once
+// it was polled empty.
+event_log feed_stream(scramjet::jet_protocol& protocol, const std::vector<uint8_t>& stream, std::size_t chunk_size)
+{
+	event_log log;
+	std::vector<uint8_t> chunk;
+	for (std::size_t offset = 0; offset < stream.size(); offset += chunk_size) {
+		chunk.assign(stream.begin() + offset, stream.begin() + std::min(stream.size(), offset + chunk_size));
+		protocol.feed(chunk.data(), chunk.size());
+		drain(protocol, log);
+		std::fill(chunk.begin(), chunk.end(), 0xee);
+	}
+
+	return log;
+}
+
+bool check(bool condition, const char* what)
+{
+	if (!condition) {
+		std::fprintf(stderr, "%s\n", what);
+	}
+
+	return condition;
+}
+
+bool test_split_points(void)
+{
+	const std::vector<uint8_t> compressed = {scramjet::message_type::MESSAGE_COMPRESSED, 1, 2, 3};
+	std::vector<uint8_t> stream;
+	append_frame(stream, version_frame(1, scramjet::CAPABILITY_COMPRESSION | 2));
+	append_frame(stream, response(7, "hello"));
+	append_frame(stream, batch({response(8, "a"), response(9, "bb")}));
+	append_frame(stream, compressed);
+	append_frame(stream, std::vector<uint8_t>());
+	append_frame(stream, response(10, std::string(300, 'z')));
+
+	const uint32_t accepted = scramjet::CAPABILITY_COMPRESSION;
+	const event_log expected = {
+		{scramjet::PROTOCOL_EVENT_ESTABLISHED, scramjet::SCRAMJET_OK, 0, accepted, ""},
+		{scramjet::PROTOCOL_EVENT_RESPONSE, scramjet::SCRAMJET_OK, 7, accepted, "hello"},
+		{scramjet::PROTOCOL_EVENT_RESPONSE, scramjet::SCRAMJET_OK, 8, accepted, "a"},
+		{scramjet::PROTOCOL_EVENT_RESPONSE, scramjet::SCRAMJET_OK, 9, accepted, "bb"},
+		{scramjet::PROTOCOL_EVENT_MESSAGE, scramjet::SCRAMJET_OK, 0, accepted, std::string(compressed.begin(), compressed.end())},
+		{scramjet::PROTOCOL_EVENT_MESSAGE, scramjet::SCRAMJET_OK, 0, accepted, ""},
+		{scramjet::PROTOCOL_EVENT_RESPONSE, scramjet::SCRAMJET_OK, 10, accepted, std::string(300, 'z')},
+	};
+
+	std::vector<uint8_t> reassembly(400);
+	bool ok = true;
+	for (std::size_t chunk_size = 1; ok && (chunk_size <= stream.size()); chunk_size++) {
+		scramjet::jet_protocol protocol(reassembly.data(), reassembly.size());
+		protocol.set_capabilities(scramjet::CAPABILITY_COMPRESSION);
+		if (feed_stream(protocol, stream, chunk_size) != expected) {
+			std::fprintf(stderr, "unexpected events with chunks of %zu bytes\n", chunk_size);
+			ok = false;
+		}
+	}
+
+	// Without a reassembly buffer, frames that arrive whole still pass.
+	scramjet::jet_protocol protocol(nullptr, 0);
+	protocol.set_capabilities(scramjet::CAPABILITY_COMPRESSION);
+	ok = check(feed_stream(protocol, stream, stream.size()) == expected, "unexpected events from a single feed") && ok;
+	return ok;
+}
+
+bool test_capability_answer(void)
+{
+	std::vector<uint8_t> stream;
+	append_frame(stream, version_frame(1, scramjet::CAPABILITY_COMPRESSION));
+
+	scramjet::jet_protocol protocol(nullptr, 0);
+	const uint8_t* output;
+	feed_stream(protocol, stream, stream.size());
+	bool ok = check(protocol.pending_output(output) == 0, "capability answer without wanted capabilities");
+
+	protocol.reset();
+	protocol.set_capabilities(scramjet::CAPABILITY_COMPRESSION);
+	feed_stream(protocol, stream, stream.size());
+	ok = check(protocol.is_established() && (protocol.get_capabilities() == scramjet::CAPABILITY_COMPRESSION), "capabilities not accepted") && ok;
+
+	std::size_t length = protocol.pending_output(output);
+	if (!check(length == scramjet::jet_protocol::LENGTH_PREFIX_SIZE + scramjet::jet_protocol::VERSION_FRAME_SIZE, "wrong capability answer length")) {
+		return false;
+	}
+
+	scramjet::protocol_version version(0, 0, 0);
+	uint32_t capabilities = 0;
+	ok = check(scramjet::load_little<uint32_t>(output) == scramjet::jet_protocol::VERSION_FRAME_SIZE, "wrong capability answer prefix") && ok;
+	ok = check(scramjet::jet_protocol::read_version(output + scramjet::jet_protocol::LENGTH_PREFIX_SIZE, scramjet::jet_protocol::VERSION_FRAME_SIZE, version, capabilities) &&
+	           (capabilities == scramjet::CAPABILITY_COMPRESSION),
+	           "unreadable capability answer") &&
+	     ok;
+
+	protocol.consume_output(3);
+	ok = check(protocol.pending_output(output) == length - 3, "partial consume_output") && ok;
+	protocol.consume_output(length);
+	ok = check(protocol.pending_output(output) == 0, "output left after consume_output") && ok;
+	return ok;
+}
+
+bool test_frame_too_large(void)
+{
+	std::vector<uint8_t> stream;
+	append_frame(stream, version_frame(1, 0));
+	append_frame(stream, response(1, "x"));
+	append_frame(stream, response(2, std::string(100, 'y')));
+	append_frame(stream, response(3, "z"));
+
+	// A split frame has to fit the reassembly buffer.
+	std::vector<uint8_t> reassembly(64);
+	scramjet::jet_protocol protocol(reassembly.data(), reassembly.size());
+	event_log log = feed_stream(protocol, stream, 7);
+	bool ok = check((log.size() == 3) && (log[1].request_id == 1) &&
+	                (log[2].type == scramjet::PROTOCOL_EVENT_ERROR) && (log[2].ec == scramjet::SCRAMJET_FRAME_TOO_LARGE),
+	                "split frame above the reassembly capacity accepted");
+
+	// The maximum frame size applies to frames handed out in place as well.
+	scramjet::jet_protocol limited(nullptr, 0);
+	limited.set_max_frame_size(64);
+	log = feed_stream(limited, stream, stream.size());
+	ok = check((log.size() == 3) && (log[2].type == scramjet::PROTOCOL_EVENT_ERROR) && (log[2].ec == scramjet::SCRAMJET_FRAME_TOO_LARGE),
+	           "frame above the maximum frame size accepted") &&
+	     ok;
+
+	scramjet::protocol_event event;
+	ok = check(!limited.poll(event), "events after an error") && ok;
+	return ok;
+}
+
+bool test_version_mismatch(void)
+{
+	std::vector<uint8_t> stream;
+	append_frame(stream, version_frame(2, 0));
+	append_frame(stream, response(1, "x"));
+
+	scramjet::jet_protocol protocol(nullptr, 0);
+	event_log log = feed_stream(protocol, stream, stream.size());
+	bool ok = check((log.size() == 1) && (log[0].type == scramjet::PROTOCOL_EVENT_ERROR) && (log[0].ec == scramjet::SCRAMJET_VERSION_MISMATCH),
+	                "incompatible version accepted");
+
+	std::vector<uint8_t> good;
+	append_frame(good, version_frame(1, 0));
+	append_frame(good, response(1, "x"));
+	protocol.reset();
+	log = feed_stream(protocol, good, good.size());
+	ok = check((log.size() == 2) && (log[1].type == scramjet::PROTOCOL_EVENT_RESPONSE), "no events after reset") && ok;
+	return ok;
+}
+
+bool test_whole_frames(void)
+{
+	scramjet::jet_protocol protocol(nullptr, 0);
+	protocol.assume_established(scramjet::CAPABILITY_COMPRESSION);
+
+	event_log log;
+	std::vector<uint8_t> frame = batch({response(4, "four"), response(5, "five"), response(6, "")});
+	protocol.feed_frame(frame.data(), frame.size());
+	drain(protocol, log);
+	bool ok = check((log.size() == 3) && (log[0].request_id == 4) && (log[1].data == "five") && (log[2].request_id == 6) &&
+	                (log[2].capabilities == scramjet::CAPABILITY_COMPRESSION),
+	                "batch not split into responses");
+
+	log.clear();
+	const std::vector<uint8_t> compressed = {scramjet::message_type::MESSAGE_COMPRESSED, 9};
+	protocol.feed_frame(compressed.data(), compressed.size());
+	drain(protocol, log);
+	ok = check((log.size() == 1) && (log[0].type == scramjet::PROTOCOL_EVENT_MESSAGE) && (log[0].data.size() == compressed.size()),
+	           "frame not handed on") &&
+	     ok;
+	return ok;
+}
+
+bool test_request_header(void)
+{
+	uint8_t header[scramjet::jet_protocol::REQUEST_HEADER_SIZE];
+	bool ok = check(scramjet::jet_protocol::encode_request_header(header, sizeof(header) - 1, 5, 10) == 0, "request header in a short buffer");
+	if (!check(scramjet::jet_protocol::encode_request_header(header, sizeof(header), 5, 10) == sizeof(header), "request header not written")) {
+		return false;
+	}
+
+	scramjet::request_frame_t::view view;
+	ok = check(scramjet::load_little<uint32_t>(header) == scramjet::request_frame_t::size() + 10, "wrong request length prefix") && ok;
+	ok = check(scramjet::request_frame_t::decode(header + scramjet::jet_protocol::LENGTH_PREFIX_SIZE, scramjet::request_frame_t::size(), view) &&
+	           (view.get<0>() == scramjet::message_type::MESSAGE_REQUEST) && (view.get<1>() == 5),
+	           "wrong request header") &&
+	     ok;
+	return ok;
+}
+
+} // namespace
+
+int main()
+{
+	bool ok = test_split_points();
+	ok = test_capability_answer() && ok;
+	ok = test_frame_too_large() && ok;
+	ok = test_version_mismatch() && ok;
+	ok = test_whole_frames() && ok;
+	ok = test_request_header() && ok;
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
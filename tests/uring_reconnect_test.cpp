@@ -0,0 +1,134 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+
+#include <boost/asio.hpp>
+
+#include <scramjet/error_code.hpp>
+#include <scramjet/jet_connection.hpp>
+#include <scramjet/jet_peer.hpp>
+#include <scramjet/socket_jet_connection.hpp>
+
+#include "loopback_server.hpp"
+
+namespace {
+
+const unsigned int CYCLES = 200;
+const std::chrono::milliseconds TIMEOUT(2000);
+const int SKIPPED = 77;
+
+struct cycles {
+	scramjet::jet_peer* peer;
+	unsigned int completed;
+	unsigned int failed;
+};
+
+void connect(cycles& c);
+
+void response_received(cycles& c, enum scramjet::error_code ec)
+{
+	if (ec != scramjet::SCRAMJET_OK) {
+		std::fprintf(stderr, "request in cycle %u failed with %d\n", c.completed, ec);
+		c.failed++;
+		c.peer->disconnect();
+		return;
+	}
+
+	// Connect again right away, before the engine reaped the completions
+	// of the socket just closed.
+	c.peer->disconnect();
+	if (++c.completed < CYCLES) {
+		connect(c);
+	}
+}
+
+void connect(cycles& c)
+{
+	cycles* state = &c;
+	c.peer->connect([state](enum scramjet::error_code ec) {
+		if (ec != scramjet::SCRAMJET_OK) {
+			std::fprintf(stderr, "connect in cycle %u failed with %d\n", state->completed, ec);
+			state->failed++;
+			return;
+		}
+
+		static const uint8_t payload[] = "ping";
+		state->peer->request(payload, sizeof(payload), [state](enum scramjet::error_code response_ec, const uint8_t*, size_t) {
+			response_received(*state, response_ec);
+		},
+		                     TIMEOUT);
+	},
+	                TIMEOUT);
+}
+
+} // namespace
+
+int main()
+{
+	boost::asio::io_context server_context;
+	scramjet::loopback_server server(server_context);
+	uint16_t port = server.listen_tcp("127.0.0.1", 0);
+	auto work = boost::asio::make_work_guard(server_context);
+	std::thread server_thread([&server_context]() {
+		server_context.run();
+	});
+
+	boost::asio::io_context ioc;
+	scramjet::socket_jet_connection* connection = new scramjet::socket_jet_connection(ioc, "127.0.0.1", port);
+	bool uring = connection->enable_io_uring();
+	scramjet::jet_peer peer{std::unique_ptr<scramjet::jet_connection>(connection)};
+	cycles c = {&peer, 0, 0};
+	if (uring) {
+		connect(c);
+		ioc.run();
+	}
+
+	boost::asio::post(server_context, [&server]() {
+		server.close();
+	});
+	work.reset();
+	server_thread.join();
+
+	if (!uring) {
+		std::fprintf(stderr, "io_uring not available, skipped\n");
+		return SKIPPED;
+	}
+
+	if ((c.failed > 0) || (c.completed != CYCLES)) {
+		std::fprintf(stderr, "completed %u of %u reconnect cycles, %u failed\n", c.completed, CYCLES, c.failed);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
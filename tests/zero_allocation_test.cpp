@@ -0,0 +1,233 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <unistd.h>
+
+#include <boost/asio.hpp>
+
+#include <scramjet/error_code.hpp>
+#include <scramjet/jet_peer.hpp>
+#include <scramjet/jet_connection.hpp>
+#include <scramjet/memory_jet_connection.hpp>
+#include <scramjet/socket_jet_connection.hpp>
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+#include <scramjet/unix_jet_connection.hpp>
+#endif
+
+#include "loopback_server.hpp"
+
+static std::atomic<uint64_t> allocations{0};
+
+// Only the thread running the peer is counted, the loopback_server thread
+// answering socket requests is not under test.
+static thread_local bool counted_thread = false;
+
+static void count_allocation(void)
+{
+	if (counted_thread) {
+		allocations.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void* operator new(std::size_t size)
+{
+	count_allocation();
+	void* p = std::malloc((size > 0) ? size : 1);
+	if (p == nullptr) {
+		throw std::bad_alloc();
+	}
+
+	return p;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	count_allocation();
+	return std::malloc((size > 0) ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+	return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+namespace {
+
+const unsigned int WARM_UP_REQUESTS = 2000;
+const unsigned int MEASURED_REQUESTS = 20000;
+const unsigned int PIPELINE_DEPTH = 8;
+const std::chrono::milliseconds REQUEST_TIMEOUT(5000);
+
+struct round_trips {
+	scramjet::jet_peer* peer;
+	unsigned int completed;
+	unsigned int failed;
+	uint64_t allocations_before;
+	uint64_t allocations_after;
+	uint8_t payload[64];
+};
+
+void send_request(round_trips& r);
+
+void response_received(round_trips& r, enum scramjet::error_code ec)
+{
+	if (ec != scramjet::SCRAMJET_OK) {
+		r.failed++;
+		r.peer->disconnect();
+		return;
+	}
+
+	r.completed++;
+	if (r.completed == WARM_UP_REQUESTS) {
+		r.allocations_before = allocations.load(std::memory_order_relaxed);
+	}
+
+	if (r.completed == WARM_UP_REQUESTS + MEASURED_REQUESTS) {
+		r.allocations_after = allocations.load(std::memory_order_relaxed);
+		r.peer->disconnect();
+		return;
+	}
+
+	if (r.completed + PIPELINE_DEPTH <= WARM_UP_REQUESTS + MEASURED_REQUESTS) {
+		send_request(r);
+	}
+}
+
+void send_request(round_trips& r)
+{
+	round_trips* state = &r;
+	r.peer->request(r.payload, sizeof(r.payload), [state](enum scramjet::error_code ec, const uint8_t*, size_t) {
+		response_received(*state, ec);
+	},
+	                REQUEST_TIMEOUT);
+}
+
+bool run(const char* name, boost::asio::io_context& ioc, std::unique_ptr<scramjet::jet_connection> connection)
+{
+	scramjet::jet_peer peer(std::move(connection));
+	round_trips r = {&peer, 0, 0, 0, 0, {}};
+	peer.connect([&r](enum scramjet::error_code ec) {
+		if (ec != scramjet::SCRAMJET_OK) {
+			r.failed++;
+			return;
+		}
+
+		for (unsigned int i = 0; i < PIPELINE_DEPTH; i++) {
+			send_request(r);
+		}
+	},
+	             REQUEST_TIMEOUT);
+	ioc.run();
+	ioc.restart();
+
+	if ((r.failed > 0) || (r.completed != WARM_UP_REQUESTS + MEASURED_REQUESTS)) {
+		std::fprintf(stderr, "%s: completed %u of %u round trips, %u failed\n", name, r.completed, WARM_UP_REQUESTS + MEASURED_REQUESTS, r.failed);
+		return false;
+	}
+
+	uint64_t steady_state = r.allocations_after - r.allocations_before;
+	if (steady_state != 0) {
+		std::fprintf(stderr, "%s: %llu allocations in %u steady state round trips\n", name, static_cast<unsigned long long>(steady_state), MEASURED_REQUESTS);
+		return false;
+	}
+
+	return true;
+}
+
+} // namespace
+
+int main()
+{
+	counted_thread = true;
+
+	boost::asio::io_context server_context;
+	scramjet::loopback_server server(server_context);
+	uint16_t port = server.listen_tcp("127.0.0.1", 0);
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+	const std::string unix_path = "@scramjet_zero_allocation_test_" + std::to_string(::getpid());
+	server.listen_unix(unix_path);
+#endif
+	auto work = boost::asio::make_work_guard(server_context);
+	std::thread server_thread([&server_context]() {
+		server_context.run();
+	});
+
+	boost::asio::io_context ioc;
+	scramjet::memory_jet_connection::pair_t pair = scramjet::memory_jet_connection::create_pair(ioc);
+	scramjet::loopback_responder responder(*pair.second);
+	responder.start();
+
+	bool ok = run("memory", ioc, std::move(pair.first));
+	ok = run("tcp", ioc, std::unique_ptr<scramjet::jet_connection>(new scramjet::socket_jet_connection(ioc, "127.0.0.1", port))) && ok;
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+	ok = run("unix", ioc, std::unique_ptr<scramjet::jet_connection>(new scramjet::unix_jet_connection(ioc, unix_path))) && ok;
+#endif
+
+	boost::asio::post(server_context, [&server]() {
+		server.close();
+	});
+	work.reset();
+	server_thread.join();
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,139 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <csignal>
+#include <cstdbool>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <boost/asio.hpp>
+
+#if defined(__linux__)
+#include <scramjet/shm_ring.hpp>
+#endif
+
+#include "loopback_server.hpp"
+
+static boost::asio::io_context io_context;
+
+static void sighandler(int signum)
+{
+	(void)signum;
+	io_context.stop();
+}
+
+static void usage(const char* name)
+{
+	std::cerr << "Usage: " << name << " [--tcp <port>] [--unix <path>] [--shm <path>] [--ring-size <bytes>] [--compress <threshold>]" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string tcp_port;
+	std::string unix_path;
+	std::string shm_path;
+	std::size_t compression_threshold = 0;
+#if defined(__linux__)
+	std::size_t ring_size = scramjet::shm_ring::DEFAULT_CAPACITY;
+#endif
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg(argv[i]);
+		if ((arg == "--tcp") && (i + 1 < argc)) {
+			tcp_port = argv[++i];
+		} else if ((arg == "--unix") && (i + 1 < argc)) {
+			unix_path = argv[++i];
+		} else if ((arg == "--shm") && (i + 1 < argc)) {
+			shm_path = argv[++i];
+		} else if ((arg == "--compress") && (i + 1 < argc)) {
+			compression_threshold = std::strtoul(argv[++i], nullptr, 0);
+#if defined(__linux__)
+		} else if ((arg == "--ring-size") && (i + 1 < argc)) {
+			ring_size = std::strtoul(argv[++i], nullptr, 0);
+#endif
+		} else {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (tcp_port.empty() && unix_path.empty() && shm_path.empty()) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+#if defined(__linux__)
+	if ((ring_size == 0) || ((ring_size & (ring_size - 1)) != 0)) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+#endif
+
+	if (std::signal(SIGTERM, sighandler) == SIG_ERR) {
+		return EXIT_FAILURE;
+	}
+
+	if (std::signal(SIGINT, sighandler) == SIG_ERR) {
+		std::signal(SIGTERM, SIG_DFL);
+		return EXIT_FAILURE;
+	}
+
+	scramjet::loopback_server server(io_context);
+	server.set_compression(compression_threshold);
+	try {
+		if (!tcp_port.empty()) {
+			server.listen_tcp("127.0.0.1", static_cast<uint16_t>(std::strtoul(tcp_port.c_str(), nullptr, 10)));
+		}
+
+		if (!unix_path.empty()) {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+			server.listen_unix(unix_path);
+#else
+			std::cerr << "unix domain sockets are not supported on this platform!" << std::endl;
+			return EXIT_FAILURE;
+#endif
+		}
+
+		if (!shm_path.empty()) {
+#if defined(__linux__)
+			server.listen_shm(shm_path, ring_size);
+#else
+			std::cerr << "shared memory transport is not supported on this platform!" << std::endl;
+			return EXIT_FAILURE;
+#endif
+		}
+	} catch (const boost::system::system_error& e) {
+		std::cerr << "could not listen: " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	io_context.run();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,656 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#endif
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+#include <unistd.h>
+#endif
+
+#include <boost/asio.hpp>
+
+#include <scramjet/error_code.hpp>
+#include <scramjet/frame_codec.hpp>
+#include <scramjet/frame_compressor.hpp>
+#include <scramjet/jet_connection.hpp>
+#include <scramjet/message_batch.hpp>
+#include <scramjet/message_frames.hpp>
+#include <scramjet/message_type.hpp>
+
+#if defined(__linux__)
+#include <scramjet/shm_jet_connection.hpp>
+#include <scramjet/shm_ring.hpp>
+#endif
+
+#include "loopback_server.hpp"
+
+namespace scramjet {
+
+class stream_session : public std::enable_shared_from_this<stream_session> {
+public:
+	stream_session(boost::asio::generic::stream_protocol::socket socket, std::size_t compression_threshold)
+	        : m_socket(std::move(socket))
+	        , m_compression_threshold(compression_threshold)
+	{
+	}
+
+	void start()
+	{
+		std::vector<uint8_t> version = loopback_server::version_message();
+		if (m_compression_threshold > 0) {
+			version.resize(version.size() + sizeof(uint32_t));
+			store_little(&version[version.size() - sizeof(uint32_t)], static_cast<uint32_t>(CAPABILITY_COMPRESSION));
+		}
+
+		append_frame(version.data(), version.size());
+		write();
+		read();
+	}
+
+private:
+	boost::asio::generic::stream_protocol::socket m_socket;
+	std::size_t m_compression_threshold;
+	bool m_compressing = false;
+	frame_compressor m_compressor;
+	std::vector<uint8_t> m_compressed;
+	std::vector<uint8_t> m_inflated;
+	std::vector<uint8_t> m_input;
+	std::size_t m_input_size = 0;
+	std::vector<uint8_t> m_pending;
+	std::vector<uint8_t> m_output;
+	std::vector<uint8_t> m_reply;
+	bool m_reading = false;
+	bool m_writing = false;
+
+	static const std::size_t READ_SIZE = 64 * 1024;
+	static const std::size_t MAX_PENDING_OUTPUT = 4 * 1024 * 1024;
+
+	void append_frame(const uint8_t* message, std::size_t message_length)
+	{
+		if (m_compressing && (message_length > m_compression_threshold) &&
+		    m_compressor.compress(message, message_length, m_compressed)) {
+			message = m_compressed.data();
+			message_length = m_compressed.size();
+		}
+
+		std::size_t offset = m_pending.size();
+		m_pending.resize(offset + sizeof(uint32_t) + message_length);
+		store_little(&m_pending[offset], static_cast<uint32_t>(message_length));
+		std::memcpy(&m_pending[offset + sizeof(uint32_t)], message, message_length);
+	}
+
+	void read()
+	{
+		if (m_reading || (m_pending.size() > MAX_PENDING_OUTPUT)) {
+			return;
+		}
+
+		if (m_input.size() - m_input_size < READ_SIZE) {
+			m_input.resize(m_input_size + READ_SIZE);
+		}
+
+		m_reading = true;
+		auto self = shared_from_this();
+		m_socket.async_read_some(boost::asio::buffer(&m_input[m_input_size], m_input.size() - m_input_size),
+		                         [self](const boost::system::error_code& ec, std::size_t bytes_transferred) {
+			                         self->data_read(ec, bytes_transferred);
+		                         });
+	}
+
+	void data_read(const boost::system::error_code& ec, std::size_t bytes_transferred)
+	{
+		m_reading = false;
+		if (ec) {
+			boost::system::error_code close_ec;
+			m_socket.close(close_ec);
+			return;
+		}
+
+		m_input_size += bytes_transferred;
+		std::size_t position = 0;
+		while (m_input_size - position >= sizeof(uint32_t)) {
+			uint32_t message_length = load_little<uint32_t>(&m_input[position]);
+			if (m_input_size - position - sizeof(uint32_t) < message_length) {
+				if (m_input.size() < sizeof(uint32_t) + message_length) {
+					m_input.resize(sizeof(uint32_t) + message_length + READ_SIZE);
+				}
+				break;
+			}
+
+			if (!handle_message(&m_input[position + sizeof(uint32_t)], message_length)) {
+				boost::system::error_code close_ec;
+				m_socket.close(close_ec);
+				return;
+			}
+			position += sizeof(uint32_t) + message_length;
+		}
+
+		if (position > 0) {
+			std::memmove(m_input.data(), &m_input[position], m_input_size - position);
+			m_input_size -= position;
+		}
+
+		write();
+		read();
+	}
+
+	bool handle_message(const uint8_t* message, std::size_t message_length)
+	{
+		api_version_frame_t::view version;
+		if (api_version_frame_t::decode(message, message_length, version) &&
+		    (version.get<0>() == message_type::MESSAGE_API_VERSION)) {
+			// The peer answers the offered capabilities with those it uses.
+			if (version.payload_length() == sizeof(uint32_t)) {
+				uint32_t capabilities = load_little<uint32_t>(version.payload());
+				m_compressing = (m_compression_threshold > 0) && ((capabilities & CAPABILITY_COMPRESSION) != 0);
+			}
+			return true;
+		}
+
+		compressed_frame_t::view compressed;
+		if ((m_compression_threshold > 0) && compressed_frame_t::decode(message, message_length, compressed) &&
+		    (compressed.get<0>() == message_type::MESSAGE_COMPRESSED)) {
+			if (compressed.get<1>() > DEFAULT_MAX_FRAME_SIZE) {
+				return false;
+			}
+			m_inflated.resize(compressed.get<1>());
+			if (!m_compressor.decompress(compressed.payload(), compressed.payload_length(), m_inflated.data(), m_inflated.size())) {
+				return false;
+			}
+			message = m_inflated.data();
+			message_length = m_inflated.size();
+		}
+
+		loopback_server::build_reply(message, message_length, m_reply);
+		append_frame(m_reply.data(), m_reply.size());
+		return true;
+	}
+
+	void write()
+	{
+		if (m_writing || m_pending.empty()) {
+			return;
+		}
+
+		m_output.swap(m_pending);
+		m_pending.clear();
+		m_writing = true;
+		auto self = shared_from_this();
+		boost::asio::async_write(m_socket, boost::asio::buffer(m_output), [self](const boost::system::error_code& ec, std::size_t) {
+			self->data_written(ec);
+		});
+	}
+
+	void data_written(const boost::system::error_code& ec)
+	{
+		m_writing = false;
+		m_output.clear();
+		if (ec) {
+			boost::system::error_code close_ec;
+			m_socket.close(close_ec);
+			return;
+		}
+
+		write();
+		read();
+	}
+};
+
+#if defined(__linux__)
+static void signal_event(int fd)
+{
+	uint64_t value = 1;
+	ssize_t ret = ::write(fd, &value, sizeof(value));
+	(void)ret;
+}
+
+static void drain_event(int fd)
+{
+	uint64_t value;
+	ssize_t ret = ::read(fd, &value, sizeof(value));
+	(void)ret;
+}
+
+class shm_session : public std::enable_shared_from_this<shm_session> {
+public:
+	explicit shm_session(boost::asio::local::stream_protocol::socket socket)
+	        : m_control_socket(std::move(socket))
+	        , m_rx_data_event(m_control_socket.get_executor())
+	        , m_tx_space_event(m_control_socket.get_executor())
+	{
+	}
+
+	~shm_session()
+	{
+		if (m_segment != nullptr) {
+			::munmap(m_segment, m_segment_size);
+		}
+
+		if (m_tx_data_fd >= 0) {
+			::close(m_tx_data_fd);
+		}
+
+		if (m_rx_space_fd >= 0) {
+			::close(m_rx_space_fd);
+		}
+	}
+
+	bool start(std::size_t capacity)
+	{
+		int fds[shm_jet_connection::SHM_DESCRIPTOR_COUNT];
+		fds[shm_jet_connection::SHM_SEGMENT] = ::memfd_create("scramjet", MFD_CLOEXEC);
+		for (int i = shm_jet_connection::SHM_RX_DATA_EVENT; i < shm_jet_connection::SHM_DESCRIPTOR_COUNT; i++) {
+			fds[i] = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		}
+
+		m_segment_size = 2 * shm_ring::get_segment_size(capacity);
+		if (::ftruncate(fds[shm_jet_connection::SHM_SEGMENT], static_cast<off_t>(m_segment_size)) < 0) {
+			return false;
+		}
+
+		m_segment = ::mmap(nullptr, m_segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fds[shm_jet_connection::SHM_SEGMENT], 0);
+		if (m_segment == MAP_FAILED) {
+			m_segment = nullptr;
+			return false;
+		}
+
+		uint8_t* rx_memory = static_cast<uint8_t*>(m_segment) + shm_ring::get_segment_size(capacity);
+		shm_ring::init(m_segment, capacity);
+		shm_ring::init(rx_memory, capacity);
+		m_tx.attach(m_segment, capacity);
+		m_rx.attach(rx_memory, capacity);
+
+		std::vector<uint8_t> version = loopback_server::version_message();
+		m_tx.write(version.data(), version.size());
+
+		// The peer's receive ring is our transmit ring and vice versa.
+		m_tx_data_fd = fds[shm_jet_connection::SHM_RX_DATA_EVENT];
+		m_tx_space_event.assign(fds[shm_jet_connection::SHM_RX_SPACE_EVENT]);
+		m_rx_data_event.assign(fds[shm_jet_connection::SHM_TX_DATA_EVENT]);
+		m_rx_space_fd = fds[shm_jet_connection::SHM_TX_SPACE_EVENT];
+
+		uint8_t byte = 0;
+		struct iovec iov;
+		iov.iov_base = &byte;
+		iov.iov_len = sizeof(byte);
+
+		union {
+			struct cmsghdr header;
+			uint8_t buffer[CMSG_SPACE(sizeof(fds))];
+		} control;
+		std::memset(&control, 0, sizeof(control));
+
+		struct msghdr msg;
+		std::memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control.buffer;
+		msg.msg_controllen = sizeof(control.buffer);
+
+		struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+		std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+		ssize_t ret = ::sendmsg(m_control_socket.native_handle(), &msg, MSG_NOSIGNAL);
+		::close(fds[shm_jet_connection::SHM_SEGMENT]);
+		if (ret < 0) {
+			return false;
+		}
+
+		auto self = shared_from_this();
+		m_control_socket.async_wait(boost::asio::socket_base::wait_read, [self](const boost::system::error_code&) {
+			self->close();
+		});
+
+		process();
+		return true;
+	}
+
+private:
+	boost::asio::local::stream_protocol::socket m_control_socket;
+	boost::asio::posix::stream_descriptor m_rx_data_event;
+	boost::asio::posix::stream_descriptor m_tx_space_event;
+	int m_tx_data_fd = -1;
+	int m_rx_space_fd = -1;
+	void* m_segment = nullptr;
+	std::size_t m_segment_size = 0;
+	shm_ring m_rx;
+	shm_ring m_tx;
+	std::vector<uint8_t> m_scratch;
+	std::vector<uint8_t> m_reply;
+	bool m_closed = false;
+
+	static const unsigned int MAX_BATCH = 256;
+
+	void close()
+	{
+		m_closed = true;
+		boost::system::error_code ec;
+		m_control_socket.close(ec);
+		m_rx_data_event.close(ec);
+		m_tx_space_event.close(ec);
+	}
+
+	void process()
+	{
+		if (m_closed) {
+			return;
+		}
+
+		const uint8_t* message;
+		std::size_t message_length;
+		unsigned int count = 0;
+		bool tx_full = false;
+		enum error_code result = SCRAMJET_OK;
+		while ((count < MAX_BATCH) && m_rx.read(message, message_length, m_rx.get_capacity(), m_scratch, result)) {
+			loopback_server::build_reply(message, message_length, m_reply);
+			if (!m_tx.write(m_reply.data(), m_reply.size())) {
+				tx_full = true;
+				break;
+			}
+
+			m_rx.consume();
+			count++;
+		}
+
+		if (result != SCRAMJET_OK) {
+			close();
+			return;
+		}
+
+		if ((count > 0) && m_tx.consumer_needs_wakeup()) {
+			signal_event(m_tx_data_fd);
+		}
+
+		if ((count > 0) && m_rx.producer_needs_wakeup()) {
+			signal_event(m_rx_space_fd);
+		}
+
+		auto self = shared_from_this();
+		if (tx_full) {
+			if (m_tx.prepare_producer_wait(m_reply.size())) {
+				m_tx_space_event.async_wait(boost::asio::posix::descriptor_base::wait_read, [self](const boost::system::error_code& ec) {
+					if (!ec) {
+						drain_event(self->m_tx_space_event.native_handle());
+						self->process();
+					}
+				});
+				return;
+			}
+		} else if (m_rx.prepare_consumer_wait()) {
+			m_rx_data_event.async_wait(boost::asio::posix::descriptor_base::wait_read, [self](const boost::system::error_code& ec) {
+				if (!ec) {
+					drain_event(self->m_rx_data_event.native_handle());
+					self->process();
+				}
+			});
+			return;
+		}
+
+		boost::asio::post(m_control_socket.get_executor(), [self]() {
+			self->process();
+		});
+	}
+};
+
+#endif
+
+loopback_server::loopback_server(boost::asio::io_context& ioc) noexcept
+        : m_io_context(ioc)
+{
+}
+
+loopback_server::~loopback_server() noexcept
+{
+	close();
+}
+
+std::vector<uint8_t> loopback_server::version_message(void)
+{
+	const auto message = api_version_frame_t::to_bytes(message_type::MESSAGE_API_VERSION, 1, 0, 0);
+	return std::vector<uint8_t>(message.begin(), message.end());
+}
+
+void loopback_server::build_reply(const uint8_t* message, size_t message_length, std::vector<uint8_t>& reply)
+{
+	reply.assign(message, message + message_length);
+	request_frame_t::view request;
+	if (request_frame_t::decode(message, message_length, request) &&
+	    (request.get<0>() == message_type::MESSAGE_REQUEST)) {
+		store_little(reply.data(), message_type::MESSAGE_RESPONSE);
+		return;
+	}
+
+	batch_reader batch(message, message_length);
+	const uint8_t* entry;
+	size_t entry_length;
+	while (batch.next(entry, entry_length)) {
+		if (request_frame_t::decode(entry, entry_length, request) &&
+		    (request.get<0>() == message_type::MESSAGE_REQUEST)) {
+			store_little(&reply[entry - message], message_type::MESSAGE_RESPONSE);
+		}
+	}
+}
+
+void loopback_server::set_compression(std::size_t threshold) noexcept
+{
+	m_compression_threshold = frame_compressor::is_available() ? threshold : 0;
+}
+
+uint16_t loopback_server::listen_tcp(const std::string& address, uint16_t port)
+{
+	boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::make_address(address), port);
+	std::unique_ptr<boost::asio::ip::tcp::acceptor> acceptor(new boost::asio::ip::tcp::acceptor(m_io_context));
+	acceptor->open(endpoint.protocol());
+	acceptor->set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+	acceptor->bind(endpoint);
+	acceptor->listen();
+	uint16_t bound_port = acceptor->local_endpoint().port();
+	accept_tcp(*acceptor);
+	m_tcp_acceptors.push_back(std::move(acceptor));
+	return bound_port;
+}
+
+void loopback_server::accept_tcp(boost::asio::ip::tcp::acceptor& acceptor)
+{
+	acceptor.async_accept([this, &acceptor](const boost::system::error_code& ec, boost::asio::ip::tcp::socket socket) {
+		if (ec) {
+			return;
+		}
+
+		boost::system::error_code option_ec;
+		socket.set_option(boost::asio::ip::tcp::no_delay(true), option_ec);
+		std::make_shared<stream_session>(boost::asio::generic::stream_protocol::socket(std::move(socket)), m_compression_threshold)->start();
+		accept_tcp(acceptor);
+	});
+}
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+std::string loopback_server::local_path(const std::string& path)
+{
+	std::string local = path;
+	if (!local.empty() && (local[0] == '@')) {
+		local[0] = '\0';
+	} else {
+		::unlink(local.c_str());
+	}
+
+	return local;
+}
+
+void loopback_server::listen_unix(const std::string& path)
+{
+	std::unique_ptr<boost::asio::local::stream_protocol::acceptor> acceptor(
+	        new boost::asio::local::stream_protocol::acceptor(m_io_context, boost::asio::local::stream_protocol::endpoint(local_path(path))));
+	accept_unix(*acceptor);
+	m_unix_acceptors.push_back(std::move(acceptor));
+}
+
+void loopback_server::accept_unix(boost::asio::local::stream_protocol::acceptor& acceptor)
+{
+	acceptor.async_accept([this, &acceptor](const boost::system::error_code& ec, boost::asio::local::stream_protocol::socket socket) {
+		if (ec) {
+			return;
+		}
+
+		std::make_shared<stream_session>(boost::asio::generic::stream_protocol::socket(std::move(socket)), m_compression_threshold)->start();
+		accept_unix(acceptor);
+	});
+}
+#endif
+
+#if defined(__linux__)
+void loopback_server::listen_shm(const std::string& path, std::size_t ring_size)
+{
+	m_ring_size = ring_size;
+	std::unique_ptr<boost::asio::local::stream_protocol::acceptor> acceptor(
+	        new boost::asio::local::stream_protocol::acceptor(m_io_context, boost::asio::local::stream_protocol::endpoint(local_path(path))));
+	accept_shm(*acceptor);
+	m_shm_acceptors.push_back(std::move(acceptor));
+}
+
+void loopback_server::accept_shm(boost::asio::local::stream_protocol::acceptor& acceptor)
+{
+	acceptor.async_accept([this, &acceptor](const boost::system::error_code& ec, boost::asio::local::stream_protocol::socket socket) {
+		if (ec) {
+			return;
+		}
+
+		auto session = std::make_shared<shm_session>(std::move(socket));
+		if (!session->start(m_ring_size)) {
+			std::cerr << "could not set up shared memory session!" << std::endl;
+		}
+
+		accept_shm(acceptor);
+	});
+}
+#endif
+
+void loopback_server::close(void) noexcept
+{
+	boost::system::error_code ec;
+	for (auto& acceptor : m_tcp_acceptors) {
+		acceptor->close(ec);
+	}
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+	for (auto& acceptor : m_unix_acceptors) {
+		acceptor->close(ec);
+	}
+#endif
+
+#if defined(__linux__)
+	for (auto& acceptor : m_shm_acceptors) {
+		acceptor->close(ec);
+	}
+#endif
+}
+
+loopback_responder::loopback_responder(jet_connection& connection) noexcept
+        : m_connection(connection)
+{
+}
+
+void loopback_responder::start(void) noexcept
+{
+	m_connection.connect([this](enum error_code ec) {
+		if (ec != SCRAMJET_OK) {
+			return;
+		}
+
+		next_buffer() = loopback_server::version_message();
+		send(m_in_flight.back());
+		m_connection.receive_message([this](enum error_code receive_ec, const uint8_t* message, size_t message_length) {
+			message_received(receive_ec, message, message_length);
+		});
+	},
+	                     std::chrono::milliseconds(0));
+}
+
+std::vector<uint8_t>& loopback_responder::next_buffer(void) noexcept
+{
+	std::vector<uint8_t> buffer;
+	if (!m_free.empty()) {
+		buffer.swap(m_free.back());
+		m_free.pop_back();
+	}
+
+	m_in_flight.push_back(std::move(buffer));
+	return m_in_flight.back();
+}
+
+void loopback_responder::send(const std::vector<uint8_t>& buffer) noexcept
+{
+	m_connection.send_message(buffer.data(), buffer.size(), [this](enum error_code ec) {
+		message_sent(ec);
+	});
+}
+
+void loopback_responder::message_received(enum error_code ec, const uint8_t* message, size_t message_length) noexcept
+{
+	if (ec != SCRAMJET_OK) {
+		m_connection.disconnect();
+		return;
+	}
+
+	std::vector<uint8_t>& reply = next_buffer();
+	loopback_server::build_reply(message, message_length, reply);
+	send(reply);
+}
+
+void loopback_responder::message_sent(enum error_code ec) noexcept
+{
+	(void)ec;
+	if (m_in_flight_position == m_in_flight.size()) {
+		return;
+	}
+
+	m_free.push_back(std::move(m_in_flight[m_in_flight_position++]));
+	if (m_in_flight_position == m_in_flight.size()) {
+		m_in_flight.clear();
+		m_in_flight_position = 0;
+	}
+}
+
+} // namespace scramjet
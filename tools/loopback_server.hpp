@@ -0,0 +1,116 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) <2020> Matthias Loy, Stephan Gatzka
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SCRAMJET__LOOPBACK_SERVER_HPP
+#define SCRAMJET__LOOPBACK_SERVER_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include <scramjet/error_code.hpp>
+#include <scramjet/jet_connection.hpp>
+
+namespace scramjet {
+
+class loopback_server final {
+public:
+	explicit loopback_server(boost::asio::io_context& ioc) noexcept;
+	~loopback_server() noexcept;
+
+	loopback_server(const loopback_server&) = delete;
+	loopback_server& operator=(const loopback_server&) = delete;
+
+	// Offers CAPABILITY_COMPRESSION to peers on tcp and unix connections
+	// and compresses replies longer than threshold to those accepting it.
+	void set_compression(std::size_t threshold) noexcept;
+
+	uint16_t listen_tcp(const std::string& address, uint16_t port);
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+	void listen_unix(const std::string& path);
+#endif
+#if defined(__linux__)
+	void listen_shm(const std::string& path, std::size_t ring_size);
+#endif
+	void close(void) noexcept;
+
+	static std::vector<uint8_t> version_message(void);
+	static void build_reply(const uint8_t* message, size_t message_length, std::vector<uint8_t>& reply);
+
+private:
+	boost::asio::io_context& m_io_context;
+	std::size_t m_compression_threshold = 0;
+	std::vector<std::unique_ptr<boost::asio::ip::tcp::acceptor>> m_tcp_acceptors;
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+	std::vector<std::unique_ptr<boost::asio::local::stream_protocol::acceptor>> m_unix_acceptors;
+#endif
+#if defined(__linux__)
+	std::vector<std::unique_ptr<boost::asio::local::stream_protocol::acceptor>> m_shm_acceptors;
+	std::size_t m_ring_size = 0;
+#endif
+
+	void accept_tcp(boost::asio::ip::tcp::acceptor& acceptor);
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+	void accept_unix(boost::asio::local::stream_protocol::acceptor& acceptor);
+	static std::string local_path(const std::string& path);
+#endif
+#if defined(__linux__)
+	void accept_shm(boost::asio::local::stream_protocol::acceptor& acceptor);
+#endif
+};
+
+// Answers requests arriving on the far end of an in-process connection,
+// e.g. one side of a memory_jet_connection pair.
+class loopback_responder final {
+public:
+	explicit loopback_responder(jet_connection& connection) noexcept;
+
+	loopback_responder(const loopback_responder&) = delete;
+	loopback_responder& operator=(const loopback_responder&) = delete;
+
+	void start(void) noexcept;
+
+private:
+	jet_connection& m_connection;
+	std::vector<std::vector<uint8_t>> m_in_flight;
+	std::size_t m_in_flight_position = 0;
+	std::vector<std::vector<uint8_t>> m_free;
+
+	std::vector<uint8_t>& next_buffer(void) noexcept;
+	void send(const std::vector<uint8_t>& buffer) noexcept;
+	void message_received(enum error_code ec, const uint8_t* message, size_t message_length) noexcept;
+	void message_sent(enum error_code ec) noexcept;
+};
+
+} // namespace scramjet
+
+#endif